@@ -0,0 +1,279 @@
+/*****************************************************************************
+ * ext_set.c
+ *****************************************************************************
+ * Copyright © 2023 VLC authors, VideoLAN and VideoLabs
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ext_set.h"
+
+/* Extensions are packed in 64 bits keys. Keys are spread in buckets, then
+ * each bucket gets a displacement seed mapping all its keys to free slots. */
+struct ext_set
+{
+    uint64_t *p_keys;
+    uint8_t *p_categories;
+    uint32_t *p_displacements;
+    uint32_t buckets;
+    uint32_t mask;
+    atomic_uint refs;
+};
+
+static pthread_mutex_t default_lock = PTHREAD_MUTEX_INITIALIZER;
+static ext_set *default_set = NULL;
+
+static uint64_t
+ext_hash(uint64_t key, uint64_t seed)
+{
+    key ^= seed * UINT64_C(0x9E3779B97F4A7C15);
+    key ^= key >> 33;
+    key *= UINT64_C(0xff51afd7ed558ccd);
+    key ^= key >> 33;
+    key *= UINT64_C(0xc4ceb9fe1a85ec53);
+    key ^= key >> 33;
+    return key;
+}
+
+/* Returns 0 for extensions that can't be keys */
+static uint64_t
+ext_key(const char *psz_ext, size_t len)
+{
+    uint64_t key = 0;
+
+    if (len == 0 || len > 8)
+        return 0;
+    for (size_t i = 0; i < len; ++i)
+    {
+        unsigned char c = psz_ext[i];
+        if (c >= 'A' && c <= 'Z')
+            c += 'a' - 'A';
+        key |= (uint64_t) c << (8 * i);
+    }
+    return key;
+}
+
+static void
+ext_set_Delete(ext_set *p_set)
+{
+    if (!p_set)
+        return;
+    free(p_set->p_keys);
+    free(p_set->p_categories);
+    free(p_set->p_displacements);
+    free(p_set);
+}
+
+struct ext_bucket
+{
+    uint32_t index;
+    uint32_t count;
+    uint32_t first;
+};
+
+static int
+ext_bucket_cmp(const void *a, const void *b)
+{
+    const struct ext_bucket *p_a = a, *p_b = b;
+    return (p_b->count > p_a->count) - (p_b->count < p_a->count);
+}
+
+/* keys must be unique and non-zero */
+static ext_set *
+ext_set_Build(const uint64_t *p_keys, const uint8_t *p_categories, uint32_t count)
+{
+    ext_set *p_set = calloc(1, sizeof(*p_set));
+    uint32_t slots = 16;
+    while (slots < 2 * count)
+        slots *= 2;
+    uint32_t buckets = count > 0 ? count : 1;
+
+    struct ext_bucket *p_buckets = calloc(buckets, sizeof(*p_buckets));
+    uint32_t *p_order = malloc((count > 0 ? count : 1) * sizeof(*p_order));
+    uint32_t *p_tmp_slots = malloc(32 * sizeof(*p_tmp_slots));
+    if (p_set)
+        atomic_init(&p_set->refs, 1);
+    if (!p_set || !p_buckets || !p_order || !p_tmp_slots)
+        goto error;
+
+    p_set->p_keys = calloc(slots, sizeof(*p_set->p_keys));
+    p_set->p_categories = calloc(slots, sizeof(*p_set->p_categories));
+    p_set->p_displacements = calloc(buckets, sizeof(*p_set->p_displacements));
+    if (!p_set->p_keys || !p_set->p_categories || !p_set->p_displacements)
+        goto error;
+    p_set->buckets = buckets;
+    p_set->mask = slots - 1;
+
+    /* Group the keys by bucket */
+    for (uint32_t i = 0; i < buckets; ++i)
+        p_buckets[i].index = i;
+    for (uint32_t i = 0; i < count; ++i)
+        p_buckets[ext_hash(p_keys[i], 0) % buckets].count++;
+    uint32_t first = 0;
+    for (uint32_t i = 0; i < buckets; ++i)
+    {
+        p_buckets[i].first = first;
+        first += p_buckets[i].count;
+        p_buckets[i].count = 0;
+    }
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        struct ext_bucket *p_b = &p_buckets[ext_hash(p_keys[i], 0) % buckets];
+        p_order[p_b->first + p_b->count++] = i;
+    }
+
+    /* Place the biggest buckets first, while most slots are free */
+    qsort(p_buckets, buckets, sizeof(*p_buckets), ext_bucket_cmp);
+    for (uint32_t b = 0; b < buckets && p_buckets[b].count > 0; ++b)
+    {
+        const struct ext_bucket *p_b = &p_buckets[b];
+        uint32_t seed;
+
+        if (p_b->count > 32)
+            goto error;
+        for (seed = 1; seed != 0; ++seed)
+        {
+            uint32_t j;
+            for (j = 0; j < p_b->count; ++j)
+            {
+                uint32_t slot = ext_hash(p_keys[p_order[p_b->first + j]], seed)
+                              & p_set->mask;
+                bool b_used = p_set->p_keys[slot] != 0;
+                for (uint32_t k = 0; k < j && !b_used; ++k)
+                    b_used = p_tmp_slots[k] == slot;
+                if (b_used)
+                    break;
+                p_tmp_slots[j] = slot;
+            }
+            if (j == p_b->count)
+                break;
+        }
+        if (seed == 0)
+            goto error;
+
+        p_set->p_displacements[p_b->index] = seed;
+        for (uint32_t j = 0; j < p_b->count; ++j)
+        {
+            uint32_t key = p_order[p_b->first + j];
+            p_set->p_keys[p_tmp_slots[j]] = p_keys[key];
+            p_set->p_categories[p_tmp_slots[j]] = p_categories[key];
+        }
+    }
+
+    free(p_buckets);
+    free(p_order);
+    free(p_tmp_slots);
+    return p_set;
+
+error:
+    free(p_buckets);
+    free(p_order);
+    free(p_tmp_slots);
+    ext_set_Delete(p_set);
+    return NULL;
+}
+
+uint8_t
+ext_set_Lookup(const ext_set *p_set, const char *psz_name)
+{
+    const char *psz_dot = strrchr(psz_name, '.');
+    if (!psz_dot || psz_dot == psz_name)
+        return 0;
+
+    uint64_t key = ext_key(psz_dot + 1, strlen(psz_dot + 1));
+    if (key == 0)
+        return 0;
+
+    uint32_t seed = p_set->p_displacements[ext_hash(key, 0) % p_set->buckets];
+    uint32_t slot = ext_hash(key, seed) & p_set->mask;
+    return p_set->p_keys[slot] == key ? p_set->p_categories[slot] : 0;
+}
+
+
+ext_set *
+ext_set_New(const char *const *ppsz_exts, const uint8_t *p_categories,
+            unsigned count)
+{
+    uint64_t *p_keys = malloc((count > 0 ? count : 1) * sizeof(*p_keys));
+    uint8_t *p_cats = malloc((count > 0 ? count : 1) * sizeof(*p_cats));
+    uint32_t key_count = 0;
+    ext_set *p_set = NULL;
+
+    if (!p_keys || !p_cats)
+        goto end;
+
+    for (unsigned i = 0; i < count; ++i)
+    {
+        const char *psz_ext = ppsz_exts[i];
+        if (psz_ext[0] == '.')
+            psz_ext++;
+        uint64_t key = ext_key(psz_ext, strlen(psz_ext));
+        if (key == 0)
+            continue;
+
+        uint32_t j;
+        for (j = 0; j < key_count && p_keys[j] != key; ++j);
+        if (j == key_count)
+        {
+            p_keys[key_count] = key;
+            p_cats[key_count++] = 0;
+        }
+        p_cats[j] |= p_categories[i];
+    }
+    p_set = ext_set_Build(p_keys, p_cats, key_count);
+
+end:
+    free(p_keys);
+    free(p_cats);
+    return p_set;
+}
+
+void
+ext_set_Release(const ext_set *p_set)
+{
+    ext_set *p_mutable = (ext_set *) p_set;
+
+    if (p_mutable && atomic_fetch_sub(&p_mutable->refs, 1) == 1)
+        ext_set_Delete(p_mutable);
+}
+
+const ext_set *
+ext_set_GetDefault(void)
+{
+    pthread_mutex_lock(&default_lock);
+    ext_set *p_set = default_set;
+    if (p_set)
+        atomic_fetch_add(&p_set->refs, 1);
+    pthread_mutex_unlock(&default_lock);
+    return p_set;
+}
+
+void
+ext_set_SetDefault(ext_set *p_set)
+{
+    pthread_mutex_lock(&default_lock);
+    ext_set *p_old = default_set;
+    default_set = p_set;
+    pthread_mutex_unlock(&default_lock);
+
+    /* Freed once the running scans and watchers are done with it */
+    ext_set_Release(p_old);
+}
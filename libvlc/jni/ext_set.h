@@ -0,0 +1,53 @@
+/*****************************************************************************
+ * ext_set.h
+ *****************************************************************************
+ * Copyright © 2023 VLC authors, VideoLAN and VideoLabs
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef EXT_SET_H
+#define EXT_SET_H
+
+#include <stdint.h>
+
+/* Perfect hash set of file extensions, each with a mask of categories. Keys
+ * are the lower case extensions, without the dot, of up to 8 bytes. Built
+ * with hash and displace: a lookup is two hashes and one comparison.
+ *
+ * Read-only once built: lookups can be done from any thread. Sets are
+ * refcounted, so that the default set can be replaced while in use. */
+
+typedef struct ext_set ext_set;
+
+/* extensions may start with a dot, case is ignored. Duplicated extensions
+ * get the union of their categories, longer ones are ignored. Returns NULL
+ * on allocation failure. */
+ext_set *ext_set_New(const char *const *ppsz_exts, const uint8_t *p_categories,
+                     unsigned count);
+void ext_set_Release(const ext_set *p_set);
+
+/* Categories of the extension of the file name, 0 if not in the set */
+uint8_t ext_set_Lookup(const ext_set *p_set, const char *psz_name);
+
+/* Set shared by the scanner and the watcher, built from the Extensions of
+ * the Java side. Returns a reference to release with ext_set_Release(), or
+ * NULL until it is set. */
+const ext_set *ext_set_GetDefault(void);
+/* Takes ownership of p_set and replaces the default set: the previous one
+ * is freed once its last user releases it. */
+void ext_set_SetDefault(ext_set *p_set);
+
+#endif // EXT_SET_H
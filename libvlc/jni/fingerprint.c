@@ -0,0 +1,274 @@
+/*****************************************************************************
+ * fingerprint.c
+ *****************************************************************************
+ * Copyright © 2023 VLC authors, VideoLAN and VideoLabs
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "fingerprint.h"
+
+#define CHUNK_SIZE (64 * 1024)
+
+/* XXH64, see https://github.com/Cyan4973/xxHash */
+#define XXH_PRIME64_1 UINT64_C(0x9E3779B185EBCA87)
+#define XXH_PRIME64_2 UINT64_C(0xC2B2AE3D27D4EB4F)
+#define XXH_PRIME64_3 UINT64_C(0x165667B19E3779F9)
+#define XXH_PRIME64_4 UINT64_C(0x85EBCA77C2B2AE63)
+#define XXH_PRIME64_5 UINT64_C(0x27D4EB2F165667C5)
+
+struct xxh64
+{
+    uint64_t v[4];
+    uint64_t total;
+    uint8_t buf[32];
+    size_t buf_size;
+    uint64_t seed;
+};
+
+static inline uint64_t
+rotl64(uint64_t x, int r)
+{
+    return (x << r) | (x >> (64 - r));
+}
+
+static inline uint64_t
+read64(const uint8_t *p)
+{
+    /* little endian, whatever the host */
+    return (uint64_t) p[0] | (uint64_t) p[1] << 8 | (uint64_t) p[2] << 16
+         | (uint64_t) p[3] << 24 | (uint64_t) p[4] << 32
+         | (uint64_t) p[5] << 40 | (uint64_t) p[6] << 48
+         | (uint64_t) p[7] << 56;
+}
+
+static inline uint32_t
+read32(const uint8_t *p)
+{
+    return (uint32_t) p[0] | (uint32_t) p[1] << 8 | (uint32_t) p[2] << 16
+         | (uint32_t) p[3] << 24;
+}
+
+static inline uint64_t
+xxh64_round(uint64_t acc, uint64_t input)
+{
+    acc += input * XXH_PRIME64_2;
+    acc = rotl64(acc, 31);
+    return acc * XXH_PRIME64_1;
+}
+
+static inline uint64_t
+xxh64_merge(uint64_t acc, uint64_t val)
+{
+    acc ^= xxh64_round(0, val);
+    return acc * XXH_PRIME64_1 + XXH_PRIME64_4;
+}
+
+static void
+xxh64_init(struct xxh64 *p_st, uint64_t seed)
+{
+    memset(p_st, 0, sizeof(*p_st));
+    p_st->seed = seed;
+    p_st->v[0] = seed + XXH_PRIME64_1 + XXH_PRIME64_2;
+    p_st->v[1] = seed + XXH_PRIME64_2;
+    p_st->v[2] = seed;
+    p_st->v[3] = seed - XXH_PRIME64_1;
+}
+
+static void
+xxh64_update(struct xxh64 *p_st, const uint8_t *p, size_t len)
+{
+    p_st->total += len;
+
+    if (p_st->buf_size + len < 32)
+    {
+        memcpy(p_st->buf + p_st->buf_size, p, len);
+        p_st->buf_size += len;
+        return;
+    }
+    if (p_st->buf_size > 0)
+    {
+        size_t fill = 32 - p_st->buf_size;
+        memcpy(p_st->buf + p_st->buf_size, p, fill);
+        for (int i = 0; i < 4; ++i)
+            p_st->v[i] = xxh64_round(p_st->v[i], read64(p_st->buf + 8 * i));
+        p += fill;
+        len -= fill;
+        p_st->buf_size = 0;
+    }
+    for (; len >= 32; p += 32, len -= 32)
+        for (int i = 0; i < 4; ++i)
+            p_st->v[i] = xxh64_round(p_st->v[i], read64(p + 8 * i));
+    memcpy(p_st->buf, p, len);
+    p_st->buf_size = len;
+}
+
+static uint64_t
+xxh64_digest(const struct xxh64 *p_st)
+{
+    uint64_t h;
+
+    if (p_st->total >= 32)
+    {
+        h = rotl64(p_st->v[0], 1) + rotl64(p_st->v[1], 7)
+          + rotl64(p_st->v[2], 12) + rotl64(p_st->v[3], 18);
+        for (int i = 0; i < 4; ++i)
+            h = xxh64_merge(h, p_st->v[i]);
+    }
+    else
+        h = p_st->seed + XXH_PRIME64_5;
+    h += p_st->total;
+
+    const uint8_t *p = p_st->buf;
+    size_t len = p_st->buf_size;
+    for (; len >= 8; p += 8, len -= 8)
+    {
+        h ^= xxh64_round(0, read64(p));
+        h = rotl64(h, 27) * XXH_PRIME64_1 + XXH_PRIME64_4;
+    }
+    if (len >= 4)
+    {
+        h ^= (uint64_t) read32(p) * XXH_PRIME64_1;
+        h = rotl64(h, 23) * XXH_PRIME64_2 + XXH_PRIME64_3;
+        p += 4;
+        len -= 4;
+    }
+    for (; len > 0; ++p, --len)
+    {
+        h ^= *p * XXH_PRIME64_5;
+        h = rotl64(h, 11) * XXH_PRIME64_1;
+    }
+
+    h ^= h >> 33;
+    h *= XXH_PRIME64_2;
+    h ^= h >> 29;
+    h *= XXH_PRIME64_3;
+    h ^= h >> 32;
+    return h;
+}
+
+/* Read exactly len bytes at offset, retrying on short reads */
+static int
+pread_full(int fd, uint8_t *p_buf, size_t len, uint64_t offset)
+{
+    while (len > 0)
+    {
+        ssize_t ret = pread(fd, p_buf, len, offset);
+        if (ret < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            return -1;
+        }
+        if (ret == 0)
+            return -1;
+        p_buf += ret;
+        len -= ret;
+        offset += ret;
+    }
+    return 0;
+}
+
+static uint64_t
+osdb_sum(const uint8_t *p_buf, size_t len)
+{
+    uint64_t sum = 0;
+    size_t i;
+
+    for (i = 0; i + 8 <= len; i += 8)
+        sum += read64(p_buf + i);
+    if (i < len)
+    {
+        uint8_t last[8] = { 0 };
+        memcpy(last, p_buf + i, len - i);
+        sum += read64(last);
+    }
+    return sum;
+}
+
+int
+fingerprint_Compute(int fd, uint64_t offset, uint64_t size, unsigned samples,
+                    fingerprint *p_fp)
+{
+    uint8_t *p_buf = malloc(CHUNK_SIZE);
+    if (!p_buf)
+        return -1;
+
+    size_t chunk = size < CHUNK_SIZE ? size : CHUNK_SIZE;
+
+    p_fp->size = size;
+    p_fp->osdb_hash = size;
+    p_fp->sampled_hash = 0;
+
+    if (pread_full(fd, p_buf, chunk, offset) != 0)
+        goto error;
+    p_fp->osdb_hash += osdb_sum(p_buf, chunk);
+
+    if (pread_full(fd, p_buf, chunk, offset + size - chunk) != 0)
+        goto error;
+    p_fp->osdb_hash += osdb_sum(p_buf, chunk);
+
+    if (samples > 0)
+    {
+        struct xxh64 st;
+        xxh64_init(&st, size);
+
+        /* Blocks evenly spread from the head to the tail, the whole file if
+         * it is small enough */
+        uint64_t blocks = (size + CHUNK_SIZE - 1) / CHUNK_SIZE;
+        if (samples > blocks)
+            samples = blocks;
+        for (unsigned i = 0; i < samples; ++i)
+        {
+            uint64_t block = samples > 1 ? i * (blocks - 1) / (samples - 1) : 0;
+            uint64_t pos = block * CHUNK_SIZE;
+            size_t len = size - pos < CHUNK_SIZE ? size - pos : CHUNK_SIZE;
+
+            if (pread_full(fd, p_buf, len, offset + pos) != 0)
+                goto error;
+            xxh64_update(&st, p_buf, len);
+        }
+        p_fp->sampled_hash = xxh64_digest(&st);
+    }
+
+    free(p_buf);
+    return 0;
+
+error:
+    free(p_buf);
+    return -1;
+}
+
+int
+fingerprint_ComputePath(const char *path, unsigned samples, fingerprint *p_fp)
+{
+    struct stat st;
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd == -1)
+        return -1;
+
+    int ret = -1;
+    if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode))
+        ret = fingerprint_Compute(fd, 0, st.st_size, samples, p_fp);
+    close(fd);
+    return ret;
+}
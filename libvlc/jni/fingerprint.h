@@ -0,0 +1,49 @@
+/*****************************************************************************
+ * fingerprint.h
+ *****************************************************************************
+ * Copyright © 2023 VLC authors, VideoLAN and VideoLabs
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef FINGERPRINT_H
+#define FINGERPRINT_H
+
+#include <stdint.h>
+
+/* Content fingerprint of a file, or of the [offset, offset + size[ range of
+ * a file. All reads are done with pread(), so the same fd can be shared
+ * between threads. */
+
+typedef struct fingerprint
+{
+    uint64_t size;
+    /* OpenSubtitles hash: size + sum of the 64 bits words of the first and
+     * last 64 KiB */
+    uint64_t osdb_hash;
+    /* XXH64 of samples blocks spread over the file, 0 if not requested */
+    uint64_t sampled_hash;
+} fingerprint;
+
+/* Returns 0 on success, -1 on I/O error. samples is the number of 64 KiB
+ * blocks hashed for sampled_hash, 0 to skip it. */
+int fingerprint_Compute(int fd, uint64_t offset, uint64_t size,
+                        unsigned samples, fingerprint *p_fp);
+
+/* Same, opening and stat-ing path */
+int fingerprint_ComputePath(const char *path, unsigned samples,
+                            fingerprint *p_fp);
+
+#endif // FINGERPRINT_H
@@ -28,15 +28,23 @@ CLAZZ(VLCObject, "org/videolan/libvlc/VLCObject")
 CLAZZ(Media, "org/videolan/libvlc/Media")
 CLAZZ(Media_Track, "org/videolan/libvlc/interfaces/IMedia$Track")
 CLAZZ(Media_Slave, "org/videolan/libvlc/interfaces/IMedia$Slave")
+CLAZZ(MediaList, "org/videolan/libvlc/MediaList")
 CLAZZ(MediaPlayer, "org/videolan/libvlc/MediaPlayer")
 CLAZZ(MediaPlayer_Title, "org/videolan/libvlc/MediaPlayer$Title")
 CLAZZ(MediaPlayer_Chapter, "org/videolan/libvlc/MediaPlayer$Chapter")
 CLAZZ(MediaPlayer_Equalizer, "org/videolan/libvlc/MediaPlayer$Equalizer")
+CLAZZ(Thumbnailer_Request, "org/videolan/libvlc/Thumbnailer$Request")
+CLAZZ(PlaylistStore, "org/videolan/libvlc/PlaylistStore")
+CLAZZ(PlaylistStore_ProgressListener, "org/videolan/libvlc/PlaylistStore$ProgressListener")
 CLAZZ(MediaDiscoverer, "org/videolan/libvlc/MediaDiscoverer")
 CLAZZ(MediaDiscoverer_Description, "org/videolan/libvlc/MediaDiscoverer$Description")
 CLAZZ(RendererDiscoverer, "org/videolan/libvlc/RendererDiscoverer")
 CLAZZ(RendererDiscoverer_Description, "org/videolan/libvlc/RendererDiscoverer$Description")
 CLAZZ(Dialog, "org/videolan/libvlc/Dialog")
+CLAZZ(DirectoryScanner, "org/videolan/libvlc/util/DirectoryScanner")
+CLAZZ(DirectoryWatcher, "org/videolan/libvlc/util/DirectoryWatcher")
+CLAZZ(SubtitleIndex, "org/videolan/libvlc/util/SubtitleIndex")
+CLAZZ(SubtitleIndex_Match, "org/videolan/libvlc/util/SubtitleIndex$Match")
 
 FIELD(FileDescriptor, descriptor, "I")
 
@@ -65,14 +73,30 @@ METHOD(Media, createSlaveFromNative, GetStaticMethodID,
 METHOD(Media, createStatsFromNative, GetStaticMethodID,
     "(JFJFJJJJJJJJJJF)"
     "Lorg/videolan/libvlc/interfaces/IMedia$Stats;")
+METHOD(Media, createProbeResultFromNative, GetStaticMethodID,
+    "(IJIIIIJJ)"
+    "Lorg/videolan/libvlc/interfaces/IMedia$ProbeResult;")
+
+METHOD(MediaList, createSnapshotFromNative, GetStaticMethodID,
+    "([Ljava/lang/String;[I[J[Ljava/lang/String;[Ljava/lang/String;"
+    "[Ljava/lang/String;[Ljava/lang/String;)"
+    "Lorg/videolan/libvlc/MediaList$Snapshot;")
 
 METHOD(MediaPlayer, createTitleFromNative, GetStaticMethodID,
     "(JLjava/lang/String;I)Lorg/videolan/libvlc/MediaPlayer$Title;")
 METHOD(MediaPlayer, createChapterFromNative, GetStaticMethodID,
     "(JJLjava/lang/String;)Lorg/videolan/libvlc/MediaPlayer$Chapter;")
+METHOD(MediaPlayer, createStatsSeriesFromNative, GetStaticMethodID,
+    "([J[F[F[F[F[F[F[F)Lorg/videolan/libvlc/MediaPlayer$StatsSeries;")
+METHOD(MediaPlayer, onCommandDoneFromNative, GetMethodID, "(JIJJ)V")
 
 FIELD(MediaPlayer_Equalizer, mInstance, "J")
 
+FIELD(Thumbnailer_Request, mInstance, "J")
+
+FIELD(PlaylistStore, mInstance, "J")
+METHOD(PlaylistStore_ProgressListener, onProgress, GetMethodID, "(IJJ)Z")
+
 METHOD(MediaDiscoverer, createDescriptionFromNative, GetStaticMethodID,
     "(Ljava/lang/String;Ljava/lang/String;I)"
     "Lorg/videolan/libvlc/MediaDiscoverer$Description;")
@@ -100,3 +124,14 @@ METHOD(Dialog, cancelFromNative, GetStaticMethodID,
     "(Lorg/videolan/libvlc/Dialog;)V")
 METHOD(Dialog, updateProgressFromNative, GetStaticMethodID,
     "(Lorg/videolan/libvlc/Dialog;FLjava/lang/String;)V")
+
+METHOD(DirectoryScanner, createResultFromNative, GetStaticMethodID,
+    "([B[I[J[J[BIJ)Lorg/videolan/libvlc/util/DirectoryScanner$Result;")
+
+FIELD(DirectoryWatcher, mInstance, "J")
+METHOD(DirectoryWatcher, onChangesFromNative, GetMethodID,
+    "([I[Ljava/lang/String;[Ljava/lang/String;[BZ)V")
+
+FIELD(SubtitleIndex, mInstance, "J")
+METHOD(SubtitleIndex, createMatchFromNative, GetStaticMethodID,
+    "(Ljava/lang/String;I)Lorg/videolan/libvlc/util/SubtitleIndex$Match;")
@@ -18,12 +18,21 @@
  * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
  *****************************************************************************/
 
+#include <limits.h>
+#include <stdatomic.h>
 #include <stdlib.h>
 #include <pthread.h>
+#include <string.h>
+#include <fcntl.h>
+#include <time.h>
 #include <unistd.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
 
 #include "libvlcjni-vlcobject.h"
 #include "utils.h"
+#include "fingerprint.h"
 
 #define META_MAX 25
 
@@ -35,17 +44,76 @@ struct media_cb
     uint64_t offset;
 };
 
-struct vlcjni_object_sys
+struct media_buffer_cb
+{
+    const uint8_t *p_data;
+    uint64_t size;
+    uint64_t offset;
+};
+
+/* Ring buffer filled by a Java DataSource feeder thread and drained by the
+ * libvlc input thread. Positions are absolute counters since the last seek. */
+struct media_ring
 {
     pthread_mutex_t lock;
-    pthread_cond_t  wait;
-    bool b_parsing_sync;
-    bool b_parsing_async;
+    pthread_cond_t  data_cond;
+    pthread_cond_t  request_cond;
+    unsigned refs;
+
+    uint8_t *p_buf;
+    size_t capacity;
+    uint64_t read_pos;
+    uint64_t write_pos;
+    uint64_t size;
+
+    bool b_reader;
+    bool b_eof;
+    bool b_error;
+    bool b_closed;
+
+    /* seek requested by the reader and not yet applied by the feeder */
+    unsigned seek_gen;
+    unsigned feed_gen;
+    uint64_t seek_offset;
+
+    struct {
+        uint64_t written;
+        uint64_t read;
+        uint64_t underruns;
+        uint64_t backpressure;
+        uint64_t seeks;
+    } stats;
+};
+
+/* The parse state is a single word holding a generation counter and one of
+ * the PARSE_ states. Each ParsedChanged event ends the current generation, so
+ * that waiters can sleep on the word with a futex. PARSE_STARTING is set
+ * while the libvlc request of the generation is being issued: nobody can
+ * join a request that may still fail. */
+#define PARSE_IDLE  0
+#define PARSE_SYNC  1
+#define PARSE_ASYNC 2
+#define PARSE_DONE  3
+#define PARSE_STARTING 4u
+#define PARSE_STATE(v) ((v) & 3u)
+#define PARSE_GEN(v) ((v) >> 3)
+#define PARSE_VALUE(gen, state) (((gen) << 3) | (state))
+
+struct vlcjni_object_sys
+{
+    atomic_uint parse_state;
     struct {
         int fd;
         uint64_t offset;
         uint64_t length;
+        bool b_owned; /* fd is a dup() closed with the media */
     } media_cb;
+    struct {
+        jobject jbuffer;
+        const uint8_t *p_data;
+        uint64_t size;
+    } media_buffer;
+    struct media_ring *p_ring;
 };
 static const libvlc_event_type_t m_events[] = {
     libvlc_MediaMetaChanged,
@@ -57,33 +125,102 @@ static const libvlc_event_type_t m_events[] = {
     -1,
 };
 
+static void
+Media_parseWake(atomic_uint *p_state)
+{
+    syscall(SYS_futex, p_state, FUTEX_WAKE_PRIVATE, INT_MAX, NULL, NULL, 0);
+}
+
+/* Wait for the end of the generation gen. Returns false if the parse request
+ * of this generation could not be started. */
+static bool
+Media_parseWait(atomic_uint *p_state, unsigned gen)
+{
+    unsigned state;
+
+    while (PARSE_GEN(state = atomic_load(p_state)) == gen)
+        syscall(SYS_futex, p_state, FUTEX_WAIT_PRIVATE, state, NULL, NULL, 0);
+    return PARSE_STATE(state) != PARSE_IDLE;
+}
+
+/* Start a parse request, or join the one in progress: concurrent callers are
+ * coalesced into a single libvlc request. An asynchronous caller joining a
+ * synchronous parse upgrades it so that ParsedChanged is dispatched. */
+static bool
+Media_parseStart(vlcjni_object *p_obj, bool b_async, int flags, int timeout,
+                 unsigned *p_gen)
+{
+    atomic_uint *p_state = &p_obj->p_sys->parse_state;
+    unsigned state = atomic_load(p_state);
+
+    for (;;)
+    {
+        unsigned gen = PARSE_GEN(state);
+
+        if (state & PARSE_STARTING)
+        {
+            /* Join or retry once the request is known to be started */
+            syscall(SYS_futex, p_state, FUTEX_WAIT_PRIVATE, state, NULL, NULL, 0);
+            state = atomic_load(p_state);
+            continue;
+        }
+
+        switch (PARSE_STATE(state))
+        {
+            case PARSE_SYNC:
+                if (b_async
+                 && !atomic_compare_exchange_weak(p_state, &state,
+                                                  PARSE_VALUE(gen, PARSE_ASYNC)))
+                    continue;
+                /* fall through */
+            case PARSE_ASYNC:
+                *p_gen = gen;
+                return true;
+            default:
+                if (!atomic_compare_exchange_weak(p_state, &state,
+                        PARSE_VALUE(gen, b_async ? PARSE_ASYNC : PARSE_SYNC)
+                        | PARSE_STARTING))
+                    continue;
+                *p_gen = gen;
+                if (libvlc_media_parse_request(p_obj->p_libvlc, p_obj->u.p_m,
+                                               flags, timeout) == 0)
+                {
+                    /* The generation may already be over if the event came
+                     * first, clearing the flag is harmless then */
+                    atomic_fetch_and(p_state, ~PARSE_STARTING);
+                    Media_parseWake(p_state);
+                    return true;
+                }
+
+                /* No event will come: end the generation here */
+                atomic_store(p_state, PARSE_VALUE(gen + 1, PARSE_IDLE));
+                Media_parseWake(p_state);
+                return false;
+        }
+    }
+}
+
 static bool
 Media_event_cb(vlcjni_object *p_obj, const libvlc_event_t *p_ev,
                java_event *p_java_event)
 {
-    vlcjni_object_sys *p_sys = p_obj->p_sys;
-    bool b_dispatch = true;
-
-    pthread_mutex_lock(&p_sys->lock);
+    atomic_uint *p_state = &p_obj->p_sys->parse_state;
+    unsigned state = atomic_load(p_state);
 
     if (p_ev->type == libvlc_MediaParsedChanged)
     {
-        /* no need to send libvlc_MediaParsedChanged when parsing is synchronous */
-        if (p_sys->b_parsing_sync)
-            b_dispatch = false;
+        while (!atomic_compare_exchange_weak(p_state, &state,
+                    PARSE_VALUE(PARSE_GEN(state) + 1, PARSE_DONE)));
+        Media_parseWake(p_state);
 
-        p_sys->b_parsing_sync = false;
-        p_sys->b_parsing_async = false;
-        pthread_cond_signal(&p_sys->wait);
+        /* no need to send libvlc_MediaParsedChanged when parsing is synchronous */
+        if (PARSE_STATE(state) == PARSE_SYNC)
+            return false;
     }
-
     /* bypass all others events while parsing, since we'll fetch alls info when
      * parsing is done */
-    if (p_sys->b_parsing_sync || p_sys->b_parsing_async)
-        b_dispatch = false;
-    pthread_mutex_unlock(&p_sys->lock);
-
-    if (!b_dispatch)
+    else if (PARSE_STATE(state) == PARSE_SYNC
+          || PARSE_STATE(state) == PARSE_ASYNC)
         return false;
 
     switch (p_ev->type)
@@ -122,8 +259,7 @@ Media_nativeNewCommon(JNIEnv *env, jobject thiz, vlcjni_object *p_obj)
         return -1;
     }
 
-    pthread_mutex_init(&p_obj->p_sys->lock, NULL);
-    pthread_cond_init(&p_obj->p_sys->wait, NULL);
+    atomic_init(&p_obj->p_sys->parse_state, PARSE_VALUE(0u, PARSE_IDLE));
     p_obj->p_sys->media_cb.fd = -1;
 
     VLCJniObject_attachEvents(p_obj, Media_event_cb,
@@ -175,6 +311,216 @@ Java_org_videolan_libvlc_Media_nativeNewFromLocation(JNIEnv *env, jobject thiz,
                           libvlc_media_new_location);
 }
 
+/* Create the media, add options and slaves and start parsing in a single JNI
+ * call. jslaveInfos holds a (type, priority) pair for each slave uri, and
+ * jparsing[0] is set if the parsing was started. Returns the mrl of the new
+ * media. */
+jstring
+Java_org_videolan_libvlc_Media_nativeNewFromBuilder(JNIEnv *env, jobject thiz,
+                                                    jobject libVlc,
+                                                    jstring jlocation,
+                                                    jboolean isPath,
+                                                    jobjectArray joptions,
+                                                    jintArray jslaveInfos,
+                                                    jobjectArray jslaveUris,
+                                                    jint parseFlags,
+                                                    jint parseTimeout,
+                                                    jbooleanArray jparsing)
+{
+    vlcjni_object *p_obj;
+    const char *psz_location;
+    jsize i_slaves = jslaveUris ? (*env)->GetArrayLength(env, jslaveUris) : 0;
+
+    if (i_slaves > 0 && (!jslaveInfos
+     || (*env)->GetArrayLength(env, jslaveInfos) < 2 * i_slaves))
+    {
+        throw_Exception(env, VLCJNI_EX_ILLEGAL_ARGUMENT, "slaves invalid");
+        return NULL;
+    }
+
+    if (!jlocation
+     || !(psz_location = (*env)->GetStringUTFChars(env, jlocation, 0)))
+    {
+        throw_Exception(env, VLCJNI_EX_ILLEGAL_ARGUMENT, "path or location invalid");
+        return NULL;
+    }
+
+    p_obj = VLCJniObject_newFromJavaLibVlc(env, thiz, libVlc);
+    if (!p_obj)
+    {
+        (*env)->ReleaseStringUTFChars(env, jlocation, psz_location);
+        return NULL;
+    }
+
+    p_obj->u.p_m = isPath ? libvlc_media_new_path(psz_location)
+                          : libvlc_media_new_location(psz_location);
+    (*env)->ReleaseStringUTFChars(env, jlocation, psz_location);
+
+    if (Media_nativeNewCommon(env, thiz, p_obj) != 0)
+        return NULL;
+
+    jsize i_options = joptions ? (*env)->GetArrayLength(env, joptions) : 0;
+    for (jsize i = 0; i < i_options; ++i)
+    {
+        jstring joption = (*env)->GetObjectArrayElement(env, joptions, i);
+        const char *psz_option = joption
+            ? (*env)->GetStringUTFChars(env, joption, 0) : NULL;
+        if (psz_option)
+        {
+            libvlc_media_add_option(p_obj->u.p_m, psz_option);
+            (*env)->ReleaseStringUTFChars(env, joption, psz_option);
+        }
+        if (joption)
+            (*env)->DeleteLocalRef(env, joption);
+    }
+
+    if (i_slaves > 0)
+    {
+        jint *p_infos = (*env)->GetIntArrayElements(env, jslaveInfos, NULL);
+        if (!p_infos)
+            return NULL;
+        for (jsize i = 0; i < i_slaves; ++i)
+        {
+            jstring juri = (*env)->GetObjectArrayElement(env, jslaveUris, i);
+            const char *psz_uri = juri
+                ? (*env)->GetStringUTFChars(env, juri, 0) : NULL;
+            if (psz_uri)
+            {
+                libvlc_media_slaves_add(p_obj->u.p_m, p_infos[2 * i],
+                                        p_infos[2 * i + 1], psz_uri);
+                (*env)->ReleaseStringUTFChars(env, juri, psz_uri);
+            }
+            if (juri)
+                (*env)->DeleteLocalRef(env, juri);
+        }
+        (*env)->ReleaseIntArrayElements(env, jslaveInfos, p_infos, JNI_ABORT);
+    }
+
+    /* Negative flags: don't parse */
+    if (parseFlags >= 0)
+    {
+        unsigned gen;
+        jboolean parsing = Media_parseStart(p_obj, true, parseFlags,
+                                            parseTimeout, &gen);
+        if (jparsing && (*env)->GetArrayLength(env, jparsing) > 0)
+            (*env)->SetBooleanArrayRegion(env, jparsing, 0, 1, &parsing);
+    }
+
+    jstring jmrl = NULL;
+    char *psz_mrl = libvlc_media_get_mrl(p_obj->u.p_m);
+    if (psz_mrl)
+    {
+        jmrl = vlcNewStringUTF(env, psz_mrl);
+        free(psz_mrl);
+    }
+    return jmrl;
+}
+
+/* Create a Media wrapper for a libvlc_media_t created by
+ * MediaBatch_nativeNew(): events are only attached at this point. */
+void
+Java_org_videolan_libvlc_Media_nativeNewFromHandle(JNIEnv *env, jobject thiz,
+                                                   jobject libVlc, jlong handle)
+{
+    libvlc_media_t *p_m = (libvlc_media_t *)(intptr_t) handle;
+    vlcjni_object *p_obj;
+
+    if (!p_m)
+    {
+        throw_Exception(env, VLCJNI_EX_ILLEGAL_ARGUMENT, "handle invalid");
+        return;
+    }
+
+    p_obj = VLCJniObject_newFromJavaLibVlc(env, thiz, libVlc);
+    if (!p_obj)
+        return;
+
+    p_obj->u.p_m = libvlc_media_retain(p_m);
+    Media_nativeNewCommon(env, thiz, p_obj);
+}
+
+/* Create one libvlc_media_t per location, without any Java or event wrapper.
+ * Returns the handles, 0 for locations that failed. */
+jlongArray
+Java_org_videolan_libvlc_MediaBatch_nativeNew(JNIEnv *env, jclass clazz,
+                                              jobjectArray jlocations,
+                                              jboolean isPath)
+{
+    if (!jlocations)
+    {
+        throw_Exception(env, VLCJNI_EX_ILLEGAL_ARGUMENT, "locations invalid");
+        return NULL;
+    }
+
+    jsize count = (*env)->GetArrayLength(env, jlocations);
+    jlongArray jhandles = (*env)->NewLongArray(env, count);
+    jlong *p_handles = jhandles
+        ? (*env)->GetLongArrayElements(env, jhandles, NULL) : NULL;
+    if (!p_handles)
+    {
+        throw_Exception(env, VLCJNI_EX_OUT_OF_MEMORY, "media handles");
+        return NULL;
+    }
+
+    for (jsize i = 0; i < count; ++i)
+    {
+        libvlc_media_t *p_m = NULL;
+        jstring jlocation = (*env)->GetObjectArrayElement(env, jlocations, i);
+        const char *psz_location = jlocation
+            ? (*env)->GetStringUTFChars(env, jlocation, 0) : NULL;
+
+        if (psz_location)
+        {
+            p_m = isPath ? libvlc_media_new_path(psz_location)
+                         : libvlc_media_new_location(psz_location);
+            (*env)->ReleaseStringUTFChars(env, jlocation, psz_location);
+        }
+        if (jlocation)
+            (*env)->DeleteLocalRef(env, jlocation);
+
+        p_handles[i] = (jlong)(intptr_t) p_m;
+    }
+
+    (*env)->ReleaseLongArrayElements(env, jhandles, p_handles, 0);
+    return jhandles;
+}
+
+jstring
+Java_org_videolan_libvlc_MediaBatch_nativeGetMrl(JNIEnv *env, jclass clazz,
+                                                 jlong handle)
+{
+    libvlc_media_t *p_m = (libvlc_media_t *)(intptr_t) handle;
+    jstring jmrl = NULL;
+
+    if (!p_m)
+        return NULL;
+
+    char *psz_mrl = libvlc_media_get_mrl(p_m);
+    if (psz_mrl)
+    {
+        jmrl = vlcNewStringUTF(env, psz_mrl);
+        free(psz_mrl);
+    }
+    return jmrl;
+}
+
+void
+Java_org_videolan_libvlc_MediaBatch_nativeRelease(JNIEnv *env, jclass clazz,
+                                                  jlongArray jhandles)
+{
+    jsize count = (*env)->GetArrayLength(env, jhandles);
+    jlong *p_handles = (*env)->GetLongArrayElements(env, jhandles, NULL);
+
+    if (!p_handles)
+        return;
+
+    for (jsize i = 0; i < count; ++i)
+        if (p_handles[i])
+            libvlc_media_release((libvlc_media_t *)(intptr_t) p_handles[i]);
+
+    (*env)->ReleaseLongArrayElements(env, jhandles, p_handles, JNI_ABORT);
+}
+
 static int
 FDObject_getInt(JNIEnv *env, jobject jfd)
 {
@@ -208,7 +554,15 @@ Java_org_videolan_libvlc_Media_nativeNewFromFd(JNIEnv *env, jobject thiz,
 
     p_obj->u.p_m = libvlc_media_new_fd(fd);
 
-    Media_nativeNewCommon(env, thiz, p_obj);
+    if (Media_nativeNewCommon(env, thiz, p_obj) == 0)
+    {
+        /* libvlc doesn't expose its fd: keep one for nativeFingerprint() */
+        vlcjni_object_sys *p_sys = p_obj->p_sys;
+        p_sys->media_cb.fd = dup(fd);
+        p_sys->media_cb.offset = 0;
+        p_sys->media_cb.length = UINT64_MAX;
+        p_sys->media_cb.b_owned = p_sys->media_cb.fd != -1;
+    }
 }
 
 static int
@@ -279,6 +633,200 @@ media_cb_close(void *opaque)
     free(mcb);
 }
 
+/* Header-only probe: the media reads the file through these callbacks, that
+ * fail once the byte budget is spent. */
+struct media_probe
+{
+    pthread_mutex_t lock;
+    pthread_cond_t wait;
+    bool b_done;
+    int status;
+
+    int fd;
+    uint64_t size;
+    uint64_t offset;
+    uint64_t budget;
+    uint64_t bytes_read;
+};
+
+static int
+media_probe_open(void *opaque, void **datap, uint64_t *sizep)
+{
+    struct media_probe *p_probe = opaque;
+
+    p_probe->offset = 0;
+    *sizep = p_probe->size;
+    *datap = p_probe;
+    return 0;
+}
+
+static ssize_t
+media_probe_read(void *opaque, unsigned char *buf, size_t len)
+{
+    struct media_probe *p_probe = opaque;
+
+    if (p_probe->bytes_read >= p_probe->budget)
+        return -1;
+    if (p_probe->offset >= p_probe->size)
+        return 0;
+    if (len > p_probe->budget - p_probe->bytes_read)
+        len = p_probe->budget - p_probe->bytes_read;
+    if (len > p_probe->size - p_probe->offset)
+        len = p_probe->size - p_probe->offset;
+
+    ssize_t ret = pread(p_probe->fd, buf, len, p_probe->offset);
+    if (ret > 0)
+    {
+        p_probe->offset += ret;
+        p_probe->bytes_read += ret;
+    }
+    return ret;
+}
+
+static int
+media_probe_seek(void *opaque, uint64_t offset)
+{
+    struct media_probe *p_probe = opaque;
+
+    p_probe->offset = offset;
+    return 0;
+}
+
+static void
+media_probe_close(void *opaque)
+{
+    (void) opaque;
+}
+
+static void
+media_probe_event_cb(const libvlc_event_t *p_ev, void *data)
+{
+    struct media_probe *p_probe = data;
+
+    pthread_mutex_lock(&p_probe->lock);
+    p_probe->status = p_ev->u.media_parsed_changed.new_status;
+    p_probe->b_done = true;
+    pthread_cond_signal(&p_probe->wait);
+    pthread_mutex_unlock(&p_probe->lock);
+}
+
+static int
+media_probe_count_tracks(libvlc_media_t *p_m, libvlc_track_type_t type)
+{
+    libvlc_media_tracklist_t *p_list = libvlc_media_get_tracklist(p_m, type);
+    if (!p_list)
+        return 0;
+    int count = libvlc_media_tracklist_count(p_list);
+    libvlc_media_tracklist_delete(p_list);
+    return count;
+}
+
+/* Open the file with a byte budget, parse it locally without fetching art
+ * nor subitems, and return a ProbeResult. */
+jobject
+Java_org_videolan_libvlc_Media_nativeProbe(JNIEnv *env, jclass clazz,
+                                           jobject libVlc, jstring jpath,
+                                           jobject jfd, jlong budget,
+                                           jint timeout)
+{
+    vlcjni_object *p_lib_obj = VLCJniObject_getInstance(env, libVlc);
+    struct media_probe probe = {
+        .status = libvlc_media_parsed_status_failed,
+        .budget = budget > 0 ? budget : UINT64_MAX,
+    };
+    struct stat st;
+    jlong duration = -1;
+    int type = libvlc_media_type_unknown;
+    int audio = 0, video = 0, spu = 0;
+    bool b_close = false;
+
+    if (!p_lib_obj)
+        return NULL;
+
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    if (jpath)
+    {
+        const char *psz_path = (*env)->GetStringUTFChars(env, jpath, 0);
+        if (!psz_path)
+        {
+            throw_Exception(env, VLCJNI_EX_ILLEGAL_ARGUMENT, "path invalid");
+            return NULL;
+        }
+        probe.fd = open(psz_path, O_RDONLY | O_CLOEXEC);
+        (*env)->ReleaseStringUTFChars(env, jpath, psz_path);
+        b_close = true;
+    }
+    else
+    {
+        probe.fd = FDObject_getInt(env, jfd);
+        if (probe.fd == -1)
+            return NULL;
+    }
+
+    if (probe.fd == -1 || fstat(probe.fd, &st) != 0 || !S_ISREG(st.st_mode))
+        goto end;
+    probe.size = st.st_size;
+
+    libvlc_media_t *p_m = libvlc_media_new_callbacks(media_probe_open,
+                                                     media_probe_read,
+                                                     media_probe_seek,
+                                                     media_probe_close,
+                                                     &probe);
+    if (!p_m)
+        goto end;
+
+    libvlc_media_add_option(p_m, ":no-sub-autodetect-file");
+    pthread_mutex_init(&probe.lock, NULL);
+    pthread_cond_init(&probe.wait, NULL);
+
+    if (libvlc_event_attach(libvlc_media_event_manager(p_m),
+                            libvlc_MediaParsedChanged,
+                            media_probe_event_cb, &probe) == 0)
+    {
+        if (libvlc_media_parse_request(p_lib_obj->u.p_libvlc, p_m,
+                                       libvlc_media_parse_local
+                                       | libvlc_media_parse_forced,
+                                       timeout) == 0)
+        {
+            pthread_mutex_lock(&probe.lock);
+            while (!probe.b_done)
+                pthread_cond_wait(&probe.wait, &probe.lock);
+            pthread_mutex_unlock(&probe.lock);
+
+            if (probe.status == libvlc_media_parsed_status_done)
+            {
+                duration = libvlc_media_get_duration(p_m);
+                /* The media is read through callbacks, but it is a file */
+                type = libvlc_media_type_file;
+                audio = media_probe_count_tracks(p_m, libvlc_track_audio);
+                video = media_probe_count_tracks(p_m, libvlc_track_video);
+                spu = media_probe_count_tracks(p_m, libvlc_track_text);
+            }
+        }
+        libvlc_event_detach(libvlc_media_event_manager(p_m),
+                            libvlc_MediaParsedChanged,
+                            media_probe_event_cb, &probe);
+    }
+    libvlc_media_release(p_m);
+    pthread_mutex_destroy(&probe.lock);
+    pthread_cond_destroy(&probe.wait);
+
+end:
+    if (b_close && probe.fd != -1)
+        close(probe.fd);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    jlong elapsed = (end.tv_sec - start.tv_sec) * INT64_C(1000)
+                  + (end.tv_nsec - start.tv_nsec) / 1000000;
+
+    return (*env)->CallStaticObjectMethod(env, fields.Media_clazz,
+                                          fields.Media_createProbeResultFromNative,
+                                          probe.status, duration, type, audio,
+                                          video, spu, (jlong) probe.bytes_read,
+                                          elapsed);
+}
+
 void
 Java_org_videolan_libvlc_Media_nativeNewFromFdWithOffsetLength(
     JNIEnv *env, jobject thiz, jobject libVlc, jobject jfd, jlong offset, jlong length)
@@ -309,6 +857,462 @@ Java_org_videolan_libvlc_Media_nativeNewFromFdWithOffsetLength(
     }
 }
 
+static int
+media_buffer_cb_open(void *opaque, void **datap, uint64_t *sizep)
+{
+    vlcjni_object *p_obj = opaque;
+    vlcjni_object_sys *p_sys = p_obj->p_sys;
+
+    struct media_buffer_cb *mbcb = malloc(sizeof(*mbcb));
+    if (!mbcb)
+        return -1;
+
+    mbcb->p_data = p_sys->media_buffer.p_data;
+    mbcb->size = p_sys->media_buffer.size;
+    mbcb->offset = 0;
+
+    *sizep = mbcb->size;
+    *datap = mbcb;
+    return 0;
+}
+
+static ssize_t
+media_buffer_cb_read(void *opaque, unsigned char *buf, size_t len)
+{
+    struct media_buffer_cb *mbcb = opaque;
+    uint64_t remaining = mbcb->size - mbcb->offset;
+
+    if (len > remaining)
+        len = remaining;
+    if (len == 0)
+        return 0;
+
+    memcpy(buf, mbcb->p_data + mbcb->offset, len);
+    mbcb->offset += len;
+    return len;
+}
+
+static int
+media_buffer_cb_seek(void *opaque, uint64_t offset)
+{
+    struct media_buffer_cb *mbcb = opaque;
+    if (offset > mbcb->size)
+        return -1;
+    mbcb->offset = offset;
+    return 0;
+}
+
+static void
+media_buffer_cb_close(void *opaque)
+{
+    free(opaque);
+}
+
+void
+Java_org_videolan_libvlc_Media_nativeNewFromByteBuffer(
+    JNIEnv *env, jobject thiz, jobject libVlc, jobject jbuffer, jlong offset, jlong length)
+{
+    vlcjni_object *p_obj;
+    const uint8_t *p_data;
+    jlong capacity;
+
+    if (!jbuffer
+     || !(p_data = (*env)->GetDirectBufferAddress(env, jbuffer))
+     || (capacity = (*env)->GetDirectBufferCapacity(env, jbuffer)) < 0)
+    {
+        throw_Exception(env, VLCJNI_EX_ILLEGAL_ARGUMENT, "buffer is not direct");
+        return;
+    }
+    if (offset < 0 || length < 0 || offset > capacity || length > capacity - offset)
+    {
+        throw_Exception(env, VLCJNI_EX_ILLEGAL_ARGUMENT, "offset or length invalid");
+        return;
+    }
+
+    p_obj = VLCJniObject_newFromJavaLibVlc(env, thiz, libVlc);
+    if (!p_obj)
+        return;
+
+    p_obj->u.p_m =
+        libvlc_media_new_callbacks(media_buffer_cb_open,
+                                   media_buffer_cb_read,
+                                   media_buffer_cb_seek,
+                                   media_buffer_cb_close,
+                                   p_obj);
+
+    if (Media_nativeNewCommon(env, thiz, p_obj) == 0)
+    {
+        vlcjni_object_sys *p_sys = p_obj->p_sys;
+
+        /* Keep the buffer alive, and its address valid, as long as the media */
+        p_sys->media_buffer.jbuffer = (*env)->NewGlobalRef(env, jbuffer);
+        p_sys->media_buffer.p_data = p_data + offset;
+        p_sys->media_buffer.size = length;
+    }
+}
+
+#define SOURCE_REQUEST_FILL (-1)
+#define SOURCE_REQUEST_CLOSED (-2)
+
+#define SOURCE_WRITE_EOF (-1)
+#define SOURCE_WRITE_ERROR (-2)
+
+static void
+media_ring_release(struct media_ring *p_ring)
+{
+    pthread_mutex_lock(&p_ring->lock);
+    bool b_last = --p_ring->refs == 0;
+    pthread_mutex_unlock(&p_ring->lock);
+
+    if (!b_last)
+        return;
+    pthread_mutex_destroy(&p_ring->lock);
+    pthread_cond_destroy(&p_ring->data_cond);
+    pthread_cond_destroy(&p_ring->request_cond);
+    free(p_ring->p_buf);
+    free(p_ring);
+}
+
+/* Must be called locked: drop buffered data and ask the feeder to seek */
+static void
+media_ring_reset(struct media_ring *p_ring, uint64_t offset)
+{
+    p_ring->read_pos = p_ring->write_pos = 0;
+    p_ring->b_eof = p_ring->b_error = false;
+    p_ring->seek_offset = offset;
+    p_ring->seek_gen++;
+    pthread_cond_signal(&p_ring->request_cond);
+}
+
+static int
+media_ring_cb_open(void *opaque, void **datap, uint64_t *sizep)
+{
+    vlcjni_object *p_obj = opaque;
+    struct media_ring *p_ring = p_obj->p_sys->p_ring;
+
+    pthread_mutex_lock(&p_ring->lock);
+    /* Only one input can read from the source at a time */
+    if (p_ring->b_reader || p_ring->b_closed)
+    {
+        pthread_mutex_unlock(&p_ring->lock);
+        return -1;
+    }
+    p_ring->b_reader = true;
+    p_ring->refs++;
+    media_ring_reset(p_ring, 0);
+    pthread_mutex_unlock(&p_ring->lock);
+
+    *sizep = p_ring->size;
+    *datap = p_ring;
+    return 0;
+}
+
+static ssize_t
+media_ring_cb_read(void *opaque, unsigned char *buf, size_t len)
+{
+    struct media_ring *p_ring = opaque;
+    ssize_t ret;
+
+    pthread_mutex_lock(&p_ring->lock);
+    if (p_ring->read_pos == p_ring->write_pos
+     && !p_ring->b_eof && !p_ring->b_error && !p_ring->b_closed)
+    {
+        p_ring->stats.underruns++;
+        do
+            pthread_cond_wait(&p_ring->data_cond, &p_ring->lock);
+        while (p_ring->read_pos == p_ring->write_pos
+            && !p_ring->b_eof && !p_ring->b_error && !p_ring->b_closed);
+    }
+
+    size_t avail = p_ring->write_pos - p_ring->read_pos;
+    if (avail == 0)
+        ret = p_ring->b_error || p_ring->b_closed ? -1 : 0;
+    else
+    {
+        if (len > avail)
+            len = avail;
+
+        size_t start = p_ring->read_pos % p_ring->capacity;
+        size_t first = p_ring->capacity - start;
+        if (first > len)
+            first = len;
+        memcpy(buf, p_ring->p_buf + start, first);
+        memcpy(buf + first, p_ring->p_buf, len - first);
+
+        p_ring->read_pos += len;
+        p_ring->stats.read += len;
+        pthread_cond_signal(&p_ring->request_cond);
+        ret = len;
+    }
+    pthread_mutex_unlock(&p_ring->lock);
+    return ret;
+}
+
+static int
+media_ring_cb_seek(void *opaque, uint64_t offset)
+{
+    struct media_ring *p_ring = opaque;
+
+    /* The feeder can't seek the source past its end */
+    if (p_ring->size != UINT64_MAX && offset > p_ring->size)
+        return -1;
+
+    pthread_mutex_lock(&p_ring->lock);
+    p_ring->stats.seeks++;
+    media_ring_reset(p_ring, offset);
+    pthread_mutex_unlock(&p_ring->lock);
+    return 0;
+}
+
+static void
+media_ring_cb_close(void *opaque)
+{
+    struct media_ring *p_ring = opaque;
+
+    pthread_mutex_lock(&p_ring->lock);
+    p_ring->b_reader = false;
+    pthread_cond_signal(&p_ring->request_cond);
+    pthread_mutex_unlock(&p_ring->lock);
+
+    media_ring_release(p_ring);
+}
+
+void
+Java_org_videolan_libvlc_Media_nativeNewFromDataSource(
+    JNIEnv *env, jobject thiz, jobject libVlc, jlong size, jint ringSize)
+{
+    vlcjni_object *p_obj;
+
+    if (ringSize <= 0)
+    {
+        throw_Exception(env, VLCJNI_EX_ILLEGAL_ARGUMENT, "ringSize invalid");
+        return;
+    }
+
+    struct media_ring *p_ring = calloc(1, sizeof(*p_ring));
+    if (p_ring)
+    {
+        p_ring->p_buf = malloc(ringSize);
+        if (!p_ring->p_buf)
+        {
+            free(p_ring);
+            p_ring = NULL;
+        }
+    }
+    if (!p_ring)
+    {
+        throw_Exception(env, VLCJNI_EX_OUT_OF_MEMORY, "media_ring");
+        return;
+    }
+    pthread_mutex_init(&p_ring->lock, NULL);
+    pthread_cond_init(&p_ring->data_cond, NULL);
+    pthread_cond_init(&p_ring->request_cond, NULL);
+    p_ring->refs = 1;
+    p_ring->capacity = ringSize;
+    p_ring->size = size >= 0 ? size : UINT64_MAX;
+
+    p_obj = VLCJniObject_newFromJavaLibVlc(env, thiz, libVlc);
+    if (!p_obj)
+    {
+        media_ring_release(p_ring);
+        return;
+    }
+
+    p_obj->u.p_m =
+        libvlc_media_new_callbacks(media_ring_cb_open,
+                                   media_ring_cb_read,
+                                   media_ring_cb_seek,
+                                   media_ring_cb_close,
+                                   p_obj);
+
+    if (Media_nativeNewCommon(env, thiz, p_obj) == 0)
+        p_obj->p_sys->p_ring = p_ring;
+    else
+        media_ring_release(p_ring);
+}
+
+/* Give the feeder thread its own reference to the ring, so that it can
+ * outlive the native Media if the DataSource blocks past the release */
+jlong
+Java_org_videolan_libvlc_Media_nativeSourceAcquire(JNIEnv *env, jobject thiz)
+{
+    vlcjni_object *p_obj = VLCJniObject_getInstance(env, thiz);
+
+    if (!p_obj || !p_obj->p_sys->p_ring)
+        return 0;
+
+    struct media_ring *p_ring = p_obj->p_sys->p_ring;
+
+    pthread_mutex_lock(&p_ring->lock);
+    p_ring->refs++;
+    pthread_mutex_unlock(&p_ring->lock);
+    return (jlong)(intptr_t) p_ring;
+}
+
+void
+Java_org_videolan_libvlc_Media_nativeSourceRelease(JNIEnv *env, jclass clazz,
+                                                   jlong handle)
+{
+    struct media_ring *p_ring = (struct media_ring *)(intptr_t) handle;
+
+    if (p_ring)
+        media_ring_release(p_ring);
+}
+
+/* Called from the feeder thread: wait until the reader needs something.
+ * Returns an offset to seek the source to, SOURCE_REQUEST_FILL when there is
+ * room for chunkSize bytes or SOURCE_REQUEST_CLOSED when the feeder should
+ * exit. */
+jlong
+Java_org_videolan_libvlc_Media_nativeSourceWaitRequest(JNIEnv *env,
+                                                       jclass clazz,
+                                                       jlong handle,
+                                                       jint chunkSize)
+{
+    struct media_ring *p_ring = (struct media_ring *)(intptr_t) handle;
+    jlong ret;
+
+    if (!p_ring)
+        return SOURCE_REQUEST_CLOSED;
+    size_t needed = chunkSize > 0 && (size_t) chunkSize < p_ring->capacity
+                  ? (size_t) chunkSize : p_ring->capacity;
+    bool b_waited_for_room = false;
+
+    pthread_mutex_lock(&p_ring->lock);
+    for (;;)
+    {
+        if (p_ring->b_closed)
+        {
+            ret = SOURCE_REQUEST_CLOSED;
+            break;
+        }
+        if (p_ring->feed_gen != p_ring->seek_gen)
+        {
+            p_ring->feed_gen = p_ring->seek_gen;
+            ret = p_ring->seek_offset;
+            break;
+        }
+        if (p_ring->b_reader && !p_ring->b_eof && !p_ring->b_error)
+        {
+            size_t room = p_ring->capacity
+                        - (p_ring->write_pos - p_ring->read_pos);
+            if (room >= needed)
+            {
+                ret = SOURCE_REQUEST_FILL;
+                break;
+            }
+            if (!b_waited_for_room)
+            {
+                p_ring->stats.backpressure++;
+                b_waited_for_room = true;
+            }
+        }
+        pthread_cond_wait(&p_ring->request_cond, &p_ring->lock);
+    }
+    pthread_mutex_unlock(&p_ring->lock);
+    return ret;
+}
+
+/* Called from the feeder thread after a SOURCE_REQUEST_FILL request */
+void
+Java_org_videolan_libvlc_Media_nativeSourceWrite(JNIEnv *env, jclass clazz,
+                                                 jlong handle, jobject jbuffer,
+                                                 jint len)
+{
+    struct media_ring *p_ring = (struct media_ring *)(intptr_t) handle;
+    const uint8_t *p_data = NULL;
+
+    if (!p_ring)
+        return;
+
+    if (len > 0)
+    {
+        p_data = (*env)->GetDirectBufferAddress(env, jbuffer);
+        if (!p_data || len > (*env)->GetDirectBufferCapacity(env, jbuffer))
+        {
+            throw_Exception(env, VLCJNI_EX_ILLEGAL_ARGUMENT, "buffer invalid");
+            return;
+        }
+    }
+
+    pthread_mutex_lock(&p_ring->lock);
+    /* The data was read before a seek request, or after the release: drop it */
+    if (p_ring->b_closed || p_ring->feed_gen != p_ring->seek_gen)
+        goto end;
+
+    if (len == SOURCE_WRITE_EOF)
+        p_ring->b_eof = true;
+    else if (len < 0)
+        p_ring->b_error = true;
+    else if (len > 0)
+    {
+        size_t room = p_ring->capacity - (p_ring->write_pos - p_ring->read_pos);
+        if ((size_t) len > room)
+            len = room;
+
+        size_t start = p_ring->write_pos % p_ring->capacity;
+        size_t first = p_ring->capacity - start;
+        if (first > (size_t) len)
+            first = len;
+        memcpy(p_ring->p_buf + start, p_data, first);
+        memcpy(p_ring->p_buf, p_data + first, len - first);
+
+        p_ring->write_pos += len;
+        p_ring->stats.written += len;
+    }
+    pthread_cond_signal(&p_ring->data_cond);
+end:
+    pthread_mutex_unlock(&p_ring->lock);
+}
+
+void
+Java_org_videolan_libvlc_Media_nativeSourceClose(JNIEnv *env, jobject thiz)
+{
+    vlcjni_object *p_obj = VLCJniObject_getInstance(env, thiz);
+
+    if (!p_obj || !p_obj->p_sys->p_ring)
+        return;
+
+    struct media_ring *p_ring = p_obj->p_sys->p_ring;
+
+    pthread_mutex_lock(&p_ring->lock);
+    p_ring->b_closed = true;
+    pthread_cond_broadcast(&p_ring->data_cond);
+    pthread_cond_broadcast(&p_ring->request_cond);
+    pthread_mutex_unlock(&p_ring->lock);
+}
+
+jboolean
+Java_org_videolan_libvlc_Media_nativeGetSourceStats(JNIEnv *env, jobject thiz,
+                                                    jlongArray jstats)
+{
+    vlcjni_object *p_obj = VLCJniObject_getInstance(env, thiz);
+
+    if (!p_obj || !p_obj->p_sys->p_ring)
+        return false;
+
+    struct media_ring *p_ring = p_obj->p_sys->p_ring;
+
+    pthread_mutex_lock(&p_ring->lock);
+    jlong stats[] = {
+        p_ring->stats.written,
+        p_ring->stats.read,
+        p_ring->stats.underruns,
+        p_ring->stats.backpressure,
+        p_ring->stats.seeks,
+        p_ring->write_pos - p_ring->read_pos,
+    };
+    pthread_mutex_unlock(&p_ring->lock);
+
+    if ((*env)->GetArrayLength(env, jstats) < (jsize) ARRAY_SIZE(stats))
+    {
+        throw_Exception(env, VLCJNI_EX_ILLEGAL_ARGUMENT, "stats array too small");
+        return false;
+    }
+    (*env)->SetLongArrayRegion(env, jstats, 0, ARRAY_SIZE(stats), stats);
+    return true;
+}
+
 /* MediaList must be locked */
 void
 Java_org_videolan_libvlc_Media_nativeNewFromMediaList(JNIEnv *env, jobject thiz,
@@ -342,8 +1346,13 @@ Java_org_videolan_libvlc_Media_nativeRelease(JNIEnv *env, jobject thiz)
 
     libvlc_media_release(p_obj->u.p_m);
 
-    pthread_mutex_destroy(&p_obj->p_sys->lock);
-    pthread_cond_destroy(&p_obj->p_sys->wait);
+    if (p_sys->media_buffer.jbuffer)
+        (*env)->DeleteGlobalRef(env, p_sys->media_buffer.jbuffer);
+    if (p_sys->media_cb.b_owned)
+        close(p_sys->media_cb.fd);
+    if (p_sys->p_ring)
+        media_ring_release(p_sys->p_ring);
+
     free(p_obj->p_sys);
 
     VLCJniObject_release(env, thiz, p_obj);
@@ -570,11 +1579,8 @@ Java_org_videolan_libvlc_Media_nativeParseAsync(JNIEnv *env, jobject thiz,
     if (!p_obj)
         return false;
 
-    pthread_mutex_lock(&p_obj->p_sys->lock);
-    p_obj->p_sys->b_parsing_async = true;
-    pthread_mutex_unlock(&p_obj->p_sys->lock);
-
-    return libvlc_media_parse_request(p_obj->p_libvlc, p_obj->u.p_m, flags, timeout) == 0 ? true : false;
+    unsigned gen;
+    return Media_parseStart(p_obj, true, flags, timeout, &gen);
 }
 
 jboolean
@@ -585,19 +1591,11 @@ Java_org_videolan_libvlc_Media_nativeParse(JNIEnv *env, jobject thiz, jint flags
     if (!p_obj)
         return false;
 
-    pthread_mutex_lock(&p_obj->p_sys->lock);
-    p_obj->p_sys->b_parsing_sync = true;
-    pthread_mutex_unlock(&p_obj->p_sys->lock);
-
-    if (libvlc_media_parse_request(p_obj->p_libvlc, p_obj->u.p_m, flags, -1) != 0)
+    unsigned gen;
+    if (!Media_parseStart(p_obj, false, flags, -1, &gen))
         return false;
 
-    pthread_mutex_lock(&p_obj->p_sys->lock);
-    while (p_obj->p_sys->b_parsing_sync)
-        pthread_cond_wait(&p_obj->p_sys->wait, &p_obj->p_sys->lock);
-    pthread_mutex_unlock(&p_obj->p_sys->lock);
-
-    return true;
+    return Media_parseWait(&p_obj->p_sys->parse_state, gen);
 }
 
 jlong
@@ -723,6 +1721,207 @@ error:
     return array;
 }
 
+static jlongArray
+fingerprint_to_jlongArray(JNIEnv *env, const fingerprint *p_fp)
+{
+    jlong values[] = { p_fp->size, p_fp->osdb_hash, p_fp->sampled_hash };
+    jlongArray jvalues = (*env)->NewLongArray(env, ARRAY_SIZE(values));
+    if (jvalues)
+        (*env)->SetLongArrayRegion(env, jvalues, 0, ARRAY_SIZE(values), values);
+    return jvalues;
+}
+
+jlongArray
+Java_org_videolan_libvlc_Media_nativeFingerprintPath(JNIEnv *env, jclass clazz,
+                                                     jstring jpath,
+                                                     jint samples)
+{
+    const char *psz_path;
+    fingerprint fp;
+
+    if (!jpath || !(psz_path = (*env)->GetStringUTFChars(env, jpath, 0)))
+    {
+        throw_Exception(env, VLCJNI_EX_ILLEGAL_ARGUMENT, "path invalid");
+        return NULL;
+    }
+    int ret = fingerprint_ComputePath(psz_path, samples > 0 ? samples : 0, &fp);
+    (*env)->ReleaseStringUTFChars(env, jpath, psz_path);
+
+    return ret == 0 ? fingerprint_to_jlongArray(env, &fp) : NULL;
+}
+
+jlongArray
+Java_org_videolan_libvlc_Media_nativeFingerprintFd(JNIEnv *env, jclass clazz,
+                                                   jobject jfd, jlong offset,
+                                                   jlong length, jint samples)
+{
+    struct stat st;
+    fingerprint fp;
+    int fd = FDObject_getInt(env, jfd);
+
+    if (fd == -1)
+        return NULL;
+
+    if (offset < 0)
+    {
+        throw_Exception(env, VLCJNI_EX_ILLEGAL_ARGUMENT, "offset invalid");
+        return NULL;
+    }
+    if (length < 0)
+    {
+        if (fstat(fd, &st) != 0 || st.st_size < offset)
+            return NULL;
+        length = st.st_size - offset;
+    }
+    if (fingerprint_Compute(fd, offset, length, samples > 0 ? samples : 0,
+                            &fp) != 0)
+        return NULL;
+    return fingerprint_to_jlongArray(env, &fp);
+}
+
+/* Fingerprint of a Media created from a fd, with or without offset/length */
+jlongArray
+Java_org_videolan_libvlc_Media_nativeFingerprint(JNIEnv *env, jobject thiz,
+                                                 jint samples)
+{
+    vlcjni_object *p_obj = VLCJniObject_getInstance(env, thiz);
+    struct stat st;
+    fingerprint fp;
+
+    if (!p_obj || p_obj->p_sys->media_cb.fd == -1)
+        return NULL;
+
+    int fd = p_obj->p_sys->media_cb.fd;
+    uint64_t offset = p_obj->p_sys->media_cb.offset;
+    uint64_t length = p_obj->p_sys->media_cb.length;
+
+    if (length == UINT64_MAX)
+    {
+        if (fstat(fd, &st) != 0 || (uint64_t) st.st_size < offset)
+            return NULL;
+        length = st.st_size - offset;
+    }
+    if (fingerprint_Compute(fd, offset, length, samples > 0 ? samples : 0,
+                            &fp) != 0)
+        return NULL;
+    return fingerprint_to_jlongArray(env, &fp);
+}
+
+struct fingerprint_batch
+{
+    const char **ppsz_paths;
+    fingerprint *p_fps;
+    bool *p_valid;
+    size_t count;
+    unsigned samples;
+    atomic_size_t next;
+};
+
+static void *
+fingerprint_batch_worker(void *data)
+{
+    struct fingerprint_batch *p_batch = data;
+    size_t i;
+
+    while ((i = atomic_fetch_add(&p_batch->next, 1)) < p_batch->count)
+        p_batch->p_valid[i] = p_batch->ppsz_paths[i]
+            && fingerprint_ComputePath(p_batch->ppsz_paths[i], p_batch->samples,
+                                       &p_batch->p_fps[i]) == 0;
+    return NULL;
+}
+
+/* Fingerprint all paths from a pool of threads. Returns 3 longs per path
+ * (size, osdb hash, sampled hash), the size is -1 for failed paths. */
+jlongArray
+Java_org_videolan_libvlc_Media_nativeFingerprintPaths(JNIEnv *env,
+                                                      jclass clazz,
+                                                      jobjectArray jpaths,
+                                                      jint samples,
+                                                      jint threads)
+{
+    struct fingerprint_batch batch = {
+        .samples = samples > 0 ? samples : 0,
+    };
+    jlongArray jvalues = NULL;
+    jlong *p_values = NULL;
+
+    if (!jpaths)
+    {
+        throw_Exception(env, VLCJNI_EX_ILLEGAL_ARGUMENT, "paths invalid");
+        return NULL;
+    }
+    batch.count = (*env)->GetArrayLength(env, jpaths);
+    atomic_init(&batch.next, 0);
+
+    batch.ppsz_paths = calloc(batch.count ? batch.count : 1, sizeof(char *));
+    batch.p_fps = malloc((batch.count ? batch.count : 1) * sizeof(fingerprint));
+    batch.p_valid = calloc(batch.count ? batch.count : 1, sizeof(bool));
+    p_values = malloc((batch.count ? batch.count : 1) * 3 * sizeof(jlong));
+    if (!batch.ppsz_paths || !batch.p_fps || !batch.p_valid
+     || !p_values)
+    {
+        throw_Exception(env, VLCJNI_EX_OUT_OF_MEMORY, "fingerprints");
+        goto end;
+    }
+
+    /* Strings are copied from this thread: workers don't touch the JVM, and
+     * local references are not kept for each path */
+    for (size_t i = 0; i < batch.count; ++i)
+    {
+        jstring jpath = (*env)->GetObjectArrayElement(env, jpaths, i);
+        if (!jpath)
+            continue;
+        const char *psz_path = (*env)->GetStringUTFChars(env, jpath, 0);
+        if (psz_path)
+        {
+            batch.ppsz_paths[i] = strdup(psz_path);
+            (*env)->ReleaseStringUTFChars(env, jpath, psz_path);
+        }
+        (*env)->DeleteLocalRef(env, jpath);
+    }
+
+    if (threads <= 0)
+        threads = sysconf(_SC_NPROCESSORS_ONLN);
+    if (threads <= 0)
+        threads = 1;
+    if ((size_t) threads > batch.count)
+        threads = batch.count;
+
+    pthread_t *p_threads = malloc((threads ? threads : 1) * sizeof(pthread_t));
+    int started = 0;
+    if (p_threads)
+        for (; started < threads; ++started)
+            if (pthread_create(&p_threads[started], NULL,
+                               fingerprint_batch_worker, &batch) != 0)
+                break;
+    /* The calling thread takes its share too, and finishes the work if no
+     * thread could be created */
+    fingerprint_batch_worker(&batch);
+    for (int i = 0; i < started; ++i)
+        pthread_join(p_threads[i], NULL);
+    free(p_threads);
+
+    for (size_t i = 0; i < batch.count; ++i)
+    {
+        p_values[3 * i] = batch.p_valid[i] ? (jlong) batch.p_fps[i].size : -1;
+        p_values[3 * i + 1] = batch.p_valid[i] ? (jlong) batch.p_fps[i].osdb_hash : 0;
+        p_values[3 * i + 2] = batch.p_valid[i] ? (jlong) batch.p_fps[i].sampled_hash : 0;
+    }
+    jvalues = (*env)->NewLongArray(env, batch.count * 3);
+    if (jvalues)
+        (*env)->SetLongArrayRegion(env, jvalues, 0, batch.count * 3, p_values);
+
+end:
+    if (batch.ppsz_paths)
+        for (size_t i = 0; i < batch.count; ++i)
+            free((char *) batch.ppsz_paths[i]);
+    free(batch.ppsz_paths);
+    free(batch.p_fps);
+    free(batch.p_valid);
+    free(p_values);
+    return jvalues;
+}
+
 jobject
 Java_org_videolan_libvlc_Media_nativeGetStats(JNIEnv *env, jobject thiz)
 {
@@ -19,11 +19,25 @@
  *****************************************************************************/
 
 #include <pthread.h>
+#include <stdlib.h>
 
 #include "libvlcjni-vlcobject.h"
 
 #define MEDIAS_INIT_SIZE 32
 
+/* Range events sent after a batch operation, keep in sync with
+ * IMediaList.java */
+#define MEDIALIST_EVENT_ITEMS_ADDED 0x280
+#define MEDIALIST_EVENT_ITEMS_DELETED 0x281
+#define MEDIALIST_EVENT_ITEM_MOVED 0x282
+
+struct vlcjni_object_sys
+{
+    /* Set while a batch operation holds the list lock: per item events are
+     * dropped and replaced by a single range event */
+    bool b_batch;
+};
+
 static const libvlc_event_type_t ml_events[] = {
     libvlc_MediaListItemAdded,
     //libvlc_MediaListWillAddItem,
@@ -40,9 +54,13 @@ MediaList_event_cb(vlcjni_object *p_obj, const libvlc_event_t *p_ev,
     switch (p_ev->type)
     {
         case libvlc_MediaListItemAdded:
+            if (p_obj->p_sys->b_batch)
+                return false;
             p_java_event->arg1 = p_ev->u.media_list_item_added.index;
             break;
         case libvlc_MediaListItemDeleted:
+            if (p_obj->p_sys->b_batch)
+                return false;
             p_java_event->arg1 = p_ev->u.media_list_item_deleted.index;
             break;
     }
@@ -53,6 +71,20 @@ MediaList_event_cb(vlcjni_object *p_obj, const libvlc_event_t *p_ev,
 static void
 MediaList_nativeNewCommon(JNIEnv *env, jobject thiz, vlcjni_object *p_obj)
 {
+    p_obj->p_sys = calloc(1, sizeof(vlcjni_object_sys));
+
+    if (!p_obj->u.p_ml || !p_obj->p_sys)
+    {
+        if (p_obj->u.p_ml)
+            libvlc_media_list_release(p_obj->u.p_ml);
+        free(p_obj->p_sys);
+        VLCJniObject_release(env, thiz, p_obj);
+        throw_Exception(env,
+                        !p_obj->u.p_ml ? VLCJNI_EX_ILLEGAL_STATE : VLCJNI_EX_OUT_OF_MEMORY,
+                        "can't create MediaList instance");
+        return;
+    }
+
     VLCJniObject_attachEvents(p_obj, MediaList_event_cb,
                               libvlc_media_list_event_manager(p_obj->u.p_ml),
                               ml_events);
@@ -125,6 +157,7 @@ Java_org_videolan_libvlc_MediaList_nativeRelease(JNIEnv *env, jobject thiz)
         return;
 
     libvlc_media_list_release(p_obj->u.p_ml);
+    free(p_obj->p_sys);
 
     VLCJniObject_release(env, thiz, p_obj);
 }
@@ -159,3 +192,378 @@ Java_org_videolan_libvlc_MediaList_nativeUnlock(JNIEnv *env, jobject thiz)
         return;
     libvlc_media_list_unlock(p_obj->u.p_ml);
 }
+
+/* Native media of the item at index, as an identity key. The list must be
+ * locked, the handle is only valid while the item is in the list. */
+jlong
+Java_org_videolan_libvlc_MediaList_nativeGetItemHandle(JNIEnv *env,
+                                                       jobject thiz,
+                                                       jint index)
+{
+    vlcjni_object *p_obj = VLCJniObject_getInstance(env, thiz);
+
+    if (!p_obj)
+        return 0;
+
+    libvlc_media_t *p_m = libvlc_media_list_item_at_index(p_obj->u.p_ml, index);
+    if (!p_m)
+        return 0;
+    /* Still held by the list */
+    libvlc_media_release(p_m);
+    return (jlong)(intptr_t) p_m;
+}
+
+/* Strings of one item, read while the list is locked */
+struct snapshot_item
+{
+    char *psz_mrl;
+    char *psz_metas[4];
+    int type;
+    jlong duration;
+};
+
+static const libvlc_meta_t snapshot_metas[] = {
+    libvlc_meta_Title,
+    libvlc_meta_Artist,
+    libvlc_meta_Album,
+    libvlc_meta_ArtworkURL,
+};
+
+static jobjectArray
+MediaList_newStringArray(JNIEnv *env, const struct snapshot_item *p_items,
+                         int count, int meta)
+{
+    jobjectArray jarray = (*env)->NewObjectArray(env, count,
+                                                 fields.String_clazz, NULL);
+    if (!jarray)
+        return NULL;
+
+    for (int i = 0; i < count; ++i)
+    {
+        const char *psz = meta < 0 ? p_items[i].psz_mrl
+                                   : p_items[i].psz_metas[meta];
+        jstring jstr = vlcNewStringUTF(env, psz);
+        if (jstr)
+        {
+            (*env)->SetObjectArrayElement(env, jarray, i, jstr);
+            (*env)->DeleteLocalRef(env, jstr);
+        }
+    }
+    return jarray;
+}
+
+jobject
+Java_org_videolan_libvlc_MediaList_nativeGetSnapshot(JNIEnv *env, jobject thiz)
+{
+    vlcjni_object *p_obj = VLCJniObject_getInstance(env, thiz);
+    struct snapshot_item *p_items;
+    jobject jsnapshot = NULL;
+    int count;
+
+    if (!p_obj)
+        return NULL;
+
+    /* Only copy under the lock, Java objects are created once unlocked */
+    libvlc_media_list_lock(p_obj->u.p_ml);
+    count = libvlc_media_list_count(p_obj->u.p_ml);
+    p_items = calloc(count > 0 ? count : 1, sizeof(*p_items));
+    if (p_items)
+    {
+        for (int i = 0; i < count; ++i)
+        {
+            libvlc_media_t *p_m = libvlc_media_list_item_at_index(p_obj->u.p_ml, i);
+            if (!p_m)
+                continue;
+            p_items[i].psz_mrl = libvlc_media_get_mrl(p_m);
+            p_items[i].type = libvlc_media_get_type(p_m);
+            p_items[i].duration = libvlc_media_get_duration(p_m);
+            for (size_t j = 0; j < ARRAY_SIZE(snapshot_metas); ++j)
+                p_items[i].psz_metas[j] = libvlc_media_get_meta(p_m, snapshot_metas[j]);
+            libvlc_media_release(p_m);
+        }
+    }
+    libvlc_media_list_unlock(p_obj->u.p_ml);
+
+    if (!p_items)
+    {
+        throw_Exception(env, VLCJNI_EX_OUT_OF_MEMORY, "MediaList snapshot");
+        return NULL;
+    }
+
+    jintArray jtypes = (*env)->NewIntArray(env, count);
+    jlongArray jdurations = (*env)->NewLongArray(env, count);
+    jobjectArray jmrls = MediaList_newStringArray(env, p_items, count, -1);
+    jobjectArray jtitles = MediaList_newStringArray(env, p_items, count, 0);
+    jobjectArray jartists = MediaList_newStringArray(env, p_items, count, 1);
+    jobjectArray jalbums = MediaList_newStringArray(env, p_items, count, 2);
+    jobjectArray jartworks = MediaList_newStringArray(env, p_items, count, 3);
+
+    if (jtypes && jdurations && jmrls && jtitles && jartists && jalbums
+     && jartworks)
+    {
+        jint *p_types = (*env)->GetIntArrayElements(env, jtypes, NULL);
+        jlong *p_durations = (*env)->GetLongArrayElements(env, jdurations, NULL);
+        for (int i = 0; p_types && p_durations && i < count; ++i)
+        {
+            p_types[i] = p_items[i].type;
+            p_durations[i] = p_items[i].duration;
+        }
+        if (p_types)
+            (*env)->ReleaseIntArrayElements(env, jtypes, p_types, 0);
+        if (p_durations)
+            (*env)->ReleaseLongArrayElements(env, jdurations, p_durations, 0);
+
+        jsnapshot = (*env)->CallStaticObjectMethod(env, fields.MediaList_clazz,
+                                fields.MediaList_createSnapshotFromNative,
+                                jmrls, jtypes, jdurations, jtitles, jartists,
+                                jalbums, jartworks);
+    }
+
+    for (int i = 0; i < count; ++i)
+    {
+        free(p_items[i].psz_mrl);
+        for (size_t j = 0; j < ARRAY_SIZE(snapshot_metas); ++j)
+            free(p_items[i].psz_metas[j]);
+    }
+    free(p_items);
+    return jsnapshot;
+}
+
+/* Lock the list for a batch operation. Returns false, with an exception
+ * thrown, if the list can't be modified. */
+static bool
+MediaList_batchBegin(JNIEnv *env, vlcjni_object *p_obj)
+{
+    libvlc_media_list_lock(p_obj->u.p_ml);
+    if (libvlc_media_list_is_readonly(p_obj->u.p_ml))
+    {
+        libvlc_media_list_unlock(p_obj->u.p_ml);
+        throw_Exception(env, VLCJNI_EX_ILLEGAL_STATE, "MediaList is read-only");
+        return false;
+    }
+    p_obj->p_sys->b_batch = true;
+    return true;
+}
+
+/* Send the range event, if any, while still holding the list lock like
+ * libvlc does for its own events, then unlock. */
+static void
+MediaList_batchEnd(JNIEnv *env, vlcjni_object *p_obj, int type, jlong arg1,
+                   jlong arg2)
+{
+    p_obj->p_sys->b_batch = false;
+    if (type != -1)
+    {
+        java_event jevent = { type, arg1, arg2, 0.0, NULL };
+        VLCJniObject_dispatchEvent(env, p_obj, &jevent);
+    }
+    libvlc_media_list_unlock(p_obj->u.p_ml);
+}
+
+/* Insert medias at index, or append them if index is -1, and return the
+ * number of medias inserted */
+static int
+MediaList_insertMedias(JNIEnv *env, vlcjni_object *p_obj, int index,
+                       libvlc_media_t **pp_m, int count)
+{
+    int inserted = 0;
+
+    if (!MediaList_batchBegin(env, p_obj))
+        return 0;
+
+    int list_count = libvlc_media_list_count(p_obj->u.p_ml);
+    if (index == -1)
+        index = list_count;
+    if (index < 0 || index > list_count)
+    {
+        MediaList_batchEnd(env, p_obj, -1, 0, 0);
+        throw_Exception(env, VLCJNI_EX_ILLEGAL_ARGUMENT, "invalid index");
+        return 0;
+    }
+
+    for (int i = 0; i < count; ++i)
+    {
+        if (!pp_m[i])
+            continue;
+        if (libvlc_media_list_insert_media(p_obj->u.p_ml, pp_m[i],
+                                           index + inserted) != 0)
+            break;
+        inserted++;
+    }
+
+    MediaList_batchEnd(env, p_obj, inserted > 0 ? MEDIALIST_EVENT_ITEMS_ADDED : -1,
+                       index, inserted);
+    return inserted;
+}
+
+jint
+Java_org_videolan_libvlc_MediaList_nativeInsertMedias(JNIEnv *env,
+                                                      jobject thiz,
+                                                      jint index,
+                                                      jobjectArray jmedias)
+{
+    vlcjni_object *p_obj = VLCJniObject_getInstance(env, thiz);
+    libvlc_media_t **pp_m;
+    jsize count;
+    int inserted = 0;
+
+    if (!p_obj)
+        return 0;
+
+    if (!jmedias)
+    {
+        throw_Exception(env, VLCJNI_EX_ILLEGAL_ARGUMENT, "medias invalid");
+        return 0;
+    }
+    count = (*env)->GetArrayLength(env, jmedias);
+    if (count == 0)
+        return 0;
+
+    pp_m = malloc(count * sizeof(*pp_m));
+    if (!pp_m)
+    {
+        throw_Exception(env, VLCJNI_EX_OUT_OF_MEMORY, "MediaList medias");
+        return 0;
+    }
+
+    /* Resolve all the native medias before locking the list */
+    for (jsize i = 0; i < count; ++i)
+    {
+        jobject jmedia = (*env)->GetObjectArrayElement(env, jmedias, i);
+        vlcjni_object *p_m_obj = jmedia ? VLCJniObject_getInstance(env, jmedia)
+                                        : NULL;
+        if (jmedia)
+            (*env)->DeleteLocalRef(env, jmedia);
+        if (!p_m_obj)
+        {
+            if (!(*env)->ExceptionCheck(env))
+                throw_Exception(env, VLCJNI_EX_ILLEGAL_ARGUMENT, "null Media");
+            free(pp_m);
+            return 0;
+        }
+        pp_m[i] = p_m_obj->u.p_m;
+    }
+
+    inserted = MediaList_insertMedias(env, p_obj, index, pp_m, count);
+    free(pp_m);
+    return inserted;
+}
+
+jint
+Java_org_videolan_libvlc_MediaList_nativeInsertLocations(JNIEnv *env,
+                                                         jobject thiz,
+                                                         jint index,
+                                                         jobjectArray jmrls)
+{
+    vlcjni_object *p_obj = VLCJniObject_getInstance(env, thiz);
+    libvlc_media_t **pp_m;
+    jsize count;
+    int inserted = 0;
+
+    if (!p_obj)
+        return 0;
+
+    if (!jmrls)
+    {
+        throw_Exception(env, VLCJNI_EX_ILLEGAL_ARGUMENT, "locations invalid");
+        return 0;
+    }
+    count = (*env)->GetArrayLength(env, jmrls);
+    if (count == 0)
+        return 0;
+
+    pp_m = calloc(count, sizeof(*pp_m));
+    if (!pp_m)
+    {
+        throw_Exception(env, VLCJNI_EX_OUT_OF_MEMORY, "MediaList medias");
+        return 0;
+    }
+
+    /* Invalid locations are skipped */
+    for (jsize i = 0; i < count; ++i)
+    {
+        jstring jmrl = (*env)->GetObjectArrayElement(env, jmrls, i);
+        const char *psz_mrl = jmrl ? (*env)->GetStringUTFChars(env, jmrl, 0)
+                                   : NULL;
+        if (psz_mrl)
+        {
+            pp_m[i] = libvlc_media_new_location(psz_mrl);
+            (*env)->ReleaseStringUTFChars(env, jmrl, psz_mrl);
+        }
+        if (jmrl)
+            (*env)->DeleteLocalRef(env, jmrl);
+    }
+
+    inserted = MediaList_insertMedias(env, p_obj, index, pp_m, count);
+
+    /* The list holds its own references */
+    for (jsize i = 0; i < count; ++i)
+        if (pp_m[i])
+            libvlc_media_release(pp_m[i]);
+    free(pp_m);
+    return inserted;
+}
+
+void
+Java_org_videolan_libvlc_MediaList_nativeRemoveRange(JNIEnv *env,
+                                                     jobject thiz,
+                                                     jint index,
+                                                     jint count)
+{
+    vlcjni_object *p_obj = VLCJniObject_getInstance(env, thiz);
+
+    if (!p_obj || !MediaList_batchBegin(env, p_obj))
+        return;
+
+    int list_count = libvlc_media_list_count(p_obj->u.p_ml);
+    if (index < 0 || count < 0 || count > list_count - index)
+    {
+        MediaList_batchEnd(env, p_obj, -1, 0, 0);
+        throw_Exception(env, VLCJNI_EX_ILLEGAL_ARGUMENT, "invalid range");
+        return;
+    }
+
+    /* From the end: no item is moved more than once */
+    for (int i = index + count - 1; i >= index; --i)
+        libvlc_media_list_remove_index(p_obj->u.p_ml, i);
+
+    MediaList_batchEnd(env, p_obj, count > 0 ? MEDIALIST_EVENT_ITEMS_DELETED : -1,
+                       index, count);
+}
+
+void
+Java_org_videolan_libvlc_MediaList_nativeMove(JNIEnv *env, jobject thiz,
+                                              jint from, jint to)
+{
+    vlcjni_object *p_obj = VLCJniObject_getInstance(env, thiz);
+
+    if (!p_obj || !MediaList_batchBegin(env, p_obj))
+        return;
+
+    int list_count = libvlc_media_list_count(p_obj->u.p_ml);
+    if (from < 0 || from >= list_count || to < 0 || to >= list_count)
+    {
+        MediaList_batchEnd(env, p_obj, -1, 0, 0);
+        throw_Exception(env, VLCJNI_EX_ILLEGAL_ARGUMENT, "invalid index");
+        return;
+    }
+
+    if (from == to)
+    {
+        MediaList_batchEnd(env, p_obj, -1, 0, 0);
+        return;
+    }
+
+    /* libvlc has no move: the list keeps the media alive with our reference */
+    libvlc_media_t *p_m = libvlc_media_list_item_at_index(p_obj->u.p_ml, from);
+    if (!p_m)
+    {
+        MediaList_batchEnd(env, p_obj, -1, 0, 0);
+        return;
+    }
+    libvlc_media_list_remove_index(p_obj->u.p_ml, from);
+    libvlc_media_list_insert_media(p_obj->u.p_ml, p_m, to);
+    libvlc_media_release(p_m);
+
+    MediaList_batchEnd(env, p_obj, MEDIALIST_EVENT_ITEM_MOVED, from, to);
+}
@@ -20,8 +20,11 @@
  * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
  *****************************************************************************/
 
+#include <errno.h>
 #include <pthread.h>
 #include <stdlib.h>
+#include <string.h>
+#include <time.h>
 #include <dlfcn.h>
 
 #include "libvlcjni-vlcobject.h"
@@ -55,15 +58,175 @@ static const libvlc_event_type_t mp_events[] = {
     -1,
 };
 
+/* Rates computed between two consecutive libvlc_media_get_stats() calls */
+struct stats_sample
+{
+    int64_t time_ms;
+    float input_bitrate; /* bytes per second */
+    float demux_bitrate; /* bytes per second */
+    float decoded_fps;
+    float displayed_fps;
+    float lost_pictures; /* per second */
+    float late_pictures; /* per second */
+    float lost_abuffers; /* per second */
+};
+
+struct stats_sampler
+{
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    pthread_t thread;
+    bool b_running;
+    unsigned interval_ms;
+
+    struct stats_sample *p_samples;
+    size_t capacity;
+    size_t count;
+    size_t next;
+
+    /* Previous reading of the current media, used to compute the deltas */
+    libvlc_media_t *p_media;
+    libvlc_media_stats_t prev;
+    int64_t prev_time_us;
+    bool b_has_prev;
+};
+
+/* Keep in sync with MediaPlayer.Command */
+enum player_command_type
+{
+    COMMAND_SET_MEDIA,
+    COMMAND_PLAY,
+    COMMAND_PAUSE,
+    COMMAND_STOP,
+    COMMAND_SET_TIME,
+    COMMAND_SET_POSITION,
+    COMMAND_SET_RATE,
+    COMMAND_SET_VOLUME,
+    COMMAND_SELECT_TRACKS,
+};
+
+/* Keep in sync with MediaPlayer.CommandStatus */
+enum player_command_status
+{
+    COMMAND_STATUS_DONE,
+    COMMAND_STATUS_FAILED,
+    COMMAND_STATUS_COALESCED,
+    COMMAND_STATUS_CANCELLED,
+    COMMAND_STATUS_PENDING,
+};
+
+struct player_command
+{
+    struct player_command *p_next;
+    /* 0 for commands queued by the scrub session, not reported to Java */
+    jlong id;
+    enum player_command_type type;
+    enum player_command_status status;
+    int64_t queued_us;
+    /* Seek of the scrub session, its latency is measured */
+    bool b_scrub;
+    uint64_t scrub_seq;
+
+    union {
+        libvlc_media_t *p_media;
+        struct {
+            int64_t time;
+            bool fast;
+        } time;
+        struct {
+            float pos;
+            bool fast;
+        } position;
+        float rate;
+        int volume;
+        struct {
+            int type;
+            char *psz_ids;
+        } tracks;
+    } u;
+};
+
+/* Keep in sync with MediaPlayer.CommandStats */
+enum command_stat
+{
+    COMMAND_STAT_QUEUED,
+    COMMAND_STAT_EXECUTED,
+    COMMAND_STAT_FAILED,
+    COMMAND_STAT_COALESCED,
+    COMMAND_STAT_CANCELLED,
+    COMMAND_STAT_QUEUE_US,
+    COMMAND_STAT_MAX_QUEUE_US,
+    COMMAND_STAT_EXEC_US,
+    COMMAND_STAT_MAX_EXEC_US,
+    COMMAND_STAT_COUNT,
+};
+
+/* Commands executed in order by a single worker thread, started on the first
+ * queued command */
+struct command_queue
+{
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    pthread_t thread;
+    bool b_running;
+    bool b_stop;
+    jweak weak;
+
+    struct player_command *p_first;
+    struct player_command **pp_last;
+
+    uint64_t stats[COMMAND_STAT_COUNT];
+};
+
+#define SCRUB_LATENCY_COUNT 64
+/* Seeks not completed after this delay don't hold the next target back */
+#define SCRUB_SEEK_TIMEOUT_US INT64_C(1000000)
+/* Time changes closer than this to the time before the seek are considered to
+ * be regular playback updates */
+#define SCRUB_DISCONTINUITY_MS 250
+
+/* Protected by the command queue lock. Only one seek is in flight: the latest
+ * target is kept until it completes. */
+struct scrub_session
+{
+    bool b_active;
+
+    uint64_t seq;
+    bool b_in_flight;
+    uint64_t flight_seq;
+    int64_t flight_target;
+    int64_t flight_pre_time;
+    int64_t flight_queued_us;
+    int64_t flight_start_us; /* 0 until the seek is run */
+
+    bool b_has_target;
+    int64_t target;
+    bool b_has_last;
+    int64_t last_target;
+
+    uint64_t requests;
+    uint64_t seeks;
+    uint64_t timeouts;
+    /* seek to first time update latencies, in microseconds */
+    int64_t latencies[SCRUB_LATENCY_COUNT];
+    size_t latency_count;
+    size_t latency_next;
+};
+
 struct vlcjni_object_sys
 {
     jobject jwindow;
     libvlc_video_viewpoint_t *p_vp;
+    struct stats_sampler sampler;
+    struct command_queue commands;
+    struct scrub_session scrub;
 
 #if defined(LIBVLC_VERSION_MAJOR) && LIBVLC_VERSION_MAJOR >= 4
     pthread_mutex_t     stop_lock;
     pthread_cond_t      stop_cond;
     bool                stopped;
+    /* Set by nativeRelease: the Stopped event won't be received anymore */
+    bool                released;
 #endif
 };
 
@@ -87,6 +250,9 @@ VLCJniObject_setInstance(JNIEnv *env, jobject thiz, libvlc_equalizer_t *p_eq)
                          (jlong)(intptr_t)p_eq);
 }
 
+static void
+ScrubSession_onTimeChangedLocked(vlcjni_object *p_obj, int64_t time);
+
 static bool
 MediaPlayer_event_cb(vlcjni_object *p_obj, const libvlc_event_t *p_ev,
                      java_event *p_java_event)
@@ -112,6 +278,9 @@ MediaPlayer_event_cb(vlcjni_object *p_obj, const libvlc_event_t *p_ev,
             break;
         case libvlc_MediaPlayerTimeChanged:
             p_java_event->arg1 = p_ev->u.media_player_time_changed.new_time;
+            pthread_mutex_lock(&p_obj->p_sys->commands.lock);
+            ScrubSession_onTimeChangedLocked(p_obj, p_java_event->arg1);
+            pthread_mutex_unlock(&p_obj->p_sys->commands.lock);
             break;
         case libvlc_MediaPlayerVout:
             p_java_event->arg1 = p_ev->u.media_player_vout.new_count;
@@ -140,6 +309,550 @@ MediaPlayer_event_cb(vlcjni_object *p_obj, const libvlc_event_t *p_ev,
     return true;
 }
 
+static int64_t
+StatsSampler_now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * INT64_C(1000000) + ts.tv_nsec / 1000;
+}
+
+/* Must be called locked. Takes ownership of p_m. */
+static void
+StatsSampler_push(struct stats_sampler *p_sampler, libvlc_media_t *p_m,
+                  const libvlc_media_stats_t *p_stats, int64_t now)
+{
+    if (p_m != p_sampler->p_media)
+    {
+        if (p_sampler->p_media)
+            libvlc_media_release(p_sampler->p_media);
+        p_sampler->p_media = p_m;
+        p_sampler->b_has_prev = false;
+    }
+    else if (p_m)
+        libvlc_media_release(p_m);
+
+    if (!p_stats)
+    {
+        p_sampler->b_has_prev = false;
+        return;
+    }
+
+    const libvlc_media_stats_t *p_prev = &p_sampler->prev;
+    /* Counters going backward mean that the input was restarted */
+    bool b_valid = p_sampler->b_has_prev
+        && now > p_sampler->prev_time_us
+        && p_stats->i_read_bytes >= p_prev->i_read_bytes
+        && p_stats->i_demux_read_bytes >= p_prev->i_demux_read_bytes
+        && p_stats->i_decoded_video >= p_prev->i_decoded_video
+        && p_stats->i_displayed_pictures >= p_prev->i_displayed_pictures;
+
+    if (b_valid)
+    {
+        float dt = (now - p_sampler->prev_time_us) / 1000000.f;
+        struct stats_sample *p_sample =
+            &p_sampler->p_samples[p_sampler->next];
+
+#define RATE(field) ((p_stats->field - p_prev->field) / dt)
+        p_sample->time_ms = now / 1000;
+        p_sample->input_bitrate = RATE(i_read_bytes);
+        p_sample->demux_bitrate = RATE(i_demux_read_bytes);
+        p_sample->decoded_fps = RATE(i_decoded_video);
+        p_sample->displayed_fps = RATE(i_displayed_pictures);
+        p_sample->lost_pictures = RATE(i_lost_pictures);
+#if defined(LIBVLC_VERSION_MAJOR) && LIBVLC_VERSION_MAJOR >= 4
+        p_sample->late_pictures = RATE(i_late_pictures);
+#else
+        p_sample->late_pictures = 0.f;
+#endif
+        p_sample->lost_abuffers = RATE(i_lost_abuffers);
+#undef RATE
+
+        p_sampler->next = (p_sampler->next + 1) % p_sampler->capacity;
+        if (p_sampler->count < p_sampler->capacity)
+            p_sampler->count++;
+    }
+
+    p_sampler->prev = *p_stats;
+    p_sampler->prev_time_us = now;
+    p_sampler->b_has_prev = true;
+}
+
+/* Must be called locked: false once the sampler was stopped or restarted
+ * with another thread */
+static bool
+StatsSampler_isCurrent(const struct stats_sampler *p_sampler)
+{
+    return p_sampler->b_running
+        && pthread_equal(p_sampler->thread, pthread_self());
+}
+
+static void *
+StatsSampler_thread(void *data)
+{
+    vlcjni_object *p_obj = data;
+    struct stats_sampler *p_sampler = &p_obj->p_sys->sampler;
+
+    pthread_mutex_lock(&p_sampler->lock);
+    while (StatsSampler_isCurrent(p_sampler))
+    {
+        /* The cond uses CLOCK_MONOTONIC: wall clock changes don't stretch or
+         * shorten the interval */
+        struct timespec deadline;
+        clock_gettime(CLOCK_MONOTONIC, &deadline);
+        deadline.tv_sec += p_sampler->interval_ms / 1000;
+        deadline.tv_nsec += (p_sampler->interval_ms % 1000) * 1000000L;
+        if (deadline.tv_nsec >= 1000000000L)
+        {
+            deadline.tv_sec++;
+            deadline.tv_nsec -= 1000000000L;
+        }
+
+        while (StatsSampler_isCurrent(p_sampler)
+            && pthread_cond_timedwait(&p_sampler->cond, &p_sampler->lock,
+                                      &deadline) != ETIMEDOUT);
+        if (!StatsSampler_isCurrent(p_sampler))
+            break;
+        pthread_mutex_unlock(&p_sampler->lock);
+
+        /* Don't hold the sampler lock while calling libvlc */
+        libvlc_media_stats_t stats;
+        libvlc_media_t *p_m = libvlc_media_player_get_media(p_obj->u.p_mp);
+        bool b_stats = p_m && libvlc_media_get_stats(p_m, &stats);
+        int64_t now = StatsSampler_now();
+
+        pthread_mutex_lock(&p_sampler->lock);
+        if (!StatsSampler_isCurrent(p_sampler))
+        {
+            if (p_m)
+                libvlc_media_release(p_m);
+            break;
+        }
+        StatsSampler_push(p_sampler, p_m, b_stats ? &stats : NULL, now);
+    }
+    /* A restarted sampler keeps the media of the previous reading */
+    if (!p_sampler->b_running && p_sampler->p_media)
+    {
+        libvlc_media_release(p_sampler->p_media);
+        p_sampler->p_media = NULL;
+    }
+    pthread_mutex_unlock(&p_sampler->lock);
+    return NULL;
+}
+
+static void
+StatsSampler_stop(vlcjni_object *p_obj)
+{
+    struct stats_sampler *p_sampler = &p_obj->p_sys->sampler;
+
+    /* Only one caller joins a given thread */
+    pthread_mutex_lock(&p_sampler->lock);
+    if (!p_sampler->b_running)
+    {
+        pthread_mutex_unlock(&p_sampler->lock);
+        return;
+    }
+    pthread_t thread = p_sampler->thread;
+    p_sampler->b_running = false;
+    pthread_cond_broadcast(&p_sampler->cond);
+    pthread_mutex_unlock(&p_sampler->lock);
+
+    pthread_join(thread, NULL);
+}
+
+/* Blocks until the player is stopped */
+static void
+MediaPlayer_stop(vlcjni_object *p_obj)
+{
+#if defined(LIBVLC_VERSION_MAJOR) && LIBVLC_VERSION_MAJOR >= 4
+    /* XXX: temporary during the VLC 3.0 -> 4.0 transition. The Java API need
+     * to be updated to handle async stop (only?). */
+    pthread_mutex_lock(&p_obj->p_sys->stop_lock);
+    p_obj->p_sys->stopped = false;
+    int ret = libvlc_media_player_stop_async(p_obj->u.p_mp);
+    if (ret == 0)
+        while (!p_obj->p_sys->stopped && !p_obj->p_sys->released)
+            pthread_cond_wait(&p_obj->p_sys->stop_cond, &p_obj->p_sys->stop_lock);
+    else
+        p_obj->p_sys->stopped = true;
+    pthread_mutex_unlock(&p_obj->p_sys->stop_lock);
+#else
+    libvlc_media_player_stop(p_obj->u.p_mp);
+#endif
+}
+
+static void
+PlayerCommand_delete(struct player_command *p_cmd)
+{
+    if (p_cmd->type == COMMAND_SET_MEDIA && p_cmd->u.p_media)
+        libvlc_media_release(p_cmd->u.p_media);
+    else if (p_cmd->type == COMMAND_SELECT_TRACKS)
+        free(p_cmd->u.tracks.psz_ids);
+    free(p_cmd);
+}
+
+/* Commands whose effect is overridden by a later command of the same group */
+static int
+PlayerCommand_group(const struct player_command *p_cmd)
+{
+    switch (p_cmd->type)
+    {
+        case COMMAND_SET_TIME:
+        case COMMAND_SET_POSITION:
+            return COMMAND_SET_TIME;
+        case COMMAND_SET_RATE:
+        case COMMAND_SET_VOLUME:
+        case COMMAND_SELECT_TRACKS:
+            return p_cmd->type;
+        default:
+            return -1;
+    }
+}
+
+/* Must be called locked. The command won't be run, it is only reported. */
+static void
+CommandQueue_dropLocked(vlcjni_object *p_obj, struct player_command *p_cmd,
+                        enum player_command_status status)
+{
+    struct scrub_session *p_scrub = &p_obj->p_sys->scrub;
+
+    p_cmd->status = status;
+    p_obj->p_sys->commands.stats[status == COMMAND_STATUS_COALESCED
+                                 ? COMMAND_STAT_COALESCED
+                                 : COMMAND_STAT_CANCELLED]++;
+
+    /* Don't hold the next scrub targets back for a seek that won't run */
+    if (p_cmd->b_scrub && p_scrub->b_in_flight
+     && p_scrub->flight_seq == p_cmd->scrub_seq)
+        p_scrub->b_in_flight = false;
+}
+
+/* Must be called locked. Coalesce the pending commands made useless by
+ * p_cmd before it is queued. */
+static void
+CommandQueue_coalesce(vlcjni_object *p_obj,
+                      const struct player_command *p_cmd)
+{
+    struct command_queue *p_queue = &p_obj->p_sys->commands;
+    struct player_command *p_last = NULL;
+    int group = PlayerCommand_group(p_cmd);
+
+    for (struct player_command *p_it = p_queue->p_first; p_it;
+         p_it = p_it->p_next)
+    {
+        if (p_it->status != COMMAND_STATUS_PENDING)
+            continue;
+        /* A new media or a stop drops all the pending seeks */
+        if ((p_cmd->type == COMMAND_SET_MEDIA || p_cmd->type == COMMAND_STOP)
+         && PlayerCommand_group(p_it) == COMMAND_SET_TIME)
+            CommandQueue_dropLocked(p_obj, p_it, COMMAND_STATUS_COALESCED);
+        else
+            p_last = p_it;
+    }
+
+    /* Only consecutive commands are coalesced, to keep the ordering with
+     * other commands */
+    if (group == -1 || !p_last || PlayerCommand_group(p_last) != group)
+        return;
+    if (group == COMMAND_SELECT_TRACKS
+     && p_last->u.tracks.type != p_cmd->u.tracks.type)
+        return;
+    CommandQueue_dropLocked(p_obj, p_last, COMMAND_STATUS_COALESCED);
+}
+
+static int
+CommandQueue_execute(vlcjni_object *p_obj, struct player_command *p_cmd)
+{
+    libvlc_media_player_t *p_mp = p_obj->u.p_mp;
+    int ret = 0;
+
+    switch (p_cmd->type)
+    {
+        case COMMAND_SET_MEDIA:
+            libvlc_media_player_set_media(p_mp, p_cmd->u.p_media);
+            break;
+        case COMMAND_PLAY:
+            ret = libvlc_media_player_play(p_mp);
+            break;
+        case COMMAND_PAUSE:
+            libvlc_media_player_set_pause(p_mp, 1);
+            break;
+        case COMMAND_STOP:
+            MediaPlayer_stop(p_obj);
+            break;
+        case COMMAND_SET_TIME:
+            if (p_cmd->b_scrub)
+            {
+                struct command_queue *p_queue = &p_obj->p_sys->commands;
+                struct scrub_session *p_scrub = &p_obj->p_sys->scrub;
+                int64_t pre_time = libvlc_media_player_get_time(p_mp);
+
+                pthread_mutex_lock(&p_queue->lock);
+                if (p_scrub->b_in_flight
+                 && p_scrub->flight_seq == p_cmd->scrub_seq)
+                {
+                    p_scrub->flight_pre_time = pre_time;
+                    p_scrub->flight_start_us = StatsSampler_now();
+                }
+                pthread_mutex_unlock(&p_queue->lock);
+            }
+            libvlc_media_player_set_time(p_mp, p_cmd->u.time.time,
+                                         p_cmd->u.time.fast);
+            break;
+        case COMMAND_SET_POSITION:
+            libvlc_media_player_set_position(p_mp, p_cmd->u.position.pos,
+                                             p_cmd->u.position.fast);
+            break;
+        case COMMAND_SET_RATE:
+            ret = libvlc_media_player_set_rate(p_mp, p_cmd->u.rate);
+            break;
+        case COMMAND_SET_VOLUME:
+            ret = libvlc_audio_set_volume(p_mp, p_cmd->u.volume);
+            break;
+        case COMMAND_SELECT_TRACKS:
+            libvlc_media_player_select_tracks_by_ids(p_mp,
+                                                     p_cmd->u.tracks.type,
+                                                     p_cmd->u.tracks.psz_ids);
+            break;
+    }
+    return ret == 0 ? COMMAND_STATUS_DONE : COMMAND_STATUS_FAILED;
+}
+
+static void
+CommandQueue_notify(JNIEnv *env, struct command_queue *p_queue,
+                    const struct player_command *p_cmd, int64_t queue_us,
+                    int64_t exec_us)
+{
+    if (!env || !p_cmd->id)
+        return;
+
+    jobject jobj = (*env)->NewLocalRef(env, p_queue->weak);
+    if (!jobj)
+        return;
+
+    (*env)->CallVoidMethod(env, jobj, fields.MediaPlayer_onCommandDoneFromNative,
+                           p_cmd->id, (jint) p_cmd->status, (jlong) queue_us,
+                           (jlong) exec_us);
+    if ((*env)->ExceptionCheck(env))
+        (*env)->ExceptionClear(env);
+    (*env)->DeleteLocalRef(env, jobj);
+}
+
+static void *
+CommandQueue_thread(void *data)
+{
+    vlcjni_object *p_obj = data;
+    struct command_queue *p_queue = &p_obj->p_sys->commands;
+    JNIEnv *env = jni_get_env(THREAD_NAME);
+
+    pthread_mutex_lock(&p_queue->lock);
+    for (;;)
+    {
+        while (!p_queue->p_first && !p_queue->b_stop)
+            pthread_cond_wait(&p_queue->cond, &p_queue->lock);
+
+        struct player_command *p_cmd = p_queue->p_first;
+        if (!p_cmd)
+            break;
+        p_queue->p_first = p_cmd->p_next;
+        if (!p_queue->p_first)
+            p_queue->pp_last = &p_queue->p_first;
+
+        /* Pending commands are cancelled once the player is released */
+        if (p_queue->b_stop && p_cmd->status == COMMAND_STATUS_PENDING)
+            CommandQueue_dropLocked(p_obj, p_cmd, COMMAND_STATUS_CANCELLED);
+
+        int64_t start = StatsSampler_now();
+        int64_t queue_us = start - p_cmd->queued_us;
+        int64_t exec_us = 0;
+
+        if (p_cmd->status == COMMAND_STATUS_PENDING)
+        {
+            /* Don't hold the queue lock while calling libvlc: the caller
+             * must never wait for a command */
+            pthread_mutex_unlock(&p_queue->lock);
+            enum player_command_status status =
+                CommandQueue_execute(p_obj, p_cmd);
+            exec_us = StatsSampler_now() - start;
+            pthread_mutex_lock(&p_queue->lock);
+
+            p_cmd->status = status;
+            uint64_t *p_stats = p_queue->stats;
+            p_stats[COMMAND_STAT_EXECUTED]++;
+            if (status == COMMAND_STATUS_FAILED)
+                p_stats[COMMAND_STAT_FAILED]++;
+            p_stats[COMMAND_STAT_QUEUE_US] += queue_us;
+            if ((uint64_t) queue_us > p_stats[COMMAND_STAT_MAX_QUEUE_US])
+                p_stats[COMMAND_STAT_MAX_QUEUE_US] = queue_us;
+            p_stats[COMMAND_STAT_EXEC_US] += exec_us;
+            if ((uint64_t) exec_us > p_stats[COMMAND_STAT_MAX_EXEC_US])
+                p_stats[COMMAND_STAT_MAX_EXEC_US] = exec_us;
+        }
+        pthread_mutex_unlock(&p_queue->lock);
+
+        CommandQueue_notify(env, p_queue, p_cmd, queue_us, exec_us);
+        PlayerCommand_delete(p_cmd);
+
+        pthread_mutex_lock(&p_queue->lock);
+    }
+    pthread_mutex_unlock(&p_queue->lock);
+    return NULL;
+}
+
+/* Must be called locked. Throws if the worker can't be started. */
+static bool
+CommandQueue_startLocked(JNIEnv *env, jobject thiz, vlcjni_object *p_obj)
+{
+    struct command_queue *p_queue = &p_obj->p_sys->commands;
+
+    if (p_queue->b_running)
+        return true;
+
+    if (!p_queue->weak)
+        p_queue->weak = (*env)->NewWeakGlobalRef(env, thiz);
+    if (!p_queue->weak
+     || pthread_create(&p_queue->thread, NULL, CommandQueue_thread,
+                       p_obj) != 0)
+    {
+        throw_Exception(env, VLCJNI_EX_ILLEGAL_STATE,
+                        "can't start the command queue");
+        return false;
+    }
+    p_queue->b_running = true;
+    return true;
+}
+
+/* Must be called locked, with the worker running. Takes ownership of p_cmd. */
+static void
+CommandQueue_appendLocked(vlcjni_object *p_obj, struct player_command *p_cmd)
+{
+    struct command_queue *p_queue = &p_obj->p_sys->commands;
+
+    p_cmd->status = COMMAND_STATUS_PENDING;
+    p_cmd->queued_us = StatsSampler_now();
+
+    CommandQueue_coalesce(p_obj, p_cmd);
+    *p_queue->pp_last = p_cmd;
+    p_queue->pp_last = &p_cmd->p_next;
+    p_queue->stats[COMMAND_STAT_QUEUED]++;
+    pthread_cond_signal(&p_queue->cond);
+}
+
+/* Takes ownership of p_cmd */
+static void
+CommandQueue_push(JNIEnv *env, jobject thiz, vlcjni_object *p_obj,
+                  struct player_command *p_cmd)
+{
+    struct command_queue *p_queue = &p_obj->p_sys->commands;
+
+    pthread_mutex_lock(&p_queue->lock);
+    if (!CommandQueue_startLocked(env, thiz, p_obj))
+    {
+        pthread_mutex_unlock(&p_queue->lock);
+        PlayerCommand_delete(p_cmd);
+        return;
+    }
+    CommandQueue_appendLocked(p_obj, p_cmd);
+    pthread_mutex_unlock(&p_queue->lock);
+}
+
+/* Must be called locked. Queue a seek of the scrub session. */
+static bool
+ScrubSession_seekLocked(vlcjni_object *p_obj, int64_t target, bool fast,
+                        jlong id)
+{
+    struct command_queue *p_queue = &p_obj->p_sys->commands;
+    struct scrub_session *p_scrub = &p_obj->p_sys->scrub;
+
+    if (!p_queue->b_running || p_queue->b_stop)
+        return false;
+
+    struct player_command *p_cmd = calloc(1, sizeof(*p_cmd));
+    if (!p_cmd)
+        return false;
+    p_cmd->id = id;
+    p_cmd->type = COMMAND_SET_TIME;
+    p_cmd->b_scrub = true;
+    p_cmd->scrub_seq = ++p_scrub->seq;
+    p_cmd->u.time.time = target;
+    p_cmd->u.time.fast = fast;
+
+    /* Can coalesce the previous seek in flight */
+    CommandQueue_appendLocked(p_obj, p_cmd);
+
+    p_scrub->b_in_flight = true;
+    p_scrub->flight_seq = p_cmd->scrub_seq;
+    p_scrub->flight_target = target;
+    p_scrub->flight_queued_us = StatsSampler_now();
+    p_scrub->flight_start_us = 0;
+    p_scrub->seeks++;
+    return true;
+}
+
+/* Must be called locked. There is no seek completion event in libvlc: the
+ * seek is done when the time jumps away from the time before the seek, or
+ * reaches the target. */
+static void
+ScrubSession_onTimeChangedLocked(vlcjni_object *p_obj, int64_t time)
+{
+    struct scrub_session *p_scrub = &p_obj->p_sys->scrub;
+
+    if (!p_scrub->b_in_flight || !p_scrub->flight_start_us)
+        return;
+
+    int64_t now = StatsSampler_now();
+    int64_t elapsed_ms = (now - p_scrub->flight_start_us) / 1000;
+    bool b_continuous = time >= p_scrub->flight_pre_time - SCRUB_DISCONTINUITY_MS
+        && time <= p_scrub->flight_pre_time + elapsed_ms + SCRUB_DISCONTINUITY_MS;
+    bool b_reached = llabs(time - p_scrub->flight_target) <= SCRUB_DISCONTINUITY_MS;
+    if (b_continuous && !b_reached)
+        return;
+
+    p_scrub->latencies[p_scrub->latency_next] = now - p_scrub->flight_start_us;
+    p_scrub->latency_next = (p_scrub->latency_next + 1) % SCRUB_LATENCY_COUNT;
+    if (p_scrub->latency_count < SCRUB_LATENCY_COUNT)
+        p_scrub->latency_count++;
+    p_scrub->b_in_flight = false;
+
+    if (p_scrub->b_active && p_scrub->b_has_target)
+    {
+        p_scrub->b_has_target = false;
+        ScrubSession_seekLocked(p_obj, p_scrub->target, true, 0);
+    }
+}
+
+/* Wait for the running command, pending ones are reported as cancelled */
+static void
+CommandQueue_stop(JNIEnv *env, vlcjni_object *p_obj)
+{
+    struct command_queue *p_queue = &p_obj->p_sys->commands;
+
+    pthread_mutex_lock(&p_queue->lock);
+    bool b_running = p_queue->b_running;
+    p_queue->b_stop = true;
+    pthread_cond_signal(&p_queue->cond);
+    pthread_mutex_unlock(&p_queue->lock);
+
+#if defined(LIBVLC_VERSION_MAJOR) && LIBVLC_VERSION_MAJOR >= 4
+    /* Events are already detached: don't let a running stop command wait for
+     * the Stopped event, libvlc_media_player_release() finishes the stop */
+    pthread_mutex_lock(&p_obj->p_sys->stop_lock);
+    p_obj->p_sys->released = true;
+    p_obj->p_sys->stopped = true;
+    pthread_cond_broadcast(&p_obj->p_sys->stop_cond);
+    pthread_mutex_unlock(&p_obj->p_sys->stop_lock);
+#endif
+
+    if (b_running)
+        pthread_join(p_queue->thread, NULL);
+    p_queue->b_running = false;
+    if (p_queue->weak)
+    {
+        (*env)->DeleteWeakGlobalRef(env, p_queue->weak);
+        p_queue->weak = NULL;
+    }
+}
+
 static void
 MediaPlayer_newCommon(JNIEnv *env, jobject thiz, vlcjni_object *p_obj,
                       jobject jwindow)
@@ -170,6 +883,17 @@ MediaPlayer_newCommon(JNIEnv *env, jobject thiz, vlcjni_object *p_obj,
     p_obj->p_sys->stopped = true;
 #endif
 
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_mutex_init(&p_obj->p_sys->sampler.lock, NULL);
+    pthread_cond_init(&p_obj->p_sys->sampler.cond, &attr);
+    pthread_condattr_destroy(&attr);
+
+    pthread_mutex_init(&p_obj->p_sys->commands.lock, NULL);
+    pthread_cond_init(&p_obj->p_sys->commands.cond, NULL);
+    p_obj->p_sys->commands.pp_last = &p_obj->p_sys->commands.p_first;
+
     VLCJniObject_attachEvents(p_obj, MediaPlayer_event_cb,
                               libvlc_media_player_event_manager(p_obj->u.p_mp),
                               mp_events);
@@ -219,8 +943,18 @@ Java_org_videolan_libvlc_MediaPlayer_nativeRelease(JNIEnv *env, jobject thiz)
     if (!p_obj)
         return;
 
+    CommandQueue_stop(env, p_obj);
+    StatsSampler_stop(p_obj);
+    pthread_mutex_destroy(&p_obj->p_sys->sampler.lock);
+    pthread_cond_destroy(&p_obj->p_sys->sampler.cond);
+    free(p_obj->p_sys->sampler.p_samples);
+
     libvlc_media_player_release(p_obj->u.p_mp);
 
+    /* Used by the event callback */
+    pthread_mutex_destroy(&p_obj->p_sys->commands.lock);
+    pthread_cond_destroy(&p_obj->p_sys->commands.cond);
+
     if (p_obj->p_sys && p_obj->p_sys->jwindow)
         (*env)->DeleteGlobalRef(env, p_obj->p_sys->jwindow);
 
@@ -358,21 +1092,7 @@ Java_org_videolan_libvlc_MediaPlayer_nativeStop(JNIEnv *env, jobject thiz)
     if (!p_obj)
         return;
 
-#if defined(LIBVLC_VERSION_MAJOR) && LIBVLC_VERSION_MAJOR >= 4
-    /* XXX: temporary during the VLC 3.0 -> 4.0 transition. The Java API need
-     * to be updated to handle async stop (only?). */
-    pthread_mutex_lock(&p_obj->p_sys->stop_lock);
-    p_obj->p_sys->stopped = false;
-    int ret = libvlc_media_player_stop_async(p_obj->u.p_mp);
-    if (ret == 0)
-        while (!p_obj->p_sys->stopped)
-            pthread_cond_wait(&p_obj->p_sys->stop_cond, &p_obj->p_sys->stop_lock);
-    else
-        p_obj->p_sys->stopped = true;
-    pthread_mutex_unlock(&p_obj->p_sys->stop_lock);
-#else
-    libvlc_media_player_stop(p_obj->u.p_mp);
-#endif
+    MediaPlayer_stop(p_obj);
 }
 
 void
@@ -1069,6 +1789,501 @@ Java_org_videolan_libvlc_MediaPlayer_nativeRecord(JNIEnv *env, jobject thiz,
     return ret;
 }
 
+jboolean
+Java_org_videolan_libvlc_MediaPlayer_nativeStartStatsSampler(JNIEnv *env,
+                                                             jobject thiz,
+                                                             jint interval,
+                                                             jint capacity)
+{
+    vlcjni_object *p_obj = VLCJniObject_getInstance(env, thiz);
+
+    if (!p_obj)
+        return false;
+
+    if (interval <= 0 || capacity <= 0)
+    {
+        throw_Exception(env, VLCJNI_EX_ILLEGAL_ARGUMENT,
+                        "interval or capacity invalid");
+        return false;
+    }
+
+    struct stats_sample *p_samples = malloc(capacity * sizeof(*p_samples));
+    if (!p_samples)
+    {
+        throw_Exception(env, VLCJNI_EX_OUT_OF_MEMORY, "stats samples");
+        return false;
+    }
+
+    /* Restart with the new parameters */
+    StatsSampler_stop(p_obj);
+
+    struct stats_sampler *p_sampler = &p_obj->p_sys->sampler;
+
+    pthread_mutex_lock(&p_sampler->lock);
+    free(p_sampler->p_samples);
+    p_sampler->p_samples = p_samples;
+    p_sampler->capacity = capacity;
+    p_sampler->count = p_sampler->next = 0;
+    p_sampler->interval_ms = interval;
+    p_sampler->b_has_prev = false;
+    p_sampler->b_running =
+        pthread_create(&p_sampler->thread, NULL, StatsSampler_thread, p_obj) == 0;
+    pthread_mutex_unlock(&p_sampler->lock);
+
+    return p_sampler->b_running;
+}
+
+void
+Java_org_videolan_libvlc_MediaPlayer_nativeStopStatsSampler(JNIEnv *env,
+                                                            jobject thiz)
+{
+    vlcjni_object *p_obj = VLCJniObject_getInstance(env, thiz);
+
+    if (!p_obj)
+        return;
+
+    StatsSampler_stop(p_obj);
+}
+
+jobject
+Java_org_videolan_libvlc_MediaPlayer_nativeGetStatsSeries(JNIEnv *env,
+                                                          jobject thiz)
+{
+    vlcjni_object *p_obj = VLCJniObject_getInstance(env, thiz);
+    struct stats_sample *p_copy;
+    size_t count;
+
+    if (!p_obj)
+        return NULL;
+
+    struct stats_sampler *p_sampler = &p_obj->p_sys->sampler;
+
+    /* Copy in chronological order and release the lock before touching the
+     * JVM */
+    pthread_mutex_lock(&p_sampler->lock);
+    if (!p_sampler->p_samples)
+    {
+        pthread_mutex_unlock(&p_sampler->lock);
+        return NULL;
+    }
+    count = p_sampler->count;
+    p_copy = malloc((count ? count : 1) * sizeof(*p_copy));
+    if (p_copy)
+    {
+        size_t first = (p_sampler->next + p_sampler->capacity - count)
+                     % p_sampler->capacity;
+        for (size_t i = 0; i < count; ++i)
+            p_copy[i] = p_sampler->p_samples[(first + i) % p_sampler->capacity];
+    }
+    pthread_mutex_unlock(&p_sampler->lock);
+
+    if (!p_copy)
+    {
+        throw_Exception(env, VLCJNI_EX_OUT_OF_MEMORY, "stats samples");
+        return NULL;
+    }
+
+    jobject jseries = NULL;
+    jlongArray jtimes = (*env)->NewLongArray(env, count);
+    jfloatArray jrates[7];
+    for (size_t i = 0; i < ARRAY_SIZE(jrates); ++i)
+        jrates[i] = jtimes ? (*env)->NewFloatArray(env, count) : NULL;
+    jlong *p_times = malloc((count ? count : 1) * sizeof(*p_times));
+    float *p_values = malloc((count ? count : 1) * sizeof(*p_values));
+
+    bool b_ok = jtimes && p_times && p_values;
+    for (size_t i = 0; b_ok && i < ARRAY_SIZE(jrates); ++i)
+        b_ok = jrates[i] != NULL;
+    if (!b_ok)
+        goto end;
+
+    for (size_t i = 0; i < count; ++i)
+        p_times[i] = p_copy[i].time_ms;
+    (*env)->SetLongArrayRegion(env, jtimes, 0, count, p_times);
+
+#define FILL(idx, field) do { \
+    for (size_t i = 0; i < count; ++i) \
+        p_values[i] = p_copy[i].field; \
+    (*env)->SetFloatArrayRegion(env, jrates[idx], 0, count, p_values); \
+} while (0)
+    FILL(0, input_bitrate);
+    FILL(1, demux_bitrate);
+    FILL(2, decoded_fps);
+    FILL(3, displayed_fps);
+    FILL(4, lost_pictures);
+    FILL(5, late_pictures);
+    FILL(6, lost_abuffers);
+#undef FILL
+
+    jseries = (*env)->CallStaticObjectMethod(env, fields.MediaPlayer_clazz,
+                                             fields.MediaPlayer_createStatsSeriesFromNative,
+                                             jtimes, jrates[0], jrates[1],
+                                             jrates[2], jrates[3], jrates[4],
+                                             jrates[5], jrates[6]);
+end:
+    if (jtimes)
+        (*env)->DeleteLocalRef(env, jtimes);
+    for (size_t i = 0; i < ARRAY_SIZE(jrates); ++i)
+        if (jrates[i])
+            (*env)->DeleteLocalRef(env, jrates[i]);
+    free(p_times);
+    free(p_values);
+    free(p_copy);
+    return jseries;
+}
+
+void
+Java_org_videolan_libvlc_MediaPlayer_nativeQueueCommand(JNIEnv *env,
+                                                        jobject thiz,
+                                                        jlong id, jint type,
+                                                        jobject jmedia,
+                                                        jlong larg, jfloat farg,
+                                                        jboolean fast,
+                                                        jstring jsarg)
+{
+    vlcjni_object *p_obj = VLCJniObject_getInstance(env, thiz);
+
+    if (!p_obj)
+        return;
+
+    if (type < COMMAND_SET_MEDIA || type > COMMAND_SELECT_TRACKS)
+    {
+        throw_Exception(env, VLCJNI_EX_ILLEGAL_ARGUMENT, "invalid command");
+        return;
+    }
+
+    struct player_command *p_cmd = calloc(1, sizeof(*p_cmd));
+    if (!p_cmd)
+    {
+        throw_Exception(env, VLCJNI_EX_OUT_OF_MEMORY, "player_command");
+        return;
+    }
+    p_cmd->id = id;
+    p_cmd->type = type;
+
+    switch (type)
+    {
+        case COMMAND_SET_MEDIA:
+            if (jmedia)
+            {
+                vlcjni_object *p_m_obj = VLCJniObject_getInstance(env, jmedia);
+
+                if (!p_m_obj)
+                {
+                    free(p_cmd);
+                    return;
+                }
+                /* The Java Media can be released before the command runs */
+                p_cmd->u.p_media = p_m_obj->u.p_m;
+                libvlc_media_retain(p_cmd->u.p_media);
+            }
+            break;
+        case COMMAND_SET_TIME:
+            p_cmd->u.time.time = larg;
+            p_cmd->u.time.fast = fast;
+            break;
+        case COMMAND_SET_POSITION:
+            p_cmd->u.position.pos = farg;
+            p_cmd->u.position.fast = fast;
+            break;
+        case COMMAND_SET_RATE:
+            p_cmd->u.rate = farg;
+            break;
+        case COMMAND_SET_VOLUME:
+            p_cmd->u.volume = larg;
+            break;
+        case COMMAND_SELECT_TRACKS:
+            p_cmd->u.tracks.type = larg;
+            if (jsarg)
+            {
+                const char *psz_ids = (*env)->GetStringUTFChars(env, jsarg, 0);
+                if (!psz_ids)
+                {
+                    free(p_cmd);
+                    throw_Exception(env, VLCJNI_EX_ILLEGAL_ARGUMENT,
+                                    "tracks str invalid");
+                    return;
+                }
+                p_cmd->u.tracks.psz_ids = strdup(psz_ids);
+                (*env)->ReleaseStringUTFChars(env, jsarg, psz_ids);
+                if (!p_cmd->u.tracks.psz_ids)
+                {
+                    free(p_cmd);
+                    throw_Exception(env, VLCJNI_EX_OUT_OF_MEMORY,
+                                    "player_command");
+                    return;
+                }
+            }
+            break;
+        default:
+            break;
+    }
+
+    CommandQueue_push(env, thiz, p_obj, p_cmd);
+}
+
+/* Returns true if the command was still pending, it is then reported as
+ * cancelled */
+jboolean
+Java_org_videolan_libvlc_MediaPlayer_nativeCancelCommand(JNIEnv *env,
+                                                         jobject thiz,
+                                                         jlong id)
+{
+    vlcjni_object *p_obj = VLCJniObject_getInstance(env, thiz);
+    bool b_cancelled = false;
+
+    if (!p_obj)
+        return false;
+
+    struct command_queue *p_queue = &p_obj->p_sys->commands;
+
+    pthread_mutex_lock(&p_queue->lock);
+    for (struct player_command *p_cmd = p_queue->p_first; p_cmd;
+         p_cmd = p_cmd->p_next)
+    {
+        if (p_cmd->id == id)
+        {
+            if (p_cmd->status == COMMAND_STATUS_PENDING)
+            {
+                CommandQueue_dropLocked(p_obj, p_cmd,
+                                        COMMAND_STATUS_CANCELLED);
+                b_cancelled = true;
+            }
+            break;
+        }
+    }
+    pthread_mutex_unlock(&p_queue->lock);
+
+    return b_cancelled;
+}
+
+void
+Java_org_videolan_libvlc_MediaPlayer_nativeGetCommandStats(JNIEnv *env,
+                                                           jobject thiz,
+                                                           jlongArray jstats)
+{
+    vlcjni_object *p_obj = VLCJniObject_getInstance(env, thiz);
+    jlong stats[COMMAND_STAT_COUNT];
+
+    if (!p_obj)
+        return;
+
+    if ((*env)->GetArrayLength(env, jstats) < COMMAND_STAT_COUNT)
+    {
+        throw_Exception(env, VLCJNI_EX_ILLEGAL_ARGUMENT, "invalid arguments");
+        return;
+    }
+
+    struct command_queue *p_queue = &p_obj->p_sys->commands;
+
+    pthread_mutex_lock(&p_queue->lock);
+    for (size_t i = 0; i < COMMAND_STAT_COUNT; ++i)
+        stats[i] = p_queue->stats[i];
+    pthread_mutex_unlock(&p_queue->lock);
+
+    (*env)->SetLongArrayRegion(env, jstats, 0, COMMAND_STAT_COUNT, stats);
+}
+
+void
+Java_org_videolan_libvlc_MediaPlayer_nativeScrubStart(JNIEnv *env,
+                                                      jobject thiz)
+{
+    vlcjni_object *p_obj = VLCJniObject_getInstance(env, thiz);
+
+    if (!p_obj)
+        return;
+
+    struct command_queue *p_queue = &p_obj->p_sys->commands;
+    struct scrub_session *p_scrub = &p_obj->p_sys->scrub;
+
+    pthread_mutex_lock(&p_queue->lock);
+    if (CommandQueue_startLocked(env, thiz, p_obj))
+    {
+        p_scrub->b_active = true;
+        p_scrub->b_has_target = p_scrub->b_has_last = false;
+    }
+    pthread_mutex_unlock(&p_queue->lock);
+}
+
+void
+Java_org_videolan_libvlc_MediaPlayer_nativeScrubTo(JNIEnv *env, jobject thiz,
+                                                   jlong time)
+{
+    vlcjni_object *p_obj = VLCJniObject_getInstance(env, thiz);
+
+    if (!p_obj)
+        return;
+
+    struct command_queue *p_queue = &p_obj->p_sys->commands;
+    struct scrub_session *p_scrub = &p_obj->p_sys->scrub;
+
+    pthread_mutex_lock(&p_queue->lock);
+    if (!p_scrub->b_active)
+    {
+        pthread_mutex_unlock(&p_queue->lock);
+        throw_Exception(env, VLCJNI_EX_ILLEGAL_STATE, "not scrubbing");
+        return;
+    }
+
+    p_scrub->requests++;
+    p_scrub->b_has_last = true;
+    p_scrub->last_target = time;
+
+    bool b_timeout = p_scrub->b_in_flight
+        && StatsSampler_now() - p_scrub->flight_queued_us > SCRUB_SEEK_TIMEOUT_US;
+    if (b_timeout)
+        p_scrub->timeouts++;
+
+    /* Keyframe seeks while dragging, only the latest target is kept while a
+     * seek is in flight */
+    if (!p_scrub->b_in_flight || b_timeout)
+    {
+        p_scrub->b_has_target = false;
+        ScrubSession_seekLocked(p_obj, time, true, 0);
+    }
+    else
+    {
+        p_scrub->b_has_target = true;
+        p_scrub->target = time;
+    }
+    pthread_mutex_unlock(&p_queue->lock);
+}
+
+/* Returns true if the last target was queued with the id */
+jboolean
+Java_org_videolan_libvlc_MediaPlayer_nativeScrubStop(JNIEnv *env, jobject thiz,
+                                                     jlong id, jboolean precise)
+{
+    vlcjni_object *p_obj = VLCJniObject_getInstance(env, thiz);
+    bool b_queued = false;
+
+    if (!p_obj)
+        return false;
+
+    struct command_queue *p_queue = &p_obj->p_sys->commands;
+    struct scrub_session *p_scrub = &p_obj->p_sys->scrub;
+
+    pthread_mutex_lock(&p_queue->lock);
+    if (p_scrub->b_active)
+    {
+        p_scrub->b_active = false;
+        p_scrub->b_has_target = false;
+        /* Coalesces the pending keyframe seek if it was not run yet */
+        if (p_scrub->b_has_last)
+            b_queued = ScrubSession_seekLocked(p_obj, p_scrub->last_target,
+                                               !precise, id);
+    }
+    pthread_mutex_unlock(&p_queue->lock);
+
+    return b_queued;
+}
+
+/* Returns the latest seek latencies, oldest first */
+jlongArray
+Java_org_videolan_libvlc_MediaPlayer_nativeGetScrubStats(JNIEnv *env,
+                                                         jobject thiz,
+                                                         jlongArray jcounters)
+{
+    vlcjni_object *p_obj = VLCJniObject_getInstance(env, thiz);
+    jlong latencies[SCRUB_LATENCY_COUNT];
+    jlong counters[3];
+    size_t count;
+
+    if (!p_obj)
+        return NULL;
+
+    if ((*env)->GetArrayLength(env, jcounters) < (jsize) ARRAY_SIZE(counters))
+    {
+        throw_Exception(env, VLCJNI_EX_ILLEGAL_ARGUMENT, "invalid arguments");
+        return NULL;
+    }
+
+    struct command_queue *p_queue = &p_obj->p_sys->commands;
+    struct scrub_session *p_scrub = &p_obj->p_sys->scrub;
+
+    pthread_mutex_lock(&p_queue->lock);
+    counters[0] = p_scrub->requests;
+    counters[1] = p_scrub->seeks;
+    counters[2] = p_scrub->timeouts;
+    count = p_scrub->latency_count;
+    size_t first = (p_scrub->latency_next + SCRUB_LATENCY_COUNT - count)
+                 % SCRUB_LATENCY_COUNT;
+    for (size_t i = 0; i < count; ++i)
+        latencies[i] = p_scrub->latencies[(first + i) % SCRUB_LATENCY_COUNT];
+    pthread_mutex_unlock(&p_queue->lock);
+
+    (*env)->SetLongArrayRegion(env, jcounters, 0, ARRAY_SIZE(counters),
+                               counters);
+
+    jlongArray jlatencies = (*env)->NewLongArray(env, count);
+    if (jlatencies)
+        (*env)->SetLongArrayRegion(env, jlatencies, 0, count, latencies);
+    return jlatencies;
+}
+
+/* Keep in sync with MediaPlayer.State */
+enum player_state_index
+{
+    STATE_PLAYER_STATE,
+    STATE_TIME,
+    STATE_LENGTH,
+    STATE_POSITION,
+    STATE_PLAYING,
+    STATE_SEEKABLE,
+    STATE_RATE,
+    STATE_VOLUME,
+    STATE_AUDIO_DELAY,
+    STATE_SPU_DELAY,
+    STATE_TITLE,
+    STATE_CHAPTER,
+    STATE_COUNT,
+};
+
+/* Floats are stored as their IEEE 754 bits, see Float.intBitsToFloat() */
+static jlong
+float_bits(float value)
+{
+    int32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+/* Read the state values back to back, without any JVM call in between */
+void
+Java_org_videolan_libvlc_MediaPlayer_nativeGetState(JNIEnv *env, jobject thiz,
+                                                    jlongArray jstate)
+{
+    vlcjni_object *p_obj = VLCJniObject_getInstance(env, thiz);
+    jlong state[STATE_COUNT];
+
+    if (!p_obj)
+        return;
+
+    if ((*env)->GetArrayLength(env, jstate) < STATE_COUNT)
+    {
+        throw_Exception(env, VLCJNI_EX_ILLEGAL_ARGUMENT, "invalid arguments");
+        return;
+    }
+
+    libvlc_media_player_t *p_mp = p_obj->u.p_mp;
+
+    state[STATE_PLAYER_STATE] = libvlc_media_player_get_state(p_mp);
+    state[STATE_TIME] = libvlc_media_player_get_time(p_mp);
+    state[STATE_LENGTH] = libvlc_media_player_get_length(p_mp);
+    state[STATE_POSITION] =
+        float_bits(libvlc_media_player_get_position(p_mp));
+    state[STATE_PLAYING] = !!libvlc_media_player_is_playing(p_mp);
+    state[STATE_SEEKABLE] = !!libvlc_media_player_is_seekable(p_mp);
+    state[STATE_RATE] = float_bits(libvlc_media_player_get_rate(p_mp));
+    state[STATE_VOLUME] = libvlc_audio_get_volume(p_mp);
+    state[STATE_AUDIO_DELAY] = libvlc_audio_get_delay(p_mp);
+    state[STATE_SPU_DELAY] = libvlc_video_get_spu_delay(p_mp);
+    state[STATE_TITLE] = libvlc_media_player_get_title(p_mp);
+    state[STATE_CHAPTER] = libvlc_media_player_get_chapter(p_mp);
+
+    (*env)->SetLongArrayRegion(env, jstate, 0, STATE_COUNT, state);
+}
+
 jint
 Java_org_videolan_libvlc_MediaPlayer_00024Equalizer_nativeGetPresetCount(JNIEnv *env,
                                                                          jobject thiz)
@@ -0,0 +1,505 @@
+/*****************************************************************************
+ * libvlcjni-playliststore.c
+ *****************************************************************************
+ * Copyright © 2023 VLC authors, VideoLAN and VideoLabs
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "libvlcjni-vlcobject.h"
+#include "playliststore.h"
+#include "playlistparser.h"
+
+/* Bytes parsed between two progress reports */
+#define LOAD_PROGRESS_SIZE (1024 * 1024)
+
+static playlist_store *
+PlaylistStore_getInstance(JNIEnv *env, jobject thiz)
+{
+    intptr_t i_ptr = (intptr_t)
+        (*env)->GetLongField(env, thiz, fields.PlaylistStore_mInstance);
+    if (!i_ptr)
+        throw_Exception(env, VLCJNI_EX_ILLEGAL_STATE,
+                        "can't get PlaylistStore instance");
+    return (playlist_store *) i_ptr;
+}
+
+static bool
+PlaylistStore_checkIndex(JNIEnv *env, playlist_store *p_store, jint index)
+{
+    if (index < 0 || (uint32_t) index >= playlist_store_Count(p_store))
+    {
+        throw_Exception(env, VLCJNI_EX_ILLEGAL_ARGUMENT, "invalid index");
+        return false;
+    }
+    return true;
+}
+
+void
+Java_org_videolan_libvlc_PlaylistStore_nativeNew(JNIEnv *env, jobject thiz)
+{
+    playlist_store *p_store = playlist_store_New();
+
+    if (!p_store)
+    {
+        throw_Exception(env, VLCJNI_EX_OUT_OF_MEMORY, "PlaylistStore");
+        return;
+    }
+    (*env)->SetLongField(env, thiz, fields.PlaylistStore_mInstance,
+                         (jlong)(intptr_t) p_store);
+}
+
+void
+Java_org_videolan_libvlc_PlaylistStore_nativeRelease(JNIEnv *env, jobject thiz)
+{
+    playlist_store *p_store = (playlist_store *)(intptr_t)
+        (*env)->GetLongField(env, thiz, fields.PlaylistStore_mInstance);
+
+    if (!p_store)
+        return;
+
+    playlist_store_Delete(p_store);
+    (*env)->SetLongField(env, thiz, fields.PlaylistStore_mInstance, 0);
+}
+
+/* Get the UTF-8 string at index of jarray, NULL if jarray or the element is
+ * NULL. The local reference is returned in *pjstr to release the string. */
+static const char *
+PlaylistStore_getString(JNIEnv *env, jobjectArray jarray, jsize index,
+                        jstring *pjstr)
+{
+    *pjstr = jarray ? (*env)->GetObjectArrayElement(env, jarray, index) : NULL;
+    return *pjstr ? (*env)->GetStringUTFChars(env, *pjstr, 0) : NULL;
+}
+
+static void
+PlaylistStore_releaseString(JNIEnv *env, jstring jstr, const char *psz)
+{
+    if (psz)
+        (*env)->ReleaseStringUTFChars(env, jstr, psz);
+    if (jstr)
+        (*env)->DeleteLocalRef(env, jstr);
+}
+
+/* Append entries from parallel arrays, only jmrls is mandatory. Entries
+ * without mrl are skipped. Returns the number of entries added. */
+jint
+Java_org_videolan_libvlc_PlaylistStore_nativeAdd(JNIEnv *env, jobject thiz,
+                                                 jobjectArray jmrls,
+                                                 jobjectArray jtitles,
+                                                 jobjectArray jartists,
+                                                 jobjectArray jalbums,
+                                                 jlongArray jdurations)
+{
+    playlist_store *p_store = PlaylistStore_getInstance(env, thiz);
+    jobjectArray jarrays[PLAYLIST_FIELD_COUNT] = {
+        jmrls, jtitles, jartists, jalbums,
+    };
+    jlong *p_durations = NULL;
+    jint added = 0;
+
+    if (!p_store)
+        return 0;
+
+    if (!jmrls)
+    {
+        throw_Exception(env, VLCJNI_EX_ILLEGAL_ARGUMENT, "mrls invalid");
+        return 0;
+    }
+
+    jsize count = (*env)->GetArrayLength(env, jmrls);
+    for (int i = 1; i < PLAYLIST_FIELD_COUNT; ++i)
+        if (jarrays[i] && (*env)->GetArrayLength(env, jarrays[i]) < count)
+        {
+            throw_Exception(env, VLCJNI_EX_ILLEGAL_ARGUMENT,
+                            "arrays length mismatch");
+            return 0;
+        }
+    if (jdurations)
+    {
+        if ((*env)->GetArrayLength(env, jdurations) < count)
+        {
+            throw_Exception(env, VLCJNI_EX_ILLEGAL_ARGUMENT,
+                            "arrays length mismatch");
+            return 0;
+        }
+        p_durations = (*env)->GetLongArrayElements(env, jdurations, NULL);
+        if (!p_durations)
+            return 0;
+    }
+
+    for (jsize i = 0; i < count; ++i)
+    {
+        jstring jstrs[PLAYLIST_FIELD_COUNT];
+        const char *ppsz[PLAYLIST_FIELD_COUNT];
+
+        for (int j = 0; j < PLAYLIST_FIELD_COUNT; ++j)
+            ppsz[j] = PlaylistStore_getString(env, jarrays[j], i, &jstrs[j]);
+
+        int ret = ppsz[PLAYLIST_FIELD_MRL]
+                ? playlist_store_Add(p_store, ppsz,
+                                     p_durations ? p_durations[i] : -1)
+                : 1;
+
+        for (int j = 0; j < PLAYLIST_FIELD_COUNT; ++j)
+            PlaylistStore_releaseString(env, jstrs[j], ppsz[j]);
+
+        if (ret < 0)
+        {
+            throw_Exception(env, VLCJNI_EX_OUT_OF_MEMORY, "PlaylistStore");
+            break;
+        }
+        if (ret == 0)
+            added++;
+    }
+
+    if (p_durations)
+        (*env)->ReleaseLongArrayElements(env, jdurations, p_durations,
+                                         JNI_ABORT);
+    return added;
+}
+
+void
+Java_org_videolan_libvlc_PlaylistStore_nativeClear(JNIEnv *env, jobject thiz)
+{
+    playlist_store *p_store = PlaylistStore_getInstance(env, thiz);
+
+    if (p_store)
+        playlist_store_Clear(p_store);
+}
+
+jint
+Java_org_videolan_libvlc_PlaylistStore_nativeGetCount(JNIEnv *env,
+                                                      jobject thiz,
+                                                      jboolean total)
+{
+    playlist_store *p_store = PlaylistStore_getInstance(env, thiz);
+
+    if (!p_store)
+        return 0;
+    return total ? playlist_store_TotalCount(p_store)
+                 : playlist_store_Count(p_store);
+}
+
+jstring
+Java_org_videolan_libvlc_PlaylistStore_nativeGetString(JNIEnv *env,
+                                                       jobject thiz,
+                                                       jint index,
+                                                       jint field)
+{
+    playlist_store *p_store = PlaylistStore_getInstance(env, thiz);
+
+    if (!p_store || !PlaylistStore_checkIndex(env, p_store, index))
+        return NULL;
+    if (field < 0 || field >= PLAYLIST_FIELD_COUNT)
+    {
+        throw_Exception(env, VLCJNI_EX_ILLEGAL_ARGUMENT, "invalid field");
+        return NULL;
+    }
+
+    const char *psz = playlist_store_GetString(p_store, index, field);
+    return *psz ? vlcNewStringUTF(env, psz) : NULL;
+}
+
+/* Strings of a field for the [start, start + count[ range, for list views */
+jobjectArray
+Java_org_videolan_libvlc_PlaylistStore_nativeGetStrings(JNIEnv *env,
+                                                        jobject thiz,
+                                                        jint field,
+                                                        jint start,
+                                                        jint count)
+{
+    playlist_store *p_store = PlaylistStore_getInstance(env, thiz);
+
+    if (!p_store)
+        return NULL;
+    uint32_t store_count = playlist_store_Count(p_store);
+    if (field < 0 || field >= PLAYLIST_FIELD_COUNT || start < 0 || count < 0
+     || (uint32_t) start > store_count
+     || (uint32_t) count > store_count - (uint32_t) start)
+    {
+        throw_Exception(env, VLCJNI_EX_ILLEGAL_ARGUMENT, "invalid arguments");
+        return NULL;
+    }
+
+    jobjectArray jarray = (*env)->NewObjectArray(env, count,
+                                                 fields.String_clazz, NULL);
+    if (!jarray)
+        return NULL;
+
+    for (jint i = 0; i < count; ++i)
+    {
+        const char *psz = playlist_store_GetString(p_store, start + i, field);
+        if (!*psz)
+            continue;
+        jstring jstr = vlcNewStringUTF(env, psz);
+        if (jstr)
+        {
+            (*env)->SetObjectArrayElement(env, jarray, i, jstr);
+            (*env)->DeleteLocalRef(env, jstr);
+        }
+    }
+    return jarray;
+}
+
+jlong
+Java_org_videolan_libvlc_PlaylistStore_nativeGetDuration(JNIEnv *env,
+                                                         jobject thiz,
+                                                         jint index)
+{
+    playlist_store *p_store = PlaylistStore_getInstance(env, thiz);
+
+    if (!p_store || !PlaylistStore_checkIndex(env, p_store, index))
+        return -1;
+    return playlist_store_GetDuration(p_store, index);
+}
+
+void
+Java_org_videolan_libvlc_PlaylistStore_nativeSort(JNIEnv *env, jobject thiz,
+                                                  jint key,
+                                                  jboolean ascending)
+{
+    playlist_store *p_store = PlaylistStore_getInstance(env, thiz);
+
+    if (!p_store)
+        return;
+    if (key < 0 || key > PLAYLIST_SORT_NONE)
+    {
+        throw_Exception(env, VLCJNI_EX_ILLEGAL_ARGUMENT, "invalid sort key");
+        return;
+    }
+    if (playlist_store_Sort(p_store, key, ascending) != 0)
+        throw_Exception(env, VLCJNI_EX_OUT_OF_MEMORY, "PlaylistStore sort");
+}
+
+void
+Java_org_videolan_libvlc_PlaylistStore_nativeSetFilter(JNIEnv *env,
+                                                       jobject thiz,
+                                                       jstring jquery)
+{
+    playlist_store *p_store = PlaylistStore_getInstance(env, thiz);
+    const char *psz_query = NULL;
+
+    if (!p_store)
+        return;
+
+    if (jquery && !(psz_query = (*env)->GetStringUTFChars(env, jquery, 0)))
+        return;
+
+    if (playlist_store_SetFilter(p_store, psz_query) != 0)
+        throw_Exception(env, VLCJNI_EX_OUT_OF_MEMORY, "PlaylistStore filter");
+
+    if (psz_query)
+        (*env)->ReleaseStringUTFChars(env, jquery, psz_query);
+}
+
+jlong
+Java_org_videolan_libvlc_PlaylistStore_nativeGetMemoryUsage(JNIEnv *env,
+                                                            jobject thiz)
+{
+    playlist_store *p_store = PlaylistStore_getInstance(env, thiz);
+
+    return p_store ? (jlong) playlist_store_MemoryUsage(p_store) : 0;
+}
+
+static playlist_parser *
+PlaylistStore_newParser(JNIEnv *env, playlist_store *p_store, jstring jbase)
+{
+    const char *psz_base = NULL;
+
+    if (jbase && !(psz_base = (*env)->GetStringUTFChars(env, jbase, 0)))
+        return NULL;
+    playlist_parser *p_parser = playlist_parser_New(p_store, psz_base);
+    if (psz_base)
+        (*env)->ReleaseStringUTFChars(env, jbase, psz_base);
+    if (!p_parser)
+        throw_Exception(env, VLCJNI_EX_OUT_OF_MEMORY, "PlaylistParser");
+    return p_parser;
+}
+
+/* Returns false if the listener cancelled the load */
+static bool
+PlaylistStore_progress(JNIEnv *env, jobject jlistener,
+                       const playlist_parser *p_parser, jlong read, jlong total)
+{
+    if (!jlistener)
+        return true;
+    jboolean b_continue = (*env)->CallBooleanMethod(env, jlistener,
+                              fields.PlaylistStore_ProgressListener_onProgress,
+                              (jint) playlist_parser_Count(p_parser), read,
+                              total);
+    return !(*env)->ExceptionCheck(env) && b_continue;
+}
+
+/* Parse a local playlist, mapped in memory, into the store. result receives
+ * the number of entries added, the bytes parsed and 1 if cancelled. */
+void
+Java_org_videolan_libvlc_PlaylistStore_nativeLoadFile(JNIEnv *env,
+                                                      jobject thiz,
+                                                      jstring jpath,
+                                                      jstring jbase,
+                                                      jobject jlistener,
+                                                      jlongArray jresult)
+{
+    playlist_store *p_store = PlaylistStore_getInstance(env, thiz);
+    const char *psz_path;
+
+    if (!p_store)
+        return;
+    if (!jpath || (*env)->GetArrayLength(env, jresult) < 3)
+    {
+        throw_Exception(env, VLCJNI_EX_ILLEGAL_ARGUMENT, "invalid arguments");
+        return;
+    }
+    if (!(psz_path = (*env)->GetStringUTFChars(env, jpath, 0)))
+        return;
+    int fd = open(psz_path, O_RDONLY | O_CLOEXEC);
+    (*env)->ReleaseStringUTFChars(env, jpath, psz_path);
+
+    struct stat st;
+    if (fd == -1 || fstat(fd, &st) != 0 || !S_ISREG(st.st_mode))
+    {
+        if (fd != -1)
+            close(fd);
+        throw_Exception(env, VLCJNI_EX_ILLEGAL_ARGUMENT, "can't open playlist");
+        return;
+    }
+
+    playlist_parser *p_parser = PlaylistStore_newParser(env, p_store, jbase);
+    if (!p_parser)
+    {
+        close(fd);
+        return;
+    }
+
+    size_t size = st.st_size;
+    const char *p_map = size > 0
+        ? mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0) : NULL;
+    close(fd);
+    if (p_map == MAP_FAILED)
+    {
+        playlist_parser_Delete(p_parser);
+        throw_Exception(env, VLCJNI_EX_OUT_OF_MEMORY, "can't map playlist");
+        return;
+    }
+    if (p_map)
+        madvise((void *) p_map, size, MADV_SEQUENTIAL);
+
+    size_t offset = 0;
+    bool b_cancelled = false;
+    int ret = 0;
+    while (ret == 0 && offset < size && !b_cancelled)
+    {
+        size_t chunk = size - offset < LOAD_PROGRESS_SIZE
+                     ? size - offset : LOAD_PROGRESS_SIZE;
+        ret = playlist_parser_Feed(p_parser, p_map + offset, chunk);
+        offset += chunk;
+        if (ret == 0 && offset < size)
+            b_cancelled = !PlaylistStore_progress(env, jlistener, p_parser,
+                                                  offset, size);
+    }
+    if (ret == 0 && !b_cancelled)
+    {
+        ret = playlist_parser_End(p_parser);
+        if (ret == 0)
+            PlaylistStore_progress(env, jlistener, p_parser, size, size);
+    }
+    if (p_map)
+        munmap((void *) p_map, size);
+
+    jlong result[] = { playlist_parser_Count(p_parser), offset, b_cancelled };
+    playlist_parser_Delete(p_parser);
+    if (ret != 0)
+    {
+        throw_Exception(env, VLCJNI_EX_OUT_OF_MEMORY, "PlaylistStore");
+        return;
+    }
+    if (!(*env)->ExceptionCheck(env))
+        (*env)->SetLongArrayRegion(env, jresult, 0, ARRAY_SIZE(result), result);
+}
+
+/* Incremental parsing, for playlists read from a stream. The store must not
+ * be modified between New and Release. */
+jlong
+Java_org_videolan_libvlc_PlaylistStore_nativeParserNew(JNIEnv *env,
+                                                       jobject thiz,
+                                                       jstring jbase)
+{
+    playlist_store *p_store = PlaylistStore_getInstance(env, thiz);
+
+    if (!p_store)
+        return 0;
+    return (jlong)(intptr_t) PlaylistStore_newParser(env, p_store, jbase);
+}
+
+/* Returns the number of entries added since the parser was created */
+jint
+Java_org_videolan_libvlc_PlaylistStore_nativeParserFeed(JNIEnv *env,
+                                                        jobject thiz,
+                                                        jlong jparser,
+                                                        jbyteArray jdata,
+                                                        jint size)
+{
+    playlist_parser *p_parser = (playlist_parser *)(intptr_t) jparser;
+
+    if (!p_parser || size < 0 || size > (*env)->GetArrayLength(env, jdata))
+    {
+        throw_Exception(env, VLCJNI_EX_ILLEGAL_ARGUMENT, "invalid arguments");
+        return 0;
+    }
+
+    jbyte *p_data = (*env)->GetPrimitiveArrayCritical(env, jdata, NULL);
+    if (!p_data)
+        return 0;
+    int ret = playlist_parser_Feed(p_parser, (const char *) p_data, size);
+    (*env)->ReleasePrimitiveArrayCritical(env, jdata, p_data, JNI_ABORT);
+
+    if (ret != 0)
+        throw_Exception(env, VLCJNI_EX_OUT_OF_MEMORY, "PlaylistStore");
+    return playlist_parser_Count(p_parser);
+}
+
+jint
+Java_org_videolan_libvlc_PlaylistStore_nativeParserEnd(JNIEnv *env,
+                                                       jobject thiz,
+                                                       jlong jparser)
+{
+    playlist_parser *p_parser = (playlist_parser *)(intptr_t) jparser;
+
+    if (!p_parser)
+        return 0;
+    if (playlist_parser_End(p_parser) != 0)
+        throw_Exception(env, VLCJNI_EX_OUT_OF_MEMORY, "PlaylistStore");
+    return playlist_parser_Count(p_parser);
+}
+
+void
+Java_org_videolan_libvlc_PlaylistStore_nativeParserRelease(JNIEnv *env,
+                                                           jobject thiz,
+                                                           jlong jparser)
+{
+    playlist_parser *p_parser = (playlist_parser *)(intptr_t) jparser;
+
+    if (p_parser)
+        playlist_parser_Delete(p_parser);
+}
@@ -18,18 +18,325 @@
  * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
  *****************************************************************************/
 
+#include <errno.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
 #include "libvlcjni-vlcobject.h"
 
+#define THREAD_NAME "RendererRegistry"
+extern JNIEnv *jni_get_env(const char *name);
+
 static const libvlc_event_type_t rd_events[] = {
     libvlc_RendererDiscovererItemAdded,
     libvlc_RendererDiscovererItemDeleted,
     -1,
 };
 
+/*
+ * Registry of the renderer items, used when a debounce window is set.
+ *
+ * Items are keyed by name and type: mDNS announcements of the same renderer
+ * create a new libvlc_renderer_item_t each time. An item is only sent to Java
+ * once it stayed for the whole window, and removed once it stayed away for
+ * the whole window, so flapping renderers don't reach the UI.
+ *
+ * The registry is shared by the libvlc event thread and the debounce thread,
+ * that owns a reference: it can outlive the RendererDiscoverer, since the
+ * thread can't be joined while the Java object is locked by release().
+ */
+enum rd_state
+{
+    RD_PENDING_ADD,
+    RD_ACTIVE,
+    RD_PENDING_REMOVE,
+};
+
+struct rd_entry
+{
+    char *psz_key;
+    /* Item sent to Java, held */
+    libvlc_renderer_item_t *p_item;
+    /* Number of libvlc items currently announced with this key */
+    unsigned announced;
+    enum rd_state state;
+    int64_t deadline_ms;
+};
+
+struct rd_registry
+{
+    pthread_mutex_t lock;
+    pthread_cond_t wait;
+    unsigned refs;
+    bool b_stop;
+    jweak weak;
+    int64_t window_ms;
+
+    struct rd_entry *p_entries;
+    size_t count;
+    size_t alloc;
+
+    uint64_t added;
+    uint64_t removed;
+    uint64_t flaps;
+};
+
+struct vlcjni_object_sys
+{
+    /* NULL without debounce window: events are sent as is */
+    struct rd_registry *p_reg;
+};
+
+static int64_t
+RendererRegistry_now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * INT64_C(1000) + ts.tv_nsec / 1000000;
+}
+
+static char *
+RendererRegistry_key(libvlc_renderer_item_t *p_item)
+{
+    char *psz_key;
+    const char *psz_name = libvlc_renderer_item_name(p_item);
+    const char *psz_type = libvlc_renderer_item_type(p_item);
+
+    if (asprintf(&psz_key, "%s\n%s", psz_name ? psz_name : "",
+                 psz_type ? psz_type : "") == -1)
+        return NULL;
+    return psz_key;
+}
+
+/* Must be called locked */
+static struct rd_entry *
+RendererRegistry_find(struct rd_registry *p_reg, const char *psz_key)
+{
+    for (size_t i = 0; i < p_reg->count; ++i)
+        if (strcmp(p_reg->p_entries[i].psz_key, psz_key) == 0)
+            return &p_reg->p_entries[i];
+    return NULL;
+}
+
+/* Must be called locked, the item of the entry is not released */
+static void
+RendererRegistry_remove(struct rd_registry *p_reg, struct rd_entry *p_entry)
+{
+    free(p_entry->psz_key);
+    *p_entry = p_reg->p_entries[--p_reg->count];
+}
+
+static void
+RendererRegistry_onAdded(struct rd_registry *p_reg,
+                         libvlc_renderer_item_t *p_item)
+{
+    char *psz_key = RendererRegistry_key(p_item);
+    if (!psz_key)
+        return;
+
+    pthread_mutex_lock(&p_reg->lock);
+    struct rd_entry *p_entry = RendererRegistry_find(p_reg, psz_key);
+    if (p_entry)
+    {
+        free(psz_key);
+        if (p_entry->announced++ == 0 && p_entry->state == RD_PENDING_REMOVE)
+        {
+            /* Back before the end of the window: keep the item sent */
+            p_entry->state = RD_ACTIVE;
+            p_reg->flaps++;
+        }
+    }
+    else
+    {
+        if (p_reg->count == p_reg->alloc)
+        {
+            size_t alloc = p_reg->alloc ? p_reg->alloc * 2 : 8;
+            struct rd_entry *p_entries =
+                realloc(p_reg->p_entries, alloc * sizeof(*p_entries));
+            if (!p_entries)
+            {
+                pthread_mutex_unlock(&p_reg->lock);
+                free(psz_key);
+                return;
+            }
+            p_reg->p_entries = p_entries;
+            p_reg->alloc = alloc;
+        }
+        p_entry = &p_reg->p_entries[p_reg->count++];
+        p_entry->psz_key = psz_key;
+        p_entry->p_item = libvlc_renderer_item_hold(p_item);
+        p_entry->announced = 1;
+        p_entry->state = RD_PENDING_ADD;
+        p_entry->deadline_ms = RendererRegistry_now() + p_reg->window_ms;
+        pthread_cond_signal(&p_reg->wait);
+    }
+    pthread_mutex_unlock(&p_reg->lock);
+}
+
+static void
+RendererRegistry_onDeleted(struct rd_registry *p_reg,
+                           libvlc_renderer_item_t *p_item)
+{
+    char *psz_key = RendererRegistry_key(p_item);
+    if (!psz_key)
+        return;
+
+    pthread_mutex_lock(&p_reg->lock);
+    struct rd_entry *p_entry = RendererRegistry_find(p_reg, psz_key);
+    free(psz_key);
+    if (p_entry && p_entry->announced > 0 && --p_entry->announced == 0)
+    {
+        if (p_entry->state == RD_PENDING_ADD)
+        {
+            /* Gone before the end of the window: Java never knew it */
+            libvlc_renderer_item_release(p_entry->p_item);
+            RendererRegistry_remove(p_reg, p_entry);
+            p_reg->flaps++;
+        }
+        else
+        {
+            p_entry->state = RD_PENDING_REMOVE;
+            p_entry->deadline_ms = RendererRegistry_now() + p_reg->window_ms;
+            pthread_cond_signal(&p_reg->wait);
+        }
+    }
+    pthread_mutex_unlock(&p_reg->lock);
+}
+
+static void
+RendererRegistry_release(JNIEnv *env, struct rd_registry *p_reg)
+{
+    pthread_mutex_lock(&p_reg->lock);
+    bool b_last = --p_reg->refs == 0;
+    pthread_mutex_unlock(&p_reg->lock);
+    if (!b_last)
+        return;
+
+    for (size_t i = 0; i < p_reg->count; ++i)
+    {
+        free(p_reg->p_entries[i].psz_key);
+        libvlc_renderer_item_release(p_reg->p_entries[i].p_item);
+    }
+    free(p_reg->p_entries);
+    if (env)
+        (*env)->DeleteWeakGlobalRef(env, p_reg->weak);
+    pthread_mutex_destroy(&p_reg->lock);
+    pthread_cond_destroy(&p_reg->wait);
+    free(p_reg);
+}
+
+static void
+RendererRegistry_dispatch(JNIEnv *env, struct rd_registry *p_reg, int type,
+                          libvlc_renderer_item_t *p_item)
+{
+    jobject jobj = (*env)->NewLocalRef(env, p_reg->weak);
+    if (!jobj)
+        return;
+    (*env)->CallVoidMethod(env, jobj, fields.VLCObject_dispatchEventFromNative,
+                           type, (jlong)(intptr_t) p_item, (jlong) 0, 0.f,
+                           NULL);
+    if ((*env)->ExceptionCheck(env))
+        (*env)->ExceptionClear(env);
+    (*env)->DeleteLocalRef(env, jobj);
+}
+
+static void *
+RendererRegistry_thread(void *data)
+{
+    struct rd_registry *p_reg = data;
+    JNIEnv *env = jni_get_env(THREAD_NAME);
+
+    pthread_mutex_lock(&p_reg->lock);
+    while (!p_reg->b_stop)
+    {
+        int64_t now = RendererRegistry_now();
+        int64_t next = INT64_MAX;
+        struct rd_entry *p_due = NULL;
+
+        for (size_t i = 0; i < p_reg->count && !p_due; ++i)
+        {
+            struct rd_entry *p_entry = &p_reg->p_entries[i];
+            if (p_entry->state == RD_ACTIVE)
+                continue;
+            if (p_entry->deadline_ms <= now)
+                p_due = p_entry;
+            else if (p_entry->deadline_ms < next)
+                next = p_entry->deadline_ms;
+        }
+
+        if (p_due)
+        {
+            int type;
+            libvlc_renderer_item_t *p_item = p_due->p_item;
+            if (p_due->state == RD_PENDING_ADD)
+            {
+                type = libvlc_RendererDiscovererItemAdded;
+                p_due->state = RD_ACTIVE;
+                libvlc_renderer_item_hold(p_item);
+                p_reg->added++;
+            }
+            else
+            {
+                /* The registry reference is given to the dispatch */
+                type = libvlc_RendererDiscovererItemDeleted;
+                RendererRegistry_remove(p_reg, p_due);
+                p_reg->removed++;
+            }
+            pthread_mutex_unlock(&p_reg->lock);
+
+            /* Events are sent in order from this thread only */
+            if (env)
+                RendererRegistry_dispatch(env, p_reg, type, p_item);
+            libvlc_renderer_item_release(p_item);
+
+            pthread_mutex_lock(&p_reg->lock);
+            continue;
+        }
+
+        if (next == INT64_MAX)
+            pthread_cond_wait(&p_reg->wait, &p_reg->lock);
+        else
+        {
+            struct timespec deadline;
+            int64_t delay_ms = next - now;
+            clock_gettime(CLOCK_MONOTONIC, &deadline);
+            deadline.tv_sec += delay_ms / 1000;
+            deadline.tv_nsec += (delay_ms % 1000) * 1000000L;
+            if (deadline.tv_nsec >= 1000000000L)
+            {
+                deadline.tv_sec++;
+                deadline.tv_nsec -= 1000000000L;
+            }
+            pthread_cond_timedwait(&p_reg->wait, &p_reg->lock, &deadline);
+        }
+    }
+    pthread_mutex_unlock(&p_reg->lock);
+
+    RendererRegistry_release(env, p_reg);
+    return NULL;
+}
+
 static bool
 RendererDiscoverer_event_cb(vlcjni_object *p_obj, const libvlc_event_t *p_ev,
                      java_event *p_java_event)
 {
+    struct rd_registry *p_reg = p_obj->p_sys->p_reg;
+
+    if (p_reg)
+    {
+        if (p_ev->type == libvlc_RendererDiscovererItemAdded)
+            RendererRegistry_onAdded(p_reg,
+                p_ev->u.renderer_discoverer_item_added.item);
+        else if (p_ev->type == libvlc_RendererDiscovererItemDeleted)
+            RendererRegistry_onDeleted(p_reg,
+                p_ev->u.renderer_discoverer_item_deleted.item);
+        /* Sent by the registry thread */
+        return false;
+    }
+
     switch (p_ev->type)
     {
     case libvlc_RendererDiscovererItemAdded:
@@ -66,11 +373,15 @@ Java_org_videolan_libvlc_RendererDiscoverer_nativeNew(JNIEnv *env,
     }
 
     p_obj->u.p_rd = libvlc_renderer_discoverer_new(p_obj->p_libvlc, p_name);
+    p_obj->p_sys = calloc(1, sizeof(vlcjni_object_sys));
 
     (*env)->ReleaseStringUTFChars(env, jname, p_name);
 
-    if (!p_obj->u.p_rd)
+    if (!p_obj->u.p_rd || !p_obj->p_sys)
     {
+        if (p_obj->u.p_rd)
+            libvlc_renderer_discoverer_release(p_obj->u.p_rd);
+        free(p_obj->p_sys);
         VLCJniObject_release(env, thiz, p_obj);
         throw_Exception(env, VLCJNI_EX_OUT_OF_MEMORY, "RendererDiscoverer");
         return;
@@ -91,9 +402,115 @@ Java_org_videolan_libvlc_RendererDiscoverer_nativeRelease(JNIEnv *env,
 
     libvlc_renderer_discoverer_release(p_obj->u.p_rd);
 
+    struct rd_registry *p_reg = p_obj->p_sys->p_reg;
+    if (p_reg)
+    {
+        /* Not joined: the thread may wait for the Java object lock, held by
+         * release(). It releases its reference when exiting. */
+        pthread_mutex_lock(&p_reg->lock);
+        p_reg->b_stop = true;
+        pthread_cond_signal(&p_reg->wait);
+        pthread_mutex_unlock(&p_reg->lock);
+        RendererRegistry_release(env, p_reg);
+    }
+    free(p_obj->p_sys);
+
     VLCJniObject_release(env, thiz, p_obj);
 }
 
+/* Must be called before start() */
+void
+Java_org_videolan_libvlc_RendererDiscoverer_nativeSetDebounce(JNIEnv *env,
+                                                             jobject thiz,
+                                                             jint window)
+{
+    vlcjni_object *p_obj = VLCJniObject_getInstance(env, thiz);
+
+    if (!p_obj)
+        return;
+
+    if (window <= 0)
+    {
+        throw_Exception(env, VLCJNI_EX_ILLEGAL_ARGUMENT, "invalid window");
+        return;
+    }
+
+    struct rd_registry *p_reg = p_obj->p_sys->p_reg;
+    if (p_reg)
+    {
+        pthread_mutex_lock(&p_reg->lock);
+        p_reg->window_ms = window;
+        pthread_mutex_unlock(&p_reg->lock);
+        return;
+    }
+
+    p_reg = calloc(1, sizeof(*p_reg));
+    if (!p_reg)
+    {
+        throw_Exception(env, VLCJNI_EX_OUT_OF_MEMORY, "RendererRegistry");
+        return;
+    }
+    p_reg->weak = (*env)->NewWeakGlobalRef(env, thiz);
+    if (!p_reg->weak)
+    {
+        free(p_reg);
+        throw_Exception(env, VLCJNI_EX_ILLEGAL_STATE, "No RendererDiscoverer weak reference");
+        return;
+    }
+    /* Deadlines are computed from the CLOCK_MONOTONIC item timestamps */
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_mutex_init(&p_reg->lock, NULL);
+    pthread_cond_init(&p_reg->wait, &attr);
+    pthread_condattr_destroy(&attr);
+    p_reg->window_ms = window;
+    /* One for the RendererDiscoverer, one for the thread */
+    p_reg->refs = 2;
+
+    pthread_t thread;
+    if (pthread_create(&thread, NULL, RendererRegistry_thread, p_reg) != 0)
+    {
+        p_reg->refs = 1;
+        RendererRegistry_release(env, p_reg);
+        throw_Exception(env, VLCJNI_EX_OUT_OF_MEMORY, "RendererRegistry thread");
+        return;
+    }
+    pthread_detach(thread);
+    p_obj->p_sys->p_reg = p_reg;
+}
+
+/* Counters of the registry: items added, removed, and flaps (items back or
+ * gone within the window) */
+void
+Java_org_videolan_libvlc_RendererDiscoverer_nativeGetRegistryStats(JNIEnv *env,
+                                                                   jobject thiz,
+                                                                   jlongArray jstats)
+{
+    vlcjni_object *p_obj = VLCJniObject_getInstance(env, thiz);
+    jlong stats[3] = { 0, 0, 0 };
+
+    if (!p_obj)
+        return;
+
+    if (!jstats || (*env)->GetArrayLength(env, jstats) < (jsize) ARRAY_SIZE(stats))
+    {
+        throw_Exception(env, VLCJNI_EX_ILLEGAL_ARGUMENT, "invalid stats array");
+        return;
+    }
+
+    struct rd_registry *p_reg = p_obj->p_sys->p_reg;
+    if (p_reg)
+    {
+        pthread_mutex_lock(&p_reg->lock);
+        stats[0] = p_reg->added;
+        stats[1] = p_reg->removed;
+        stats[2] = p_reg->flaps;
+        pthread_mutex_unlock(&p_reg->lock);
+    }
+    (*env)->SetLongArrayRegion(env, jstats, 0, ARRAY_SIZE(stats), stats);
+}
+
 jboolean
 Java_org_videolan_libvlc_RendererDiscoverer_nativeStart(JNIEnv *env, jobject thiz)
 {
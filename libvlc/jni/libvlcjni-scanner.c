@@ -0,0 +1,645 @@
+/*****************************************************************************
+ * libvlcjni-scanner.c
+ *****************************************************************************
+ * Copyright © 2023 VLC authors, VideoLAN and VideoLabs
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef _GNU_SOURCE
+# define _GNU_SOURCE /* syscall, st_mtim */
+#endif
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+
+#include "libvlcjni-vlcobject.h"
+#include "ext_set.h"
+
+#define SCAN_MAX_THREADS 16
+#define DENTS_BUFFER_SIZE (32 * 1024)
+
+/* Keep in sync with DirectoryScanner.java */
+#define SCAN_FLAG_SHOW_HIDDEN 1
+#define SCAN_FLAG_NO_MEDIA 2
+
+/* getdents64 has no libc wrapper on older Android versions */
+struct linux_dirent64
+{
+    uint64_t d_ino;
+    int64_t d_off;
+    unsigned short d_reclen;
+    unsigned char d_type;
+    char d_name[];
+};
+
+/* Directories left to scan, the owner pushes and pops at the back while
+ * other workers steal from the front */
+struct scan_deque
+{
+    pthread_mutex_t lock;
+    char **pp_dirs;
+    size_t head;
+    size_t tail;
+    size_t capacity;
+};
+
+struct scan_results
+{
+    char *p_paths;
+    size_t paths_size;
+    size_t paths_capacity;
+    uint32_t *p_offsets;
+    int64_t *p_sizes;
+    int64_t *p_mtimes;
+    uint8_t *p_categories;
+    size_t count;
+    size_t capacity;
+    unsigned directories;
+};
+
+struct scan_worker
+{
+    pthread_t thread;
+    struct scan_context *p_ctx;
+    unsigned index;
+    struct scan_deque deque;
+    struct scan_results results;
+    char *p_dents;
+};
+
+struct scan_context
+{
+    const ext_set *p_set;
+    int flags;
+    unsigned worker_count;
+    struct scan_worker *p_workers;
+    /* Directories pushed and not scanned yet, 0 once the scan is over */
+    atomic_uint pending;
+    atomic_bool b_error;
+
+    /* Idle workers sleep until a directory is pushed or the scan is over */
+    pthread_mutex_t lock;
+    pthread_cond_t wait;
+    atomic_uint pushes;
+    atomic_uint idle;
+};
+
+static void
+scan_context_wake(struct scan_context *p_ctx, bool b_all)
+{
+    /* Pushes and idle are ordered: a worker going idle either sees the new
+     * push or is counted here */
+    if (atomic_load(&p_ctx->idle) == 0)
+        return;
+    pthread_mutex_lock(&p_ctx->lock);
+    if (b_all)
+        pthread_cond_broadcast(&p_ctx->wait);
+    else
+        pthread_cond_signal(&p_ctx->wait);
+    pthread_mutex_unlock(&p_ctx->lock);
+}
+
+static bool
+scan_deque_push(struct scan_deque *p_dq, char *psz_dir)
+{
+    bool b_ret = true;
+
+    pthread_mutex_lock(&p_dq->lock);
+    if (p_dq->tail == p_dq->capacity)
+    {
+        if (p_dq->head > 0)
+        {
+            memmove(p_dq->pp_dirs, p_dq->pp_dirs + p_dq->head,
+                    (p_dq->tail - p_dq->head) * sizeof(*p_dq->pp_dirs));
+            p_dq->tail -= p_dq->head;
+            p_dq->head = 0;
+        }
+        else
+        {
+            size_t capacity = p_dq->capacity ? p_dq->capacity * 2 : 64;
+            char **pp_dirs = realloc(p_dq->pp_dirs,
+                                     capacity * sizeof(*pp_dirs));
+            if (!pp_dirs)
+                b_ret = false;
+            else
+            {
+                p_dq->pp_dirs = pp_dirs;
+                p_dq->capacity = capacity;
+            }
+        }
+    }
+    if (b_ret)
+        p_dq->pp_dirs[p_dq->tail++] = psz_dir;
+    pthread_mutex_unlock(&p_dq->lock);
+    return b_ret;
+}
+
+static char *
+scan_deque_pop(struct scan_deque *p_dq, bool b_steal)
+{
+    char *psz_dir = NULL;
+
+    pthread_mutex_lock(&p_dq->lock);
+    if (p_dq->head < p_dq->tail)
+    {
+        if (b_steal)
+            psz_dir = p_dq->pp_dirs[p_dq->head++];
+        else
+            psz_dir = p_dq->pp_dirs[--p_dq->tail];
+        if (p_dq->head == p_dq->tail)
+            p_dq->head = p_dq->tail = 0;
+    }
+    pthread_mutex_unlock(&p_dq->lock);
+    return psz_dir;
+}
+
+static bool
+scan_results_add(struct scan_results *p_res, const char *psz_dir,
+                 size_t dir_len, const char *psz_name, const struct stat *p_st,
+                 uint8_t categories)
+{
+    size_t name_len = strlen(psz_name);
+    size_t path_len = dir_len + 1 + name_len;
+
+    if (p_res->count == p_res->capacity)
+    {
+        size_t capacity = p_res->capacity ? p_res->capacity * 2 : 256;
+        uint32_t *p_offsets = realloc(p_res->p_offsets,
+                                      capacity * sizeof(*p_offsets));
+        if (p_offsets)
+            p_res->p_offsets = p_offsets;
+        int64_t *p_sizes = realloc(p_res->p_sizes, capacity * sizeof(*p_sizes));
+        if (p_sizes)
+            p_res->p_sizes = p_sizes;
+        int64_t *p_mtimes = realloc(p_res->p_mtimes,
+                                    capacity * sizeof(*p_mtimes));
+        if (p_mtimes)
+            p_res->p_mtimes = p_mtimes;
+        uint8_t *p_categories = realloc(p_res->p_categories,
+                                        capacity * sizeof(*p_categories));
+        if (p_categories)
+            p_res->p_categories = p_categories;
+        if (!p_offsets || !p_sizes || !p_mtimes || !p_categories)
+            return false;
+        p_res->capacity = capacity;
+    }
+    if (p_res->paths_size + path_len > p_res->paths_capacity)
+    {
+        size_t capacity = p_res->paths_capacity ? p_res->paths_capacity : 16384;
+        while (capacity < p_res->paths_size + path_len)
+            capacity *= 2;
+        char *p_paths = realloc(p_res->p_paths, capacity);
+        if (!p_paths)
+            return false;
+        p_res->p_paths = p_paths;
+        p_res->paths_capacity = capacity;
+    }
+    /* Offsets are merged into a Java int array */
+    if (p_res->paths_size + path_len > INT32_MAX)
+        return false;
+
+    char *p_path = p_res->p_paths + p_res->paths_size;
+    memcpy(p_path, psz_dir, dir_len);
+    p_path[dir_len] = '/';
+    memcpy(p_path + dir_len + 1, psz_name, name_len);
+
+    p_res->p_offsets[p_res->count] = p_res->paths_size;
+    p_res->p_sizes[p_res->count] = p_st->st_size;
+    p_res->p_mtimes[p_res->count] = (int64_t) p_st->st_mtim.tv_sec * 1000
+                                  + p_st->st_mtim.tv_nsec / 1000000;
+    p_res->p_categories[p_res->count] = categories;
+    p_res->paths_size += path_len;
+    p_res->count++;
+    return true;
+}
+
+static bool
+scan_push_dir(struct scan_worker *p_worker, const char *psz_dir, size_t dir_len,
+              const char *psz_name)
+{
+    size_t name_len = strlen(psz_name);
+    char *psz_path = malloc(dir_len + 1 + name_len + 1);
+    if (!psz_path)
+        return false;
+    memcpy(psz_path, psz_dir, dir_len);
+    psz_path[dir_len] = '/';
+    memcpy(psz_path + dir_len + 1, psz_name, name_len + 1);
+
+    atomic_fetch_add(&p_worker->p_ctx->pending, 1);
+    if (!scan_deque_push(&p_worker->deque, psz_path))
+    {
+        atomic_fetch_sub(&p_worker->p_ctx->pending, 1);
+        free(psz_path);
+        return false;
+    }
+    atomic_fetch_add(&p_worker->p_ctx->pushes, 1);
+    scan_context_wake(p_worker->p_ctx, false);
+    return true;
+}
+
+static bool
+scan_dir(struct scan_worker *p_worker, const char *psz_dir)
+{
+    const struct scan_context *p_ctx = p_worker->p_ctx;
+    /* The root is "/" or has no trailing slash: children are dir + '/' + name */
+    size_t dir_len = strcmp(psz_dir, "/") == 0 ? 0 : strlen(psz_dir);
+
+    int fd = open(psz_dir, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd == -1)
+        return true; /* Unreadable directories are skipped */
+
+    p_worker->results.directories++;
+    if ((p_ctx->flags & SCAN_FLAG_NO_MEDIA)
+     && faccessat(fd, ".nomedia", F_OK, 0) == 0)
+    {
+        close(fd);
+        return true;
+    }
+
+    bool b_ret = true;
+    long nread;
+    while (b_ret && (nread = syscall(SYS_getdents64, fd, p_worker->p_dents,
+                                     DENTS_BUFFER_SIZE)) > 0)
+    {
+        for (long pos = 0; b_ret && pos < nread;)
+        {
+            const struct linux_dirent64 *p_ent =
+                (const struct linux_dirent64 *)(p_worker->p_dents + pos);
+            const char *psz_name = p_ent->d_name;
+            unsigned char type = p_ent->d_type;
+            pos += p_ent->d_reclen;
+
+            if (psz_name[0] == '.'
+             && (!(p_ctx->flags & SCAN_FLAG_SHOW_HIDDEN) || psz_name[1] == '\0'
+              || (psz_name[1] == '.' && psz_name[2] == '\0')))
+                continue;
+            /* Symbolic links are not followed, they could loop */
+            if (type != DT_DIR && type != DT_REG && type != DT_UNKNOWN)
+                continue;
+
+            uint8_t categories = 0;
+            if (type != DT_DIR)
+            {
+                /* Check the extension before any system call */
+                categories = ext_set_Lookup(p_ctx->p_set, psz_name);
+                if (categories == 0 && type == DT_REG)
+                    continue;
+            }
+
+            struct stat st;
+            if (type == DT_DIR)
+                memset(&st, 0, sizeof(st));
+            else if (fstatat(fd, psz_name, &st, AT_SYMLINK_NOFOLLOW) != 0)
+                continue;
+
+            if (type == DT_DIR || S_ISDIR(st.st_mode))
+                b_ret = scan_push_dir(p_worker, psz_dir, dir_len, psz_name);
+            else if (S_ISREG(st.st_mode) && categories != 0)
+                b_ret = scan_results_add(&p_worker->results, psz_dir, dir_len,
+                                         psz_name, &st, categories);
+        }
+    }
+    close(fd);
+    return b_ret;
+}
+
+static void *
+scan_worker_run(void *data)
+{
+    struct scan_worker *p_worker = data;
+    struct scan_context *p_ctx = p_worker->p_ctx;
+
+    while (atomic_load(&p_ctx->pending) > 0)
+    {
+        unsigned pushes = atomic_load(&p_ctx->pushes);
+        char *psz_dir = scan_deque_pop(&p_worker->deque, false);
+
+        for (unsigned i = 1; !psz_dir && i < p_ctx->worker_count; ++i)
+        {
+            unsigned victim = (p_worker->index + i) % p_ctx->worker_count;
+            psz_dir = scan_deque_pop(&p_ctx->p_workers[victim].deque, true);
+        }
+        if (!psz_dir)
+        {
+            /* Other workers are still scanning and may push new directories */
+            pthread_mutex_lock(&p_ctx->lock);
+            atomic_fetch_add(&p_ctx->idle, 1);
+            while (atomic_load(&p_ctx->pushes) == pushes
+                && atomic_load(&p_ctx->pending) > 0)
+                pthread_cond_wait(&p_ctx->wait, &p_ctx->lock);
+            atomic_fetch_sub(&p_ctx->idle, 1);
+            pthread_mutex_unlock(&p_ctx->lock);
+            continue;
+        }
+
+        if (!atomic_load(&p_ctx->b_error) && !scan_dir(p_worker, psz_dir))
+            atomic_store(&p_ctx->b_error, true);
+        free(psz_dir);
+        if (atomic_fetch_sub(&p_ctx->pending, 1) == 1)
+            scan_context_wake(p_ctx, true);
+    }
+    return NULL;
+}
+
+static void
+scan_results_clean(struct scan_results *p_res)
+{
+    free(p_res->p_paths);
+    free(p_res->p_offsets);
+    free(p_res->p_sizes);
+    free(p_res->p_mtimes);
+    free(p_res->p_categories);
+}
+
+static jobject
+scan_results_merge(JNIEnv *env, const struct scan_context *p_ctx,
+                   jlong duration)
+{
+    size_t count = 0, paths_size = 0;
+    unsigned directories = 0;
+    jobject jresult = NULL;
+
+    for (unsigned i = 0; i < p_ctx->worker_count; ++i)
+    {
+        const struct scan_results *p_res = &p_ctx->p_workers[i].results;
+        count += p_res->count;
+        paths_size += p_res->paths_size;
+        directories += p_res->directories;
+    }
+    if (count >= INT32_MAX || paths_size > INT32_MAX)
+    {
+        throw_Exception(env, VLCJNI_EX_OUT_OF_MEMORY, "too many files");
+        return NULL;
+    }
+
+    jbyteArray jpaths = (*env)->NewByteArray(env, paths_size);
+    jintArray joffsets = (*env)->NewIntArray(env, count + 1);
+    jlongArray jsizes = (*env)->NewLongArray(env, count);
+    jlongArray jmtimes = (*env)->NewLongArray(env, count);
+    jbyteArray jcategories = (*env)->NewByteArray(env, count);
+    jint *p_offsets = malloc((count + 1) * sizeof(*p_offsets));
+    if (!jpaths || !joffsets || !jsizes || !jmtimes || !jcategories
+     || !p_offsets)
+    {
+        if (!(*env)->ExceptionCheck(env))
+            throw_Exception(env, VLCJNI_EX_OUT_OF_MEMORY, "scan results");
+        goto end;
+    }
+
+    size_t index = 0, base = 0;
+    for (unsigned i = 0; i < p_ctx->worker_count; ++i)
+    {
+        const struct scan_results *p_res = &p_ctx->p_workers[i].results;
+        if (p_res->count == 0)
+            continue;
+
+        (*env)->SetByteArrayRegion(env, jpaths, base, p_res->paths_size,
+                                   (const jbyte *) p_res->p_paths);
+        (*env)->SetLongArrayRegion(env, jsizes, index, p_res->count,
+                                   p_res->p_sizes);
+        (*env)->SetLongArrayRegion(env, jmtimes, index, p_res->count,
+                                   p_res->p_mtimes);
+        (*env)->SetByteArrayRegion(env, jcategories, index, p_res->count,
+                                   (const jbyte *) p_res->p_categories);
+        for (size_t j = 0; j < p_res->count; ++j)
+            p_offsets[index + j] = base + p_res->p_offsets[j];
+        index += p_res->count;
+        base += p_res->paths_size;
+    }
+    p_offsets[count] = paths_size;
+    (*env)->SetIntArrayRegion(env, joffsets, 0, count + 1, p_offsets);
+
+    jresult = (*env)->CallStaticObjectMethod(env, fields.DirectoryScanner_clazz,
+                                fields.DirectoryScanner_createResultFromNative,
+                                jpaths, joffsets, jsizes, jmtimes, jcategories,
+                                (jint) directories, duration);
+end:
+    free(p_offsets);
+    if (jpaths)
+        (*env)->DeleteLocalRef(env, jpaths);
+    if (joffsets)
+        (*env)->DeleteLocalRef(env, joffsets);
+    if (jsizes)
+        (*env)->DeleteLocalRef(env, jsizes);
+    if (jmtimes)
+        (*env)->DeleteLocalRef(env, jmtimes);
+    if (jcategories)
+        (*env)->DeleteLocalRef(env, jcategories);
+    return jresult;
+}
+
+void
+Java_org_videolan_libvlc_util_DirectoryScanner_nativeInit(JNIEnv *env,
+                                                          jclass clazz,
+                                                          jobjectArray jexts,
+                                                          jintArray jcategories)
+{
+    jsize count = (*env)->GetArrayLength(env, jexts);
+    if ((*env)->GetArrayLength(env, jcategories) != count)
+    {
+        throw_Exception(env, VLCJNI_EX_ILLEGAL_ARGUMENT, "invalid arguments");
+        return;
+    }
+
+    const char **ppsz_exts = calloc(count > 0 ? count : 1, sizeof(*ppsz_exts));
+    uint8_t *p_cats = malloc(count > 0 ? count : 1);
+    jint *p_jcats = (*env)->GetIntArrayElements(env, jcategories, NULL);
+    ext_set *p_set = NULL;
+    jsize i;
+
+    if (!ppsz_exts || !p_cats || !p_jcats)
+        goto end;
+
+    for (i = 0; i < count; ++i)
+    {
+        jstring jext = (*env)->GetObjectArrayElement(env, jexts, i);
+        ppsz_exts[i] = jext ? (*env)->GetStringUTFChars(env, jext, NULL) : NULL;
+        (*env)->DeleteLocalRef(env, jext);
+        if (!ppsz_exts[i])
+            break;
+        p_cats[i] = p_jcats[i];
+    }
+    if (i == count)
+        p_set = ext_set_New(ppsz_exts, p_cats, count);
+
+    for (jsize j = 0; j < i; ++j)
+    {
+        jstring jext = (*env)->GetObjectArrayElement(env, jexts, j);
+        (*env)->ReleaseStringUTFChars(env, jext, ppsz_exts[j]);
+        (*env)->DeleteLocalRef(env, jext);
+    }
+
+end:
+    if (p_jcats)
+        (*env)->ReleaseIntArrayElements(env, jcategories, p_jcats, JNI_ABORT);
+    free(ppsz_exts);
+    free(p_cats);
+
+    if (!p_set)
+    {
+        if (!(*env)->ExceptionCheck(env))
+            throw_Exception(env, VLCJNI_EX_OUT_OF_MEMORY, "extension set");
+    }
+    else
+        ext_set_SetDefault(p_set);
+}
+
+jobject
+Java_org_videolan_libvlc_util_DirectoryScanner_nativeScan(JNIEnv *env,
+                                                          jclass clazz,
+                                                          jstring jroot,
+                                                          jint flags,
+                                                          jint threads)
+{
+    struct scan_context ctx = { .flags = flags };
+    struct timespec start, end;
+    jobject jresult = NULL;
+    char *psz_root = NULL;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    ctx.p_set = ext_set_GetDefault();
+    if (!ctx.p_set)
+    {
+        throw_Exception(env, VLCJNI_EX_ILLEGAL_STATE, "extensions not set");
+        return NULL;
+    }
+
+    const char *psz_jroot = jroot ? (*env)->GetStringUTFChars(env, jroot, NULL)
+                                  : NULL;
+    if (!psz_jroot)
+    {
+        ext_set_Release(ctx.p_set);
+        throw_Exception(env, VLCJNI_EX_ILLEGAL_ARGUMENT, "root invalid");
+        return NULL;
+    }
+    psz_root = strdup(psz_jroot);
+    (*env)->ReleaseStringUTFChars(env, jroot, psz_jroot);
+    if (!psz_root)
+    {
+        ext_set_Release(ctx.p_set);
+        throw_Exception(env, VLCJNI_EX_OUT_OF_MEMORY, "root");
+        return NULL;
+    }
+    for (size_t len = strlen(psz_root); len > 1 && psz_root[len - 1] == '/';)
+        psz_root[--len] = '\0';
+
+    struct stat st;
+    if (stat(psz_root, &st) != 0 || !S_ISDIR(st.st_mode))
+    {
+        free(psz_root);
+        ext_set_Release(ctx.p_set);
+        throw_Exception(env, VLCJNI_EX_ILLEGAL_ARGUMENT,
+                        "root is not a directory");
+        return NULL;
+    }
+
+    if (threads <= 0)
+        threads = sysconf(_SC_NPROCESSORS_ONLN);
+    ctx.worker_count = threads < 1 ? 1
+                     : threads > SCAN_MAX_THREADS ? SCAN_MAX_THREADS : threads;
+    ctx.p_workers = calloc(ctx.worker_count, sizeof(*ctx.p_workers));
+    if (!ctx.p_workers)
+    {
+        free(psz_root);
+        ext_set_Release(ctx.p_set);
+        throw_Exception(env, VLCJNI_EX_OUT_OF_MEMORY, "scan workers");
+        return NULL;
+    }
+    pthread_mutex_init(&ctx.lock, NULL);
+    pthread_cond_init(&ctx.wait, NULL);
+    atomic_init(&ctx.pushes, 0);
+    atomic_init(&ctx.idle, 0);
+
+    unsigned ready;
+    for (ready = 0; ready < ctx.worker_count; ++ready)
+    {
+        struct scan_worker *p_worker = &ctx.p_workers[ready];
+        p_worker->p_ctx = &ctx;
+        p_worker->index = ready;
+        p_worker->p_dents = malloc(DENTS_BUFFER_SIZE);
+        if (!p_worker->p_dents)
+            break;
+        pthread_mutex_init(&p_worker->deque.lock, NULL);
+    }
+    if (ready < ctx.worker_count)
+    {
+        throw_Exception(env, VLCJNI_EX_OUT_OF_MEMORY, "scan workers");
+        goto end;
+    }
+
+    atomic_init(&ctx.pending, 1);
+    atomic_init(&ctx.b_error, false);
+    if (!scan_deque_push(&ctx.p_workers[0].deque, psz_root))
+    {
+        throw_Exception(env, VLCJNI_EX_OUT_OF_MEMORY, "scan workers");
+        goto end;
+    }
+    psz_root = NULL;
+
+    /* The calling thread is the first worker */
+    unsigned started;
+    for (started = 1; started < ctx.worker_count; ++started)
+    {
+        if (pthread_create(&ctx.p_workers[started].thread, NULL,
+                           scan_worker_run, &ctx.p_workers[started]) != 0)
+            break;
+    }
+    /* Directories of workers that failed to start are stolen by others */
+    scan_worker_run(&ctx.p_workers[0]);
+    for (unsigned i = 1; i < started; ++i)
+        pthread_join(ctx.p_workers[i].thread, NULL);
+
+    if (atomic_load(&ctx.b_error))
+    {
+        throw_Exception(env, VLCJNI_EX_OUT_OF_MEMORY, "scan results");
+        goto end;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    jlong duration = (end.tv_sec - start.tv_sec) * 1000
+                   + (end.tv_nsec - start.tv_nsec) / 1000000;
+    jresult = scan_results_merge(env, &ctx, duration);
+
+end:
+    for (unsigned i = 0; i < ready; ++i)
+    {
+        struct scan_worker *p_worker = &ctx.p_workers[i];
+        /* Only left on errors */
+        for (size_t j = p_worker->deque.head; j < p_worker->deque.tail; ++j)
+            free(p_worker->deque.pp_dirs[j]);
+        free(p_worker->deque.pp_dirs);
+        pthread_mutex_destroy(&p_worker->deque.lock);
+        scan_results_clean(&p_worker->results);
+        free(p_worker->p_dents);
+    }
+    free(ctx.p_workers);
+    pthread_mutex_destroy(&ctx.lock);
+    pthread_cond_destroy(&ctx.wait);
+    ext_set_Release(ctx.p_set);
+    free(psz_root);
+    return jresult;
+}
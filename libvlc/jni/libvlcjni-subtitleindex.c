@@ -0,0 +1,240 @@
+/*****************************************************************************
+ * libvlcjni-subtitleindex.c
+ *****************************************************************************
+ * Copyright © 2023 VLC authors, VideoLAN and VideoLabs
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "libvlcjni-vlcobject.h"
+#include "subtitleindex.h"
+
+static subtitle_index *
+SubtitleIndex_getInstance(JNIEnv *env, jobject thiz)
+{
+    intptr_t i_ptr = (intptr_t)
+        (*env)->GetLongField(env, thiz, fields.SubtitleIndex_mInstance);
+    if (!i_ptr)
+        throw_Exception(env, VLCJNI_EX_ILLEGAL_STATE,
+                        "can't get SubtitleIndex instance");
+    return (subtitle_index *) i_ptr;
+}
+
+void
+Java_org_videolan_libvlc_util_SubtitleIndex_nativeNew(JNIEnv *env,
+                                                      jobject thiz,
+                                                      jint maxDirectories)
+{
+    const ext_set *p_set = ext_set_GetDefault();
+
+    if (!p_set || maxDirectories <= 0)
+    {
+        ext_set_Release(p_set);
+        throw_Exception(env, VLCJNI_EX_ILLEGAL_ARGUMENT, "invalid arguments");
+        return;
+    }
+
+    subtitle_index *p_index = subtitle_index_New(p_set, maxDirectories);
+    if (!p_index)
+    {
+        ext_set_Release(p_set);
+        throw_Exception(env, VLCJNI_EX_OUT_OF_MEMORY, "SubtitleIndex");
+        return;
+    }
+    (*env)->SetLongField(env, thiz, fields.SubtitleIndex_mInstance,
+                         (jlong)(intptr_t) p_index);
+}
+
+void
+Java_org_videolan_libvlc_util_SubtitleIndex_nativeRelease(JNIEnv *env,
+                                                          jobject thiz)
+{
+    subtitle_index *p_index = (subtitle_index *)(intptr_t)
+        (*env)->GetLongField(env, thiz, fields.SubtitleIndex_mInstance);
+
+    if (!p_index)
+        return;
+
+    subtitle_index_Delete(p_index);
+    (*env)->SetLongField(env, thiz, fields.SubtitleIndex_mInstance, 0);
+}
+
+void
+Java_org_videolan_libvlc_util_SubtitleIndex_nativeAddFolder(JNIEnv *env,
+                                                            jobject thiz,
+                                                            jstring jpath)
+{
+    subtitle_index *p_index = SubtitleIndex_getInstance(env, thiz);
+    const char *psz_path;
+
+    if (!p_index)
+        return;
+    if (!jpath || !(psz_path = (*env)->GetStringUTFChars(env, jpath, 0)))
+    {
+        throw_Exception(env, VLCJNI_EX_ILLEGAL_ARGUMENT, "path invalid");
+        return;
+    }
+
+    if (subtitle_index_AddFolder(p_index, psz_path) != 0)
+        throw_Exception(env, VLCJNI_EX_OUT_OF_MEMORY, "SubtitleIndex");
+    (*env)->ReleaseStringUTFChars(env, jpath, psz_path);
+}
+
+jobjectArray
+Java_org_videolan_libvlc_util_SubtitleIndex_nativeFind(JNIEnv *env,
+                                                       jobject thiz,
+                                                       jstring jpath)
+{
+    subtitle_index *p_index = SubtitleIndex_getInstance(env, thiz);
+    struct subtitle_match *p_matches;
+    const char *psz_path;
+
+    if (!p_index)
+        return NULL;
+    if (!jpath || !(psz_path = (*env)->GetStringUTFChars(env, jpath, 0)))
+    {
+        throw_Exception(env, VLCJNI_EX_ILLEGAL_ARGUMENT, "path invalid");
+        return NULL;
+    }
+
+    int count = subtitle_index_Find(p_index, psz_path, &p_matches);
+    (*env)->ReleaseStringUTFChars(env, jpath, psz_path);
+    if (count < 0)
+    {
+        throw_Exception(env, VLCJNI_EX_OUT_OF_MEMORY, "SubtitleIndex");
+        return NULL;
+    }
+
+    /* File names are raw bytes: skip the ones Java can't represent */
+    int valid = 0;
+    for (int i = 0; i < count; ++i)
+        valid += vlcIsValidUTF(p_matches[i].psz_path);
+
+    jobjectArray array = (*env)->NewObjectArray(env, valid,
+                                                fields.SubtitleIndex_Match_clazz,
+                                                NULL);
+    for (int i = 0, index = 0; array && i < count; ++i)
+    {
+        if (!vlcIsValidUTF(p_matches[i].psz_path))
+            continue;
+        jstring jmatch_path = vlcNewStringUTF(env, p_matches[i].psz_path);
+        if (!jmatch_path)
+        {
+            (*env)->DeleteLocalRef(env, array);
+            array = NULL;
+            break;
+        }
+        jobject jmatch =
+            (*env)->CallStaticObjectMethod(env, fields.SubtitleIndex_clazz,
+                                           fields.SubtitleIndex_createMatchFromNative,
+                                           jmatch_path,
+                                           (jint) p_matches[i].priority);
+        (*env)->SetObjectArrayElement(env, array, index++, jmatch);
+        (*env)->DeleteLocalRef(env, jmatch);
+        (*env)->DeleteLocalRef(env, jmatch_path);
+    }
+    subtitle_index_FreeMatches(p_matches, count);
+    return array;
+}
+
+/* Add the subtitles to the media with a single call, and disable the
+ * directory probing of libvlc: the index already did it */
+jint
+Java_org_videolan_libvlc_util_SubtitleIndex_nativeAttach(JNIEnv *env,
+                                                         jobject thiz,
+                                                         jobject jmedia,
+                                                         jobjectArray juris,
+                                                         jintArray jpriorities)
+{
+    vlcjni_object *p_m_obj = VLCJniObject_getInstance(env, jmedia);
+    jint attached = 0;
+
+    if (!p_m_obj)
+        return 0;
+
+    jsize count = (*env)->GetArrayLength(env, juris);
+    if ((*env)->GetArrayLength(env, jpriorities) != count)
+    {
+        throw_Exception(env, VLCJNI_EX_ILLEGAL_ARGUMENT, "invalid arguments");
+        return 0;
+    }
+    jint *p_priorities = (*env)->GetIntArrayElements(env, jpriorities, NULL);
+    if (!p_priorities)
+        return 0;
+
+    for (jsize i = 0; i < count; ++i)
+    {
+        jstring juri = (*env)->GetObjectArrayElement(env, juris, i);
+        const char *psz_uri = juri ? (*env)->GetStringUTFChars(env, juri, 0)
+                                   : NULL;
+        if (psz_uri
+         && libvlc_media_slaves_add(p_m_obj->u.p_m,
+                                    libvlc_media_slave_type_subtitle,
+                                    p_priorities[i], psz_uri) == 0)
+            attached++;
+        if (psz_uri)
+            (*env)->ReleaseStringUTFChars(env, juri, psz_uri);
+        if (juri)
+            (*env)->DeleteLocalRef(env, juri);
+    }
+    (*env)->ReleaseIntArrayElements(env, jpriorities, p_priorities, JNI_ABORT);
+
+    libvlc_media_add_option(p_m_obj->u.p_m, ":no-sub-autodetect-file");
+    return attached;
+}
+
+void
+Java_org_videolan_libvlc_util_SubtitleIndex_nativeInvalidate(JNIEnv *env,
+                                                             jobject thiz,
+                                                             jstring jpath)
+{
+    subtitle_index *p_index = SubtitleIndex_getInstance(env, thiz);
+    const char *psz_path = NULL;
+
+    if (!p_index)
+        return;
+    if (jpath && !(psz_path = (*env)->GetStringUTFChars(env, jpath, 0)))
+        return;
+
+    subtitle_index_Invalidate(p_index, psz_path);
+    if (psz_path)
+        (*env)->ReleaseStringUTFChars(env, jpath, psz_path);
+}
+
+void
+Java_org_videolan_libvlc_util_SubtitleIndex_nativeGetStats(JNIEnv *env,
+                                                           jobject thiz,
+                                                           jlongArray jstats)
+{
+    subtitle_index *p_index = SubtitleIndex_getInstance(env, thiz);
+    uint64_t stats[4];
+
+    if (!p_index)
+        return;
+    if ((*env)->GetArrayLength(env, jstats) < (jsize) ARRAY_SIZE(stats))
+    {
+        throw_Exception(env, VLCJNI_EX_ILLEGAL_ARGUMENT, "invalid arguments");
+        return;
+    }
+
+    subtitle_index_GetStats(p_index, stats);
+    jlong jvalues[ARRAY_SIZE(stats)];
+    for (size_t i = 0; i < ARRAY_SIZE(stats); ++i)
+        jvalues[i] = stats[i];
+    (*env)->SetLongArrayRegion(env, jstats, 0, ARRAY_SIZE(stats), jvalues);
+}
@@ -0,0 +1,321 @@
+/*****************************************************************************
+ * libvlcjni-thumbnailer.c
+ *****************************************************************************
+ * Copyright © 2023 VLC authors, VideoLAN and VideoLabs
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "libvlcjni-vlcobject.h"
+
+/* Keep in sync with Thumbnailer.java */
+#define FORMAT_RGBA 0
+#define FORMAT_RGB565 1
+
+#define STATUS_SUCCESS 0
+#define STATUS_FAILED 1
+#define STATUS_CANCELLED 2
+#define STATUS_BUFFER_TOO_SMALL 3
+
+#if defined(LIBVLC_VERSION_MAJOR) && LIBVLC_VERSION_MAJOR >= 4
+
+struct thumbnail_request
+{
+    pthread_mutex_t lock;
+    pthread_cond_t wait;
+
+    libvlc_instance_t *p_libvlc;
+    /* Private copy of the media: thumbnail events are sent to the media event
+     * manager, a copy avoids receiving events of other requests. */
+    libvlc_media_t *p_md;
+    libvlc_picture_t *p_pic;
+    bool b_done;
+    bool b_cancelled;
+};
+
+static struct thumbnail_request *
+Thumbnailer_getRequest(JNIEnv *env, jobject thiz)
+{
+    intptr_t i_ptr = (intptr_t)
+        (*env)->GetLongField(env, thiz, fields.Thumbnailer_Request_mInstance);
+    if (!i_ptr)
+        throw_Exception(env, VLCJNI_EX_ILLEGAL_STATE,
+                        "can't get Thumbnailer.Request instance");
+    return (struct thumbnail_request *) i_ptr;
+}
+
+static void
+Thumbnailer_event_cb(const libvlc_event_t *p_ev, void *data)
+{
+    struct thumbnail_request *p_tr = data;
+
+    if (p_ev->type != libvlc_MediaThumbnailGenerated)
+        return;
+
+    pthread_mutex_lock(&p_tr->lock);
+    if (p_ev->u.media_thumbnail_generated.p_thumbnail)
+        p_tr->p_pic =
+            libvlc_picture_retain(p_ev->u.media_thumbnail_generated.p_thumbnail);
+    p_tr->b_done = true;
+    pthread_cond_signal(&p_tr->wait);
+    pthread_mutex_unlock(&p_tr->lock);
+}
+
+/* Convert the ARGB picture (A, R, G, B bytes) into the Java buffer */
+static int
+Thumbnailer_convert(const libvlc_picture_t *p_pic, int format, uint8_t *p_dst,
+                    size_t dst_size, jint *p_info)
+{
+    size_t src_size;
+    const uint8_t *p_src = libvlc_picture_get_buffer(p_pic, &src_size);
+    unsigned width = libvlc_picture_get_width(p_pic);
+    unsigned height = libvlc_picture_get_height(p_pic);
+    unsigned src_stride = libvlc_picture_get_stride(p_pic);
+    unsigned bpp = format == FORMAT_RGB565 ? 2 : 4;
+    size_t dst_stride = (size_t) width * bpp;
+
+    p_info[0] = width;
+    p_info[1] = height;
+    p_info[2] = dst_stride;
+
+    if (!p_src || (size_t) src_stride * height > src_size)
+        return STATUS_FAILED;
+    if (dst_stride * height > dst_size)
+        return STATUS_BUFFER_TOO_SMALL;
+
+    for (unsigned y = 0; y < height; ++y)
+    {
+        const uint8_t *p_in = p_src + (size_t) y * src_stride;
+        uint8_t *p_out = p_dst + y * dst_stride;
+
+        if (format == FORMAT_RGB565)
+        {
+            for (unsigned x = 0; x < width; ++x, p_in += 4, p_out += 2)
+            {
+                uint16_t px = ((p_in[1] >> 3) << 11)
+                            | ((p_in[2] >> 2) << 5)
+                            | (p_in[3] >> 3);
+                /* Native (little endian) order, like Bitmap.Config.RGB_565 */
+                p_out[0] = px & 0xff;
+                p_out[1] = px >> 8;
+            }
+        }
+        else
+        {
+            for (unsigned x = 0; x < width; ++x, p_in += 4, p_out += 4)
+            {
+                p_out[0] = p_in[1];
+                p_out[1] = p_in[2];
+                p_out[2] = p_in[3];
+                p_out[3] = p_in[0];
+            }
+        }
+    }
+    return STATUS_SUCCESS;
+}
+
+void
+Java_org_videolan_libvlc_Thumbnailer_00024Request_nativeNew(JNIEnv *env,
+                                                            jobject thiz,
+                                                            jobject jmedia)
+{
+    vlcjni_object *p_m_obj = VLCJniObject_getInstance(env, jmedia);
+
+    if (!p_m_obj)
+        return;
+
+    struct thumbnail_request *p_tr = calloc(1, sizeof(*p_tr));
+    if (!p_tr)
+    {
+        throw_Exception(env, VLCJNI_EX_OUT_OF_MEMORY, "thumbnail_request");
+        return;
+    }
+
+    p_tr->p_md = libvlc_media_duplicate(p_m_obj->u.p_m);
+    if (!p_tr->p_md)
+    {
+        free(p_tr);
+        throw_Exception(env, VLCJNI_EX_ILLEGAL_STATE,
+                        "can't create Thumbnailer.Request instance");
+        return;
+    }
+    /* Thumbnails are decoded on the CPU: no surface is needed */
+    libvlc_media_add_option(p_tr->p_md, ":no-hw-dec");
+
+    if (libvlc_event_attach(libvlc_media_event_manager(p_tr->p_md),
+                            libvlc_MediaThumbnailGenerated,
+                            Thumbnailer_event_cb, p_tr) != 0)
+    {
+        libvlc_media_release(p_tr->p_md);
+        free(p_tr);
+        throw_Exception(env, VLCJNI_EX_OUT_OF_MEMORY, "thumbnail_request");
+        return;
+    }
+
+    pthread_mutex_init(&p_tr->lock, NULL);
+    pthread_cond_init(&p_tr->wait, NULL);
+    p_tr->p_libvlc = p_m_obj->p_libvlc;
+
+    (*env)->SetLongField(env, thiz, fields.Thumbnailer_Request_mInstance,
+                         (jlong)(intptr_t) p_tr);
+}
+
+void
+Java_org_videolan_libvlc_Thumbnailer_00024Request_nativeRelease(JNIEnv *env,
+                                                                jobject thiz)
+{
+    struct thumbnail_request *p_tr = Thumbnailer_getRequest(env, thiz);
+
+    if (!p_tr)
+        return;
+
+    libvlc_event_detach(libvlc_media_event_manager(p_tr->p_md),
+                        libvlc_MediaThumbnailGenerated,
+                        Thumbnailer_event_cb, p_tr);
+    if (p_tr->p_pic)
+        libvlc_picture_release(p_tr->p_pic);
+    libvlc_media_release(p_tr->p_md);
+    pthread_mutex_destroy(&p_tr->lock);
+    pthread_cond_destroy(&p_tr->wait);
+    free(p_tr);
+
+    (*env)->SetLongField(env, thiz, fields.Thumbnailer_Request_mInstance, 0);
+}
+
+/* Blocks until the thumbnail is generated, the request times out or is
+ * cancelled. */
+jint
+Java_org_videolan_libvlc_Thumbnailer_00024Request_nativeRun(JNIEnv *env,
+    jobject thiz, jboolean byPos, jlong time, jfloat pos, jboolean fast,
+    jint width, jint height, jboolean crop, jlong timeout, jint format,
+    jobject jbuffer, jintArray jinfo)
+{
+    struct thumbnail_request *p_tr = Thumbnailer_getRequest(env, thiz);
+    libvlc_media_thumbnail_request_t *p_req;
+    jint info[3] = { 0, 0, 0 };
+    int status;
+
+    if (!p_tr)
+        return STATUS_FAILED;
+
+    uint8_t *p_dst = (*env)->GetDirectBufferAddress(env, jbuffer);
+    jlong dst_size = (*env)->GetDirectBufferCapacity(env, jbuffer);
+    if (!p_dst || dst_size < 0
+     || (format != FORMAT_RGBA && format != FORMAT_RGB565)
+     || (*env)->GetArrayLength(env, jinfo) < (jsize) ARRAY_SIZE(info))
+    {
+        throw_Exception(env, VLCJNI_EX_ILLEGAL_ARGUMENT, "invalid arguments");
+        return STATUS_FAILED;
+    }
+
+    libvlc_thumbnailer_seek_speed_t speed = fast
+        ? libvlc_media_thumbnail_seek_fast : libvlc_media_thumbnail_seek_precise;
+
+    pthread_mutex_lock(&p_tr->lock);
+    if (p_tr->b_cancelled)
+    {
+        pthread_mutex_unlock(&p_tr->lock);
+        return STATUS_CANCELLED;
+    }
+    if (byPos)
+        p_req = libvlc_media_thumbnail_request_by_pos(p_tr->p_libvlc, p_tr->p_md,
+                                                      pos, speed, width, height,
+                                                      crop, libvlc_picture_Argb,
+                                                      timeout);
+    else
+        p_req = libvlc_media_thumbnail_request_by_time(p_tr->p_libvlc,
+                                                       p_tr->p_md, time, speed,
+                                                       width, height, crop,
+                                                       libvlc_picture_Argb,
+                                                       timeout);
+    if (!p_req)
+    {
+        pthread_mutex_unlock(&p_tr->lock);
+        return STATUS_FAILED;
+    }
+
+    while (!p_tr->b_done && !p_tr->b_cancelled)
+        pthread_cond_wait(&p_tr->wait, &p_tr->lock);
+    bool b_cancelled = !p_tr->b_done;
+    pthread_mutex_unlock(&p_tr->lock);
+
+    /* Cancels the request if it is still running, the event callback can't be
+     * called after that */
+    libvlc_media_thumbnail_request_destroy(p_req);
+
+    if (b_cancelled)
+        status = STATUS_CANCELLED;
+    else if (!p_tr->p_pic)
+        status = STATUS_FAILED;
+    else
+        status = Thumbnailer_convert(p_tr->p_pic, format, p_dst, dst_size,
+                                     info);
+
+    (*env)->SetIntArrayRegion(env, jinfo, 0, ARRAY_SIZE(info), info);
+    return status;
+}
+
+void
+Java_org_videolan_libvlc_Thumbnailer_00024Request_nativeCancel(JNIEnv *env,
+                                                               jobject thiz)
+{
+    struct thumbnail_request *p_tr = Thumbnailer_getRequest(env, thiz);
+
+    if (!p_tr)
+        return;
+
+    pthread_mutex_lock(&p_tr->lock);
+    p_tr->b_cancelled = true;
+    pthread_cond_signal(&p_tr->wait);
+    pthread_mutex_unlock(&p_tr->lock);
+}
+
+#else
+
+void
+Java_org_videolan_libvlc_Thumbnailer_00024Request_nativeNew(JNIEnv *env,
+                                                            jobject thiz,
+                                                            jobject jmedia)
+{
+    throw_Exception(env, VLCJNI_EX_ILLEGAL_STATE,
+                    "thumbnails need libvlc 4.0 or later");
+}
+
+void
+Java_org_videolan_libvlc_Thumbnailer_00024Request_nativeRelease(JNIEnv *env,
+                                                                jobject thiz)
+{
+}
+
+jint
+Java_org_videolan_libvlc_Thumbnailer_00024Request_nativeRun(JNIEnv *env,
+    jobject thiz, jboolean byPos, jlong time, jfloat pos, jboolean fast,
+    jint width, jint height, jboolean crop, jlong timeout, jint format,
+    jobject jbuffer, jintArray jinfo)
+{
+    return STATUS_FAILED;
+}
+
+void
+Java_org_videolan_libvlc_Thumbnailer_00024Request_nativeCancel(JNIEnv *env,
+                                                               jobject thiz)
+{
+}
+
+#endif
@@ -173,13 +173,22 @@ VLCJniObject_eventCallback(const libvlc_event_t *ev, void *data)
     if (!p_obj->p_owner->pf_event_cb(p_obj, ev, &jevent))
         return;
 
-    jstring string = jevent.argc1 ? vlcNewStringUTF(env, jevent.argc1) : NULL;
+    VLCJniObject_dispatchEvent(env, p_obj, &jevent);
+}
+
+void
+VLCJniObject_dispatchEvent(JNIEnv *env, vlcjni_object *p_obj,
+                           const java_event *p_java_event)
+{
+    jstring string = p_java_event->argc1 ?
+        vlcNewStringUTF(env, p_java_event->argc1) : NULL;
 
     if (p_obj->p_owner->weak)
         (*env)->CallVoidMethod(env, p_obj->p_owner->weak,
                                fields.VLCObject_dispatchEventFromNative,
-                               jevent.type, jevent.arg1, jevent.arg2,
-                               jevent.argf1, string);
+                               p_java_event->type, p_java_event->arg1,
+                               p_java_event->arg2, p_java_event->argf1,
+                               string);
     if (string)
         (*env)->DeleteLocalRef(env, string);
 }
@@ -91,6 +91,10 @@ void VLCJniObject_attachEvents(vlcjni_object *p_obj, event_cb pf_event_cb,
                                libvlc_event_manager_t *p_event_manager,
                                const int *p_events);
 
+/* Send an event to the Java object, synchronously from the calling thread */
+void VLCJniObject_dispatchEvent(JNIEnv *env, vlcjni_object *p_obj,
+                                const java_event *p_java_event);
+
 jobject
 media_track_to_jobject(JNIEnv *env, libvlc_media_track_t *track);
 
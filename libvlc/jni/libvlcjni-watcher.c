@@ -0,0 +1,978 @@
+/*****************************************************************************
+ * libvlcjni-watcher.c
+ *****************************************************************************
+ * Copyright © 2023 VLC authors, VideoLAN and VideoLabs
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef _GNU_SOURCE
+# define _GNU_SOURCE /* pipe2 */
+#endif
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/inotify.h>
+#include <sys/stat.h>
+
+#include "libvlcjni-vlcobject.h"
+#include "ext_set.h"
+
+#define THREAD_NAME "DirectoryWatcher"
+extern JNIEnv *jni_get_env(const char *name);
+
+/* Keep in sync with DirectoryWatcher.java */
+#define CHANGE_NONE -1
+#define CHANGE_CREATED 0
+#define CHANGE_MODIFIED 1
+#define CHANGE_DELETED 2
+#define CHANGE_MOVED 3
+#define CHANGE_RESCAN 4
+
+/* Same as DirectoryScanner.Flags */
+#define WATCH_FLAG_SHOW_HIDDEN 1
+#define WATCH_FLAG_NO_MEDIA 2
+
+#define WATCH_MASK (IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO \
+                  | IN_CLOSE_WRITE | IN_DELETE_SELF | IN_MOVE_SELF \
+                  | IN_ONLYDIR | IN_DONT_FOLLOW | IN_EXCL_UNLINK)
+
+#define EVENTS_BUFFER_SIZE (64 * 1024)
+
+struct change
+{
+    int type;
+    bool b_dir;
+    uint8_t categories;
+    /* In the table: file changes, merged by path */
+    bool b_keyed;
+    char *psz_path;
+    /* Source of a move, NULL until the destination is known */
+    char *psz_old_path;
+    uint32_t cookie;
+};
+
+struct watcher
+{
+    int fd;
+    int wake_fds[2];
+    pthread_t thread;
+    jweak weak;
+
+    const ext_set *p_set;
+    int flags;
+    int latency_ms;
+    unsigned max_batch;
+    char **ppsz_roots;
+    unsigned root_count;
+
+    /* Path of each watch descriptor, NULL if not used */
+    char **ppsz_wds;
+    size_t wd_capacity;
+
+    /* Pending batch, coalesced by path through an open addressing table of
+     * change index + 1 */
+    struct change *p_changes;
+    size_t count;
+    size_t capacity;
+    size_t *p_table;
+    size_t table_size;
+    size_t live;
+    int64_t deadline_ms;
+    bool b_overflow;
+
+    atomic_uint watches;
+    atomic_uint failed_watches;
+    atomic_uint overflows;
+    atomic_uint batches;
+    atomic_uint changes;
+};
+
+static int64_t
+Watcher_now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t) ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static struct watcher *
+Watcher_get(JNIEnv *env, jobject thiz)
+{
+    intptr_t i_ptr = (intptr_t)
+        (*env)->GetLongField(env, thiz, fields.DirectoryWatcher_mInstance);
+    if (!i_ptr)
+        throw_Exception(env, VLCJNI_EX_ILLEGAL_STATE,
+                        "can't get DirectoryWatcher instance");
+    return (struct watcher *) i_ptr;
+}
+
+static char *
+Watcher_join(const char *psz_dir, const char *psz_name)
+{
+    size_t dir_len = strcmp(psz_dir, "/") == 0 ? 0 : strlen(psz_dir);
+    size_t name_len = strlen(psz_name);
+    char *psz_path = malloc(dir_len + 1 + name_len + 1);
+    if (psz_path)
+    {
+        memcpy(psz_path, psz_dir, dir_len);
+        psz_path[dir_len] = '/';
+        memcpy(psz_path + dir_len + 1, psz_name, name_len + 1);
+    }
+    return psz_path;
+}
+
+static bool
+Watcher_isHidden(const struct watcher *p_w, const char *psz_name)
+{
+    return psz_name[0] == '.' && !(p_w->flags & WATCH_FLAG_SHOW_HIDDEN);
+}
+
+static void
+Watcher_setWd(struct watcher *p_w, int wd, const char *psz_path)
+{
+    if ((size_t) wd >= p_w->wd_capacity)
+    {
+        size_t capacity = p_w->wd_capacity ? p_w->wd_capacity : 256;
+        while (capacity <= (size_t) wd)
+            capacity *= 2;
+        char **ppsz_wds = realloc(p_w->ppsz_wds, capacity * sizeof(*ppsz_wds));
+        if (!ppsz_wds)
+            return;
+        memset(ppsz_wds + p_w->wd_capacity, 0,
+               (capacity - p_w->wd_capacity) * sizeof(*ppsz_wds));
+        p_w->ppsz_wds = ppsz_wds;
+        p_w->wd_capacity = capacity;
+    }
+    if (p_w->ppsz_wds[wd])
+    {
+        /* Already watched, inotify returns the same descriptor */
+        if (strcmp(p_w->ppsz_wds[wd], psz_path) == 0)
+            return;
+        free(p_w->ppsz_wds[wd]);
+    }
+    else
+        atomic_fetch_add(&p_w->watches, 1);
+    p_w->ppsz_wds[wd] = strdup(psz_path);
+}
+
+static void
+Watcher_clearWd(struct watcher *p_w, int wd)
+{
+    if (wd < 0 || (size_t) wd >= p_w->wd_capacity || !p_w->ppsz_wds[wd])
+        return;
+    free(p_w->ppsz_wds[wd]);
+    p_w->ppsz_wds[wd] = NULL;
+    atomic_fetch_sub(&p_w->watches, 1);
+}
+
+static bool
+Watcher_isUnder(const char *psz_path, const char *psz_dir, size_t dir_len)
+{
+    return strncmp(psz_path, psz_dir, dir_len) == 0
+        && (psz_path[dir_len] == '\0' || psz_path[dir_len] == '/');
+}
+
+/* Stop watching a directory moved out of the roots, and its children */
+static void
+Watcher_unwatchTree(struct watcher *p_w, const char *psz_dir)
+{
+    size_t dir_len = strlen(psz_dir);
+    for (size_t wd = 0; wd < p_w->wd_capacity; ++wd)
+    {
+        if (p_w->ppsz_wds[wd]
+         && Watcher_isUnder(p_w->ppsz_wds[wd], psz_dir, dir_len))
+        {
+            inotify_rm_watch(p_w->fd, wd);
+            Watcher_clearWd(p_w, wd);
+        }
+    }
+}
+
+/* Update the paths of the watches of a directory moved within the roots */
+static void
+Watcher_renameTree(struct watcher *p_w, const char *psz_old,
+                   const char *psz_new)
+{
+    size_t old_len = strlen(psz_old), new_len = strlen(psz_new);
+    for (size_t wd = 0; wd < p_w->wd_capacity; ++wd)
+    {
+        char *psz_path = p_w->ppsz_wds[wd];
+        if (!psz_path || !Watcher_isUnder(psz_path, psz_old, old_len))
+            continue;
+        size_t tail_len = strlen(psz_path + old_len);
+        char *psz_renamed = malloc(new_len + tail_len + 1);
+        if (!psz_renamed)
+            continue;
+        memcpy(psz_renamed, psz_new, new_len);
+        memcpy(psz_renamed + new_len, psz_path + old_len, tail_len + 1);
+        free(psz_path);
+        p_w->ppsz_wds[wd] = psz_renamed;
+    }
+}
+
+static bool
+Watcher_hasNoMedia(const char *psz_dir)
+{
+    char *psz_nomedia = Watcher_join(psz_dir, ".nomedia");
+    bool b_ret = psz_nomedia && access(psz_nomedia, F_OK) == 0;
+    free(psz_nomedia);
+    return b_ret;
+}
+
+/* Watch a directory and all its sub directories */
+static void
+Watcher_watchTree(struct watcher *p_w, const char *psz_root)
+{
+    char **ppsz_stack = NULL;
+    size_t stack_size = 0, stack_capacity = 0;
+    char *psz_dir = strdup(psz_root);
+
+    while (psz_dir)
+    {
+        int wd = -1;
+        DIR *p_dir = NULL;
+
+        if (!(p_w->flags & WATCH_FLAG_NO_MEDIA) || !Watcher_hasNoMedia(psz_dir))
+        {
+            wd = inotify_add_watch(p_w->fd, psz_dir, WATCH_MASK);
+            /* ENOSPC once the max_user_watches limit is reached */
+            if (wd < 0 && errno != ENOENT && errno != ENOTDIR)
+                atomic_fetch_add(&p_w->failed_watches, 1);
+        }
+        if (wd >= 0)
+        {
+            Watcher_setWd(p_w, wd, psz_dir);
+            p_dir = opendir(psz_dir);
+        }
+
+        struct dirent *p_ent;
+        while (p_dir && (p_ent = readdir(p_dir)) != NULL)
+        {
+            if (strcmp(p_ent->d_name, ".") == 0
+             || strcmp(p_ent->d_name, "..") == 0
+             || Watcher_isHidden(p_w, p_ent->d_name))
+                continue;
+            if (p_ent->d_type != DT_DIR && p_ent->d_type != DT_UNKNOWN)
+                continue;
+            if (p_ent->d_type == DT_UNKNOWN)
+            {
+                struct stat st;
+                if (fstatat(dirfd(p_dir), p_ent->d_name, &st,
+                            AT_SYMLINK_NOFOLLOW) != 0 || !S_ISDIR(st.st_mode))
+                    continue;
+            }
+
+            char *psz_child = Watcher_join(psz_dir, p_ent->d_name);
+            if (!psz_child)
+                continue;
+            if (stack_size == stack_capacity)
+            {
+                size_t capacity = stack_capacity ? stack_capacity * 2 : 64;
+                char **ppsz = realloc(ppsz_stack, capacity * sizeof(*ppsz));
+                if (!ppsz)
+                {
+                    free(psz_child);
+                    continue;
+                }
+                ppsz_stack = ppsz;
+                stack_capacity = capacity;
+            }
+            ppsz_stack[stack_size++] = psz_child;
+        }
+        if (p_dir)
+            closedir(p_dir);
+
+        free(psz_dir);
+        psz_dir = stack_size > 0 ? ppsz_stack[--stack_size] : NULL;
+    }
+    free(ppsz_stack);
+}
+
+static size_t
+Watcher_hashPath(const char *psz_path)
+{
+    /* FNV-1a */
+    uint64_t hash = UINT64_C(0xcbf29ce484222325);
+    for (const unsigned char *p = (const unsigned char *) psz_path; *p; ++p)
+        hash = (hash ^ *p) * UINT64_C(0x100000001b3);
+    return hash;
+}
+
+/* Index + 1 of the table slot of path, or of the free slot where it goes */
+static size_t *
+Watcher_findSlot(struct watcher *p_w, const char *psz_path)
+{
+    size_t mask = p_w->table_size - 1;
+    for (size_t i = Watcher_hashPath(psz_path) & mask;; i = (i + 1) & mask)
+    {
+        size_t *p_slot = &p_w->p_table[i];
+        if (*p_slot == 0
+         || strcmp(p_w->p_changes[*p_slot - 1].psz_path, psz_path) == 0)
+            return p_slot;
+    }
+}
+
+static bool
+Watcher_growTable(struct watcher *p_w)
+{
+    /* Keep the load factor under 1/2 */
+    if (p_w->count < p_w->table_size / 2)
+        return true;
+
+    size_t size = p_w->table_size ? p_w->table_size * 2 : 256;
+    size_t *p_table = calloc(size, sizeof(*p_table));
+    if (!p_table)
+        return false;
+    free(p_w->p_table);
+    p_w->p_table = p_table;
+    p_w->table_size = size;
+    for (size_t i = 0; i < p_w->count; ++i)
+    {
+        if (p_w->p_changes[i].b_keyed)
+            *Watcher_findSlot(p_w, p_w->p_changes[i].psz_path) = i + 1;
+    }
+    return true;
+}
+
+/* Takes ownership of the paths */
+static struct change *
+Watcher_append(struct watcher *p_w, int type, bool b_dir, uint8_t categories,
+               char *psz_path, char *psz_old_path)
+{
+    if (p_w->count == p_w->capacity)
+    {
+        size_t capacity = p_w->capacity ? p_w->capacity * 2 : 64;
+        struct change *p_changes = realloc(p_w->p_changes,
+                                           capacity * sizeof(*p_changes));
+        if (!p_changes)
+            goto error;
+        p_w->p_changes = p_changes;
+        p_w->capacity = capacity;
+    }
+    if (!Watcher_growTable(p_w))
+        goto error;
+
+    if (p_w->live == 0)
+        p_w->deadline_ms = Watcher_now() + p_w->latency_ms;
+    struct change *p_change = &p_w->p_changes[p_w->count++];
+    p_change->type = type;
+    p_change->b_dir = b_dir;
+    p_change->categories = categories;
+    p_change->psz_path = psz_path;
+    p_change->psz_old_path = psz_old_path;
+    p_change->b_keyed = false;
+    p_change->cookie = 0;
+    p_w->live++;
+    return p_change;
+
+error:
+    free(psz_path);
+    free(psz_old_path);
+    return NULL;
+}
+
+static int
+Watcher_merge(int old_type, int new_type)
+{
+    switch (old_type)
+    {
+        case CHANGE_CREATED:
+            if (new_type == CHANGE_MODIFIED)
+                return CHANGE_CREATED;
+            if (new_type == CHANGE_DELETED)
+                return CHANGE_NONE;
+            break;
+        case CHANGE_DELETED:
+            /* Replaced: the content changed */
+            if (new_type == CHANGE_CREATED || new_type == CHANGE_MODIFIED)
+                return CHANGE_MODIFIED;
+            break;
+    }
+    return new_type;
+}
+
+/* Add a created, modified or deleted file, merged with the previous change of
+ * the same path in the batch. Takes ownership of path. */
+static void
+Watcher_addFileChange(struct watcher *p_w, int type, uint8_t categories,
+                      char *psz_path)
+{
+    if (!psz_path || !Watcher_growTable(p_w))
+    {
+        free(psz_path);
+        return;
+    }
+
+    size_t *p_slot = Watcher_findSlot(p_w, psz_path);
+    if (*p_slot == 0)
+    {
+        size_t index = p_w->count;
+        if (Watcher_append(p_w, type, false, categories, psz_path, NULL))
+        {
+            p_w->p_changes[index].b_keyed = true;
+            *Watcher_findSlot(p_w, psz_path) = index + 1;
+        }
+        return;
+    }
+
+    struct change *p_change = &p_w->p_changes[*p_slot - 1];
+    if (p_change->type == CHANGE_NONE)
+    {
+        /* Dropped or moved away: the new change goes after the ones already
+         * in the batch */
+        size_t index = p_w->count;
+        if (Watcher_append(p_w, type, false, categories, psz_path, NULL))
+        {
+            /* The table was grown above: slots are still valid */
+            p_w->p_changes[*p_slot - 1].b_keyed = false;
+            p_w->p_changes[index].b_keyed = true;
+            *p_slot = index + 1;
+        }
+        return;
+    }
+
+    free(psz_path);
+    p_change->type = Watcher_merge(p_change->type, type);
+    p_change->categories = categories;
+    if (p_change->type == CHANGE_NONE)
+        p_w->live--;
+}
+
+/* Changes of a path moved within the batch: file changes of the source are
+ * carried over to the destination */
+static void
+Watcher_moveFileChange(struct watcher *p_w, const char *psz_old,
+                       const char *psz_new, uint8_t categories)
+{
+    if (!Watcher_growTable(p_w))
+        return;
+    size_t *p_slot = Watcher_findSlot(p_w, psz_old);
+    int type = CHANGE_NONE;
+
+    if (*p_slot != 0)
+    {
+        struct change *p_change = &p_w->p_changes[*p_slot - 1];
+        type = p_change->type;
+        if (type != CHANGE_NONE)
+            p_w->live--;
+        p_change->type = CHANGE_NONE;
+    }
+    /* Not known by the client yet: this is a creation */
+    if (type == CHANGE_CREATED)
+    {
+        Watcher_addFileChange(p_w, CHANGE_CREATED, categories,
+                              strdup(psz_new));
+        return;
+    }
+
+    char *psz_new_dup = strdup(psz_new), *psz_old_dup = strdup(psz_old);
+    if (psz_new_dup && psz_old_dup)
+        Watcher_append(p_w, CHANGE_MOVED, false, categories, psz_new_dup,
+                       psz_old_dup);
+    else
+    {
+        free(psz_new_dup);
+        free(psz_old_dup);
+    }
+    if (type == CHANGE_MODIFIED)
+        Watcher_addFileChange(p_w, CHANGE_MODIFIED, categories,
+                              strdup(psz_new));
+}
+
+static void
+Watcher_onEvent(struct watcher *p_w, const struct inotify_event *p_ev)
+{
+    if (p_ev->mask & IN_Q_OVERFLOW)
+    {
+        if (p_w->live == 0 && !p_w->b_overflow)
+            p_w->deadline_ms = Watcher_now() + p_w->latency_ms;
+        p_w->b_overflow = true;
+        atomic_fetch_add(&p_w->overflows, 1);
+        return;
+    }
+    if (p_ev->wd < 0 || (size_t) p_ev->wd >= p_w->wd_capacity
+     || !p_w->ppsz_wds[p_ev->wd])
+        return;
+    if (p_ev->mask & IN_IGNORED)
+    {
+        Watcher_clearWd(p_w, p_ev->wd);
+        return;
+    }
+
+    const char *psz_dir = p_w->ppsz_wds[p_ev->wd];
+    if (p_ev->mask & (IN_DELETE_SELF | IN_MOVE_SELF))
+    {
+        /* Other directories are handled from the events of their parent */
+        for (unsigned i = 0; i < p_w->root_count; ++i)
+        {
+            if (strcmp(p_w->ppsz_roots[i], psz_dir) != 0)
+                continue;
+            Watcher_append(p_w, CHANGE_DELETED, true, 0, strdup(psz_dir), NULL);
+            if (p_ev->mask & IN_MOVE_SELF)
+                Watcher_unwatchTree(p_w, p_w->ppsz_roots[i]);
+            break;
+        }
+        return;
+    }
+    if (p_ev->len == 0 || Watcher_isHidden(p_w, p_ev->name))
+        return;
+
+    bool b_dir = p_ev->mask & IN_ISDIR;
+    uint8_t categories = b_dir ? 0 : ext_set_Lookup(p_w->p_set, p_ev->name);
+    if (!b_dir && categories == 0)
+        return;
+    char *psz_path = Watcher_join(psz_dir, p_ev->name);
+    if (!psz_path)
+        return;
+
+    if (p_ev->mask & IN_MOVED_FROM)
+    {
+        /* Until the matching IN_MOVED_TO */
+        struct change *p_change = Watcher_append(p_w, CHANGE_MOVED, b_dir,
+                                                 categories, NULL, psz_path);
+        if (p_change)
+            p_change->cookie = p_ev->cookie;
+    }
+    else if (p_ev->mask & IN_MOVED_TO)
+    {
+        struct change *p_from = NULL;
+        for (size_t i = p_w->count; i-- > 0 && !p_from;)
+        {
+            struct change *p_change = &p_w->p_changes[i];
+            if (p_change->type == CHANGE_MOVED && !p_change->psz_path
+             && p_change->cookie == p_ev->cookie)
+                p_from = p_change;
+        }
+
+        if (!p_from)
+        {
+            /* Moved from outside of the roots */
+            if (b_dir)
+            {
+                Watcher_watchTree(p_w, psz_path);
+                Watcher_append(p_w, CHANGE_RESCAN, true, 0, psz_path, NULL);
+            }
+            else
+                Watcher_addFileChange(p_w, CHANGE_CREATED, categories,
+                                      psz_path);
+        }
+        else if (b_dir)
+        {
+            p_from->psz_path = psz_path;
+            Watcher_renameTree(p_w, p_from->psz_old_path, psz_path);
+        }
+        else
+        {
+            p_from->type = CHANGE_NONE;
+            p_w->live--;
+            Watcher_moveFileChange(p_w, p_from->psz_old_path, psz_path,
+                                   categories);
+            free(psz_path);
+        }
+    }
+    else if (b_dir)
+    {
+        if (p_ev->mask & IN_CREATE)
+        {
+            /* Files may be created before the new directory is watched */
+            Watcher_watchTree(p_w, psz_path);
+            Watcher_append(p_w, CHANGE_RESCAN, true, 0, psz_path, NULL);
+        }
+        else if (p_ev->mask & IN_DELETE)
+            Watcher_append(p_w, CHANGE_DELETED, true, 0, psz_path, NULL);
+        else
+            free(psz_path);
+    }
+    else if (p_ev->mask & IN_CREATE)
+        Watcher_addFileChange(p_w, CHANGE_CREATED, categories, psz_path);
+    else if (p_ev->mask & IN_CLOSE_WRITE)
+        Watcher_addFileChange(p_w, CHANGE_MODIFIED, categories, psz_path);
+    else if (p_ev->mask & IN_DELETE)
+        Watcher_addFileChange(p_w, CHANGE_DELETED, categories, psz_path);
+    else
+        free(psz_path);
+}
+
+static void
+Watcher_clearBatch(struct watcher *p_w)
+{
+    for (size_t i = 0; i < p_w->count; ++i)
+    {
+        free(p_w->p_changes[i].psz_path);
+        free(p_w->p_changes[i].psz_old_path);
+    }
+    p_w->count = 0;
+    p_w->live = 0;
+    p_w->b_overflow = false;
+    if (p_w->p_table)
+        memset(p_w->p_table, 0, p_w->table_size * sizeof(*p_w->p_table));
+}
+
+static void
+Watcher_dispatch(JNIEnv *env, struct watcher *p_w)
+{
+    size_t count = 0;
+    for (size_t i = 0; i < p_w->count; ++i)
+    {
+        struct change *p_change = &p_w->p_changes[i];
+        /* File names are raw bytes: drop the ones Java can't represent */
+        if (p_change->type != CHANGE_NONE
+         && ((p_change->psz_path && !vlcIsValidUTF(p_change->psz_path))
+          || (p_change->psz_old_path && !vlcIsValidUTF(p_change->psz_old_path))))
+            p_change->type = CHANGE_NONE;
+        count += p_change->type != CHANGE_NONE;
+    }
+    if (count == 0)
+        return;
+
+    jobject jobj = (*env)->NewLocalRef(env, p_w->weak);
+    if (!jobj)
+        return;
+
+    jintArray jtypes = (*env)->NewIntArray(env, count);
+    jobjectArray jpaths = (*env)->NewObjectArray(env, count,
+                                                 fields.String_clazz, NULL);
+    jobjectArray jold_paths = (*env)->NewObjectArray(env, count,
+                                                     fields.String_clazz, NULL);
+    jbyteArray jcategories = (*env)->NewByteArray(env, count);
+    if (!jtypes || !jpaths || !jold_paths || !jcategories)
+        goto end;
+
+    size_t index = 0;
+    for (size_t i = 0; i < p_w->count; ++i)
+    {
+        const struct change *p_change = &p_w->p_changes[i];
+        if (p_change->type == CHANGE_NONE)
+            continue;
+
+        jint type = p_change->type;
+        jbyte categories = p_change->categories;
+        (*env)->SetIntArrayRegion(env, jtypes, index, 1, &type);
+        (*env)->SetByteArrayRegion(env, jcategories, index, 1, &categories);
+        if (p_change->psz_path)
+        {
+            jstring jpath = vlcNewStringUTF(env, p_change->psz_path);
+            if (!jpath)
+                goto end;
+            (*env)->SetObjectArrayElement(env, jpaths, index, jpath);
+            (*env)->DeleteLocalRef(env, jpath);
+        }
+        if (p_change->psz_old_path)
+        {
+            jstring jpath = vlcNewStringUTF(env, p_change->psz_old_path);
+            if (!jpath)
+                goto end;
+            (*env)->SetObjectArrayElement(env, jold_paths, index, jpath);
+            (*env)->DeleteLocalRef(env, jpath);
+        }
+        index++;
+    }
+
+    (*env)->CallVoidMethod(env, jobj, fields.DirectoryWatcher_onChangesFromNative,
+                           jtypes, jpaths, jold_paths, jcategories,
+                           (jboolean) p_w->b_overflow);
+end:
+    if ((*env)->ExceptionCheck(env))
+        (*env)->ExceptionClear(env);
+    if (jtypes)
+        (*env)->DeleteLocalRef(env, jtypes);
+    if (jpaths)
+        (*env)->DeleteLocalRef(env, jpaths);
+    if (jold_paths)
+        (*env)->DeleteLocalRef(env, jold_paths);
+    if (jcategories)
+        (*env)->DeleteLocalRef(env, jcategories);
+    (*env)->DeleteLocalRef(env, jobj);
+}
+
+static void
+Watcher_flush(JNIEnv *env, struct watcher *p_w)
+{
+    if (p_w->b_overflow)
+    {
+        /* Events were lost: the pending changes are replaced by a rescan of
+         * each root, and new directories are watched again */
+        bool b_overflow = true;
+        Watcher_clearBatch(p_w);
+        for (unsigned i = 0; i < p_w->root_count; ++i)
+        {
+            Watcher_watchTree(p_w, p_w->ppsz_roots[i]);
+            Watcher_append(p_w, CHANGE_RESCAN, true, 0,
+                           strdup(p_w->ppsz_roots[i]), NULL);
+        }
+        p_w->b_overflow = b_overflow;
+    }
+    else
+    {
+        /* Sources of moves without destination were moved out of the roots */
+        for (size_t i = 0; i < p_w->count; ++i)
+        {
+            struct change *p_change = &p_w->p_changes[i];
+            if (p_change->type != CHANGE_MOVED || p_change->psz_path)
+                continue;
+            p_change->type = CHANGE_DELETED;
+            p_change->psz_path = p_change->psz_old_path;
+            p_change->psz_old_path = NULL;
+            if (!p_change->b_dir)
+                continue;
+            Watcher_unwatchTree(p_w, p_change->psz_path);
+
+            /* Sent by the watches of the directory once out of the roots */
+            size_t len = strlen(p_change->psz_path);
+            for (size_t j = i + 1; j < p_w->count; ++j)
+            {
+                struct change *p_next = &p_w->p_changes[j];
+                if (p_next->type != CHANGE_NONE && p_next->psz_path
+                 && Watcher_isUnder(p_next->psz_path, p_change->psz_path, len))
+                {
+                    p_next->type = CHANGE_NONE;
+                    p_w->live--;
+                }
+            }
+        }
+    }
+
+    atomic_fetch_add(&p_w->batches, 1);
+    atomic_fetch_add(&p_w->changes, p_w->live);
+    if (env)
+        Watcher_dispatch(env, p_w);
+    Watcher_clearBatch(p_w);
+}
+
+static void *
+Watcher_thread(void *data)
+{
+    struct watcher *p_w = data;
+    JNIEnv *env = jni_get_env(THREAD_NAME);
+    /* Aligned for struct inotify_event */
+    char *p_buffer = malloc(EVENTS_BUFFER_SIZE);
+
+    if (!p_buffer)
+        return NULL;
+    for (unsigned i = 0; i < p_w->root_count; ++i)
+        Watcher_watchTree(p_w, p_w->ppsz_roots[i]);
+
+    for (;;)
+    {
+        bool b_pending = p_w->live > 0 || p_w->b_overflow;
+        int timeout = -1;
+        if (b_pending)
+        {
+            int64_t remaining = p_w->deadline_ms - Watcher_now();
+            timeout = remaining > 0 ? remaining : 0;
+        }
+
+        struct pollfd fds[] = {
+            { .fd = p_w->fd, .events = POLLIN },
+            { .fd = p_w->wake_fds[0], .events = POLLIN },
+        };
+        int ret = poll(fds, ARRAY_SIZE(fds), timeout);
+        if (ret < 0 && errno != EINTR)
+            break;
+        if (ret > 0 && fds[1].revents)
+            break;
+
+        if (ret > 0 && (fds[0].revents & POLLIN))
+        {
+            ssize_t len = read(p_w->fd, p_buffer, EVENTS_BUFFER_SIZE);
+            for (ssize_t pos = 0; pos < len;)
+            {
+                const struct inotify_event *p_ev =
+                    (const struct inotify_event *)(p_buffer + pos);
+                Watcher_onEvent(p_w, p_ev);
+                pos += sizeof(*p_ev) + p_ev->len;
+            }
+        }
+
+        if ((p_w->live > 0 || p_w->b_overflow)
+         && (p_w->live >= p_w->max_batch || Watcher_now() >= p_w->deadline_ms))
+            Watcher_flush(env, p_w);
+    }
+
+    free(p_buffer);
+    return NULL;
+}
+
+static void
+Watcher_delete(JNIEnv *env, struct watcher *p_w)
+{
+    Watcher_clearBatch(p_w);
+    free(p_w->p_changes);
+    free(p_w->p_table);
+    for (size_t wd = 0; wd < p_w->wd_capacity; ++wd)
+        free(p_w->ppsz_wds[wd]);
+    free(p_w->ppsz_wds);
+    for (unsigned i = 0; i < p_w->root_count; ++i)
+        free(p_w->ppsz_roots[i]);
+    free(p_w->ppsz_roots);
+    if (p_w->fd != -1)
+        close(p_w->fd);
+    if (p_w->wake_fds[0] != -1)
+    {
+        close(p_w->wake_fds[0]);
+        close(p_w->wake_fds[1]);
+    }
+    if (p_w->weak)
+        (*env)->DeleteWeakGlobalRef(env, p_w->weak);
+    ext_set_Release(p_w->p_set);
+    free(p_w);
+}
+
+void
+Java_org_videolan_libvlc_util_DirectoryWatcher_nativeNew(JNIEnv *env,
+                                                         jobject thiz,
+                                                         jobjectArray jroots,
+                                                         jint flags,
+                                                         jint latency,
+                                                         jint maxBatch)
+{
+    const ext_set *p_set = ext_set_GetDefault();
+    jsize root_count = jroots ? (*env)->GetArrayLength(env, jroots) : 0;
+
+    if (!p_set || root_count == 0 || latency < 0 || maxBatch <= 0)
+    {
+        ext_set_Release(p_set);
+        throw_Exception(env, VLCJNI_EX_ILLEGAL_ARGUMENT, "invalid arguments");
+        return;
+    }
+
+    struct watcher *p_w = calloc(1, sizeof(*p_w));
+    if (!p_w)
+    {
+        ext_set_Release(p_set);
+        throw_Exception(env, VLCJNI_EX_OUT_OF_MEMORY, "DirectoryWatcher");
+        return;
+    }
+    p_w->fd = -1;
+    p_w->wake_fds[0] = p_w->wake_fds[1] = -1;
+    p_w->p_set = p_set;
+    p_w->flags = flags;
+    p_w->latency_ms = latency;
+    p_w->max_batch = maxBatch;
+
+    p_w->ppsz_roots = calloc(root_count, sizeof(*p_w->ppsz_roots));
+    if (!p_w->ppsz_roots)
+        goto enomem;
+    for (jsize i = 0; i < root_count; ++i)
+    {
+        jstring jroot = (*env)->GetObjectArrayElement(env, jroots, i);
+        const char *psz_root = jroot ? (*env)->GetStringUTFChars(env, jroot, NULL)
+                                     : NULL;
+        if (!psz_root)
+        {
+            (*env)->DeleteLocalRef(env, jroot);
+            Watcher_delete(env, p_w);
+            throw_Exception(env, VLCJNI_EX_ILLEGAL_ARGUMENT, "root invalid");
+            return;
+        }
+        char *psz_dup = strdup(psz_root);
+        (*env)->ReleaseStringUTFChars(env, jroot, psz_root);
+        (*env)->DeleteLocalRef(env, jroot);
+        if (!psz_dup)
+            goto enomem;
+        for (size_t len = strlen(psz_dup); len > 1 && psz_dup[len - 1] == '/';)
+            psz_dup[--len] = '\0';
+        p_w->ppsz_roots[p_w->root_count++] = psz_dup;
+    }
+
+    p_w->fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (p_w->fd == -1 || pipe2(p_w->wake_fds, O_CLOEXEC) != 0)
+    {
+        p_w->wake_fds[0] = p_w->wake_fds[1] = -1;
+        Watcher_delete(env, p_w);
+        throw_Exception(env, VLCJNI_EX_ILLEGAL_STATE, "inotify unavailable");
+        return;
+    }
+    atomic_init(&p_w->watches, 0);
+    atomic_init(&p_w->failed_watches, 0);
+    atomic_init(&p_w->overflows, 0);
+    atomic_init(&p_w->batches, 0);
+    atomic_init(&p_w->changes, 0);
+
+    p_w->weak = (*env)->NewWeakGlobalRef(env, thiz);
+    if (!p_w->weak)
+    {
+        Watcher_delete(env, p_w);
+        throw_Exception(env, VLCJNI_EX_ILLEGAL_STATE,
+                        "No DirectoryWatcher weak reference");
+        return;
+    }
+
+    if (pthread_create(&p_w->thread, NULL, Watcher_thread, p_w) != 0)
+        goto enomem;
+
+    (*env)->SetLongField(env, thiz, fields.DirectoryWatcher_mInstance,
+                         (jlong)(intptr_t) p_w);
+    return;
+
+enomem:
+    Watcher_delete(env, p_w);
+    throw_Exception(env, VLCJNI_EX_OUT_OF_MEMORY, "DirectoryWatcher");
+}
+
+void
+Java_org_videolan_libvlc_util_DirectoryWatcher_nativeRelease(JNIEnv *env,
+                                                             jobject thiz)
+{
+    struct watcher *p_w = Watcher_get(env, thiz);
+
+    if (!p_w)
+        return;
+
+    /* The thread does not wait for the Java side: it can be joined */
+    char c = 0;
+    while (write(p_w->wake_fds[1], &c, 1) == -1 && errno == EINTR);
+    pthread_join(p_w->thread, NULL);
+    Watcher_delete(env, p_w);
+
+    (*env)->SetLongField(env, thiz, fields.DirectoryWatcher_mInstance, 0);
+}
+
+/* Counters: watched directories, directories that could not be watched,
+ * queue overflows, batches and changes delivered */
+void
+Java_org_videolan_libvlc_util_DirectoryWatcher_nativeGetStats(JNIEnv *env,
+                                                              jobject thiz,
+                                                              jlongArray jstats)
+{
+    struct watcher *p_w = Watcher_get(env, thiz);
+
+    if (!p_w)
+        return;
+
+    jlong stats[] = {
+        atomic_load(&p_w->watches),
+        atomic_load(&p_w->failed_watches),
+        atomic_load(&p_w->overflows),
+        atomic_load(&p_w->batches),
+        atomic_load(&p_w->changes),
+    };
+    if ((*env)->GetArrayLength(env, jstats) < (jsize) ARRAY_SIZE(stats))
+    {
+        throw_Exception(env, VLCJNI_EX_ILLEGAL_ARGUMENT, "invalid arguments");
+        return;
+    }
+    (*env)->SetLongArrayRegion(env, jstats, 0, ARRAY_SIZE(stats), stats);
+}
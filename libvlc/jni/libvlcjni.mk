@@ -13,6 +13,11 @@ LOCAL_SRC_FILES += libvlcjni-mediaplayer.c
 LOCAL_SRC_FILES += libvlcjni-vlcobject.c
 LOCAL_SRC_FILES += libvlcjni-media.c libvlcjni-medialist.c libvlcjni-mediadiscoverer.c libvlcjni-rendererdiscoverer.c
 LOCAL_SRC_FILES += libvlcjni-dialog.c
+LOCAL_SRC_FILES += libvlcjni-thumbnailer.c
+LOCAL_SRC_FILES += libvlcjni-playliststore.c playliststore.c playlistparser.c
+LOCAL_SRC_FILES += libvlcjni-scanner.c libvlcjni-watcher.c ext_set.c
+LOCAL_SRC_FILES += libvlcjni-subtitleindex.c subtitleindex.c
+LOCAL_SRC_FILES += fingerprint.c
 LOCAL_SRC_FILES += std_logger.c
 LOCAL_C_INCLUDES := $(VLC_SRC_DIR)/include $(VLC_BUILD_DIR)/include
 LOCAL_CFLAGS := -std=c17
@@ -0,0 +1,500 @@
+/*****************************************************************************
+ * playlistparser.c
+ *****************************************************************************
+ * Copyright © 2023 VLC authors, VideoLAN and VideoLabs
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef _GNU_SOURCE
+# define _GNU_SOURCE /* strndup */
+#endif
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+#include "playlistparser.h"
+
+enum playlist_format
+{
+    FORMAT_UNKNOWN,
+    FORMAT_M3U,
+    FORMAT_PLS,
+};
+
+/* Growable string */
+struct buffer
+{
+    char *p;
+    size_t size;
+    size_t alloc;
+};
+
+struct playlist_parser
+{
+    playlist_store *p_store;
+    char *psz_base;
+    enum playlist_format format;
+    uint32_t count;
+
+    /* Incomplete line of the previous chunk */
+    struct buffer line;
+
+    /* Pending entry: #EXTINF of M3U, or the current index of PLS */
+    struct buffer fields[PLAYLIST_FIELD_COUNT];
+    int64_t duration;
+    long pls_index;
+};
+
+static int
+buffer_Set(struct buffer *p_buf, const char *p, size_t size)
+{
+    if (size + 1 > p_buf->alloc)
+    {
+        size_t alloc = p_buf->alloc ? p_buf->alloc : 256;
+        while (alloc < size + 1)
+            alloc *= 2;
+        char *p_new = realloc(p_buf->p, alloc);
+        if (!p_new)
+            return -1;
+        p_buf->p = p_new;
+        p_buf->alloc = alloc;
+    }
+    memcpy(p_buf->p, p, size);
+    p_buf->p[size] = '\0';
+    p_buf->size = size;
+    return 0;
+}
+
+static int
+buffer_Append(struct buffer *p_buf, const char *p, size_t size)
+{
+    if (p_buf->size + size + 1 > p_buf->alloc)
+    {
+        size_t alloc = p_buf->alloc ? p_buf->alloc : 256;
+        while (alloc < p_buf->size + size + 1)
+            alloc *= 2;
+        char *p_new = realloc(p_buf->p, alloc);
+        if (!p_new)
+            return -1;
+        p_buf->p = p_new;
+        p_buf->alloc = alloc;
+    }
+    memcpy(p_buf->p + p_buf->size, p, size);
+    p_buf->size += size;
+    p_buf->p[p_buf->size] = '\0';
+    return 0;
+}
+
+static void
+parser_ResetEntry(playlist_parser *p_parser)
+{
+    for (int i = 0; i < PLAYLIST_FIELD_COUNT; ++i)
+        p_parser->fields[i].size = 0;
+    p_parser->duration = -1;
+}
+
+playlist_parser *
+playlist_parser_New(playlist_store *p_store, const char *psz_base)
+{
+    playlist_parser *p_parser = calloc(1, sizeof(*p_parser));
+    if (!p_parser)
+        return NULL;
+
+    if (psz_base && *psz_base)
+    {
+        size_t len = strlen(psz_base);
+        while (len > 0 && psz_base[len - 1] == '/')
+            len--;
+        p_parser->psz_base = strndup(psz_base, len);
+        if (!p_parser->psz_base)
+        {
+            free(p_parser);
+            return NULL;
+        }
+    }
+    p_parser->p_store = p_store;
+    p_parser->duration = -1;
+    return p_parser;
+}
+
+void
+playlist_parser_Delete(playlist_parser *p_parser)
+{
+    free(p_parser->line.p);
+    for (int i = 0; i < PLAYLIST_FIELD_COUNT; ++i)
+        free(p_parser->fields[i].p);
+    free(p_parser->psz_base);
+    free(p_parser);
+}
+
+uint32_t
+playlist_parser_Count(const playlist_parser *p_parser)
+{
+    return p_parser->count;
+}
+
+static bool
+is_space(char c)
+{
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+static const char *
+skip_spaces(const char *p, const char *p_end)
+{
+    while (p < p_end && is_space(*p))
+        p++;
+    return p;
+}
+
+static const char *
+trim_end(const char *p, const char *p_end)
+{
+    while (p_end > p && is_space(p_end[-1]))
+        p_end--;
+    return p_end;
+}
+
+static bool
+has_prefix(const char *p, const char *p_end, const char *psz_prefix)
+{
+    size_t len = strlen(psz_prefix);
+    return (size_t)(p_end - p) >= len && strncasecmp(p, psz_prefix, len) == 0;
+}
+
+static bool
+is_unreserved(unsigned char c)
+{
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z')
+        || (c >= '0' && c <= '9') || strchr("-._~/!$&'()*+,;=:@", c);
+}
+
+/* Append a local path to a mrl, percent-encoded */
+static int
+append_path(struct buffer *p_buf, const char *p, const char *p_end)
+{
+    static const char hex[] = "0123456789ABCDEF";
+
+    for (; p < p_end; ++p)
+    {
+        unsigned char c = *p;
+        if (c != '\0' && is_unreserved(c))
+        {
+            if (buffer_Append(p_buf, p, 1) != 0)
+                return -1;
+        }
+        else
+        {
+            char esc[3] = { '%', hex[c >> 4], hex[c & 0xf] };
+            if (buffer_Append(p_buf, esc, 3) != 0)
+                return -1;
+        }
+    }
+    return 0;
+}
+
+/* Set the mrl of the pending entry from a location of the playlist */
+static int
+parser_SetLocation(playlist_parser *p_parser, const char *p, const char *p_end)
+{
+    struct buffer *p_mrl = &p_parser->fields[PLAYLIST_FIELD_MRL];
+    const char *p_colon = memchr(p, ':', p_end - p);
+
+    p_mrl->size = 0;
+    if (p_colon && p_colon + 2 < p_end && p_colon[1] == '/' && p_colon[2] == '/')
+        return buffer_Set(p_mrl, p, p_end - p);
+    if (*p == '/')
+    {
+        if (buffer_Set(p_mrl, "file://", 7) != 0)
+            return -1;
+        return append_path(p_mrl, p, p_end);
+    }
+    if (!p_parser->psz_base)
+        return buffer_Set(p_mrl, p, p_end - p);
+    if (buffer_Set(p_mrl, p_parser->psz_base, strlen(p_parser->psz_base)) != 0
+     || buffer_Append(p_mrl, "/", 1) != 0)
+        return -1;
+    return append_path(p_mrl, p, p_end);
+}
+
+/* Add the pending entry, if it has a location */
+static int
+parser_AddEntry(playlist_parser *p_parser)
+{
+    const char *ppsz_fields[PLAYLIST_FIELD_COUNT];
+
+    if (p_parser->fields[PLAYLIST_FIELD_MRL].size == 0)
+    {
+        parser_ResetEntry(p_parser);
+        return 0;
+    }
+
+    for (int i = 0; i < PLAYLIST_FIELD_COUNT; ++i)
+        ppsz_fields[i] = p_parser->fields[i].size > 0 ? p_parser->fields[i].p
+                                                      : NULL;
+    int ret = playlist_store_Add(p_parser->p_store, ppsz_fields,
+                                 p_parser->duration);
+    if (ret == 0)
+        p_parser->count++;
+    parser_ResetEntry(p_parser);
+    return ret;
+}
+
+static int64_t
+parse_duration(const char *p, const char *p_end)
+{
+    /* Seconds, possibly with decimals, -1 or 0 when unknown */
+    int64_t ms = 0;
+    bool b_digits = false;
+
+    p = skip_spaces(p, p_end);
+    if (p < p_end && *p == '-')
+        return -1;
+    for (; p < p_end && *p >= '0' && *p <= '9'; ++p, b_digits = true)
+    {
+        if (ms > INT64_MAX / 10000)
+            return -1;
+        ms = ms * 10 + (*p - '0');
+    }
+    ms *= 1000;
+    if (p < p_end && *p == '.')
+    {
+        int64_t scale = 100;
+        for (++p; p < p_end && *p >= '0' && *p <= '9'; ++p, scale /= 10)
+            ms += (*p - '0') * scale;
+    }
+    return b_digits && ms > 0 ? ms : -1;
+}
+
+/* #EXTINF:<duration> key="value" key=value ...,<title> */
+static int
+parser_ParseExtinf(playlist_parser *p_parser, const char *p, const char *p_end)
+{
+    const char *p_attrs = p;
+    while (p_attrs < p_end && !is_space(*p_attrs) && *p_attrs != ',')
+        p_attrs++;
+    p_parser->duration = parse_duration(p, p_attrs);
+
+    const char *p_name = NULL, *p_name_end = NULL;
+    p = p_attrs;
+    for (;;)
+    {
+        p = skip_spaces(p, p_end);
+        if (p >= p_end || *p == ',')
+            break;
+
+        const char *p_key = p;
+        while (p < p_end && *p != '=' && *p != ',' && !is_space(*p))
+            p++;
+        const char *p_key_end = p;
+        const char *p_value = p, *p_value_end = p;
+        if (p < p_end && *p == '=')
+        {
+            p++;
+            if (p < p_end && (*p == '"' || *p == '\''))
+            {
+                char quote = *p++;
+                p_value = p;
+                while (p < p_end && *p != quote)
+                    p++;
+                p_value_end = p;
+                if (p < p_end)
+                    p++;
+            }
+            else
+            {
+                p_value = p;
+                while (p < p_end && *p != ',' && !is_space(*p))
+                    p++;
+                p_value_end = p;
+            }
+        }
+
+        size_t key_len = p_key_end - p_key;
+        int field = -1;
+        if (key_len == 11 && strncasecmp(p_key, "group-title", 11) == 0)
+            field = PLAYLIST_FIELD_GROUP;
+        else if (key_len == 6 && strncasecmp(p_key, "tvg-id", 6) == 0)
+            field = PLAYLIST_FIELD_TVG_ID;
+        else if ((key_len == 8 && strncasecmp(p_key, "tvg-logo", 8) == 0)
+              || (key_len == 4 && strncasecmp(p_key, "logo", 4) == 0))
+            field = PLAYLIST_FIELD_LOGO;
+        else if (key_len == 8 && strncasecmp(p_key, "tvg-name", 8) == 0)
+        {
+            p_name = p_value;
+            p_name_end = p_value_end;
+        }
+        if (field >= 0
+         && buffer_Set(&p_parser->fields[field], p_value,
+                       p_value_end - p_value) != 0)
+            return -1;
+        if (p == p_key_end && p == p_key)
+            p++; /* Stray character */
+    }
+
+    /* The title is after the first comma out of quotes */
+    const char *p_title = p < p_end ? skip_spaces(p + 1, p_end) : p_end;
+    const char *p_title_end = trim_end(p_title, p_end);
+    if (p_title == p_title_end && p_name)
+    {
+        p_title = p_name;
+        p_title_end = p_name_end;
+    }
+    return buffer_Set(&p_parser->fields[PLAYLIST_FIELD_TITLE], p_title,
+                      p_title_end - p_title);
+}
+
+static int
+parser_ParseM3ULine(playlist_parser *p_parser, const char *p, const char *p_end)
+{
+    if (*p != '#')
+    {
+        int ret = parser_SetLocation(p_parser, p, p_end);
+        return ret == 0 ? parser_AddEntry(p_parser) : ret;
+    }
+    if (has_prefix(p, p_end, "#EXTINF:"))
+        return parser_ParseExtinf(p_parser, p + 8, p_end);
+    if (has_prefix(p, p_end, "#EXTGRP:"))
+    {
+        /* #EXTINF attributes take precedence */
+        struct buffer *p_group = &p_parser->fields[PLAYLIST_FIELD_GROUP];
+        if (p_group->size > 0)
+            return 0;
+        p = skip_spaces(p + 8, p_end);
+        return buffer_Set(p_group, p, p_end - p);
+    }
+    return 0;
+}
+
+/* FileN=, TitleN= and LengthN= keys, an entry ends when the index changes */
+static int
+parser_ParsePLSLine(playlist_parser *p_parser, const char *p, const char *p_end)
+{
+    static const struct
+    {
+        const char *psz_key;
+        size_t len;
+        int field;
+    } keys[] = {
+        { "file", 4, PLAYLIST_FIELD_MRL },
+        { "title", 5, PLAYLIST_FIELD_TITLE },
+        { "length", 6, -1 },
+    };
+
+    for (size_t i = 0; i < sizeof(keys) / sizeof(*keys); ++i)
+    {
+        if (!has_prefix(p, p_end, keys[i].psz_key))
+            continue;
+
+        const char *p_index = p + keys[i].len;
+        long index = 0;
+        const char *p_eq = p_index;
+        for (; p_eq < p_end && *p_eq >= '0' && *p_eq <= '9'; ++p_eq)
+            index = index * 10 + (*p_eq - '0');
+        if (p_eq == p_index || p_eq >= p_end || *p_eq != '=')
+            return 0;
+
+        if (index != p_parser->pls_index)
+        {
+            if (parser_AddEntry(p_parser) != 0)
+                return -1;
+            p_parser->pls_index = index;
+        }
+
+        const char *p_value = skip_spaces(p_eq + 1, p_end);
+        if (keys[i].field == PLAYLIST_FIELD_MRL)
+            return p_value < p_end ? parser_SetLocation(p_parser, p_value, p_end)
+                                   : 0;
+        if (keys[i].field == PLAYLIST_FIELD_TITLE)
+            return buffer_Set(&p_parser->fields[PLAYLIST_FIELD_TITLE], p_value,
+                              p_end - p_value);
+        p_parser->duration = parse_duration(p_value, p_end);
+        return 0;
+    }
+    return 0;
+}
+
+static int
+parser_ParseLine(playlist_parser *p_parser, const char *p, const char *p_end)
+{
+    /* UTF-8 BOM */
+    if (p_parser->format == FORMAT_UNKNOWN && p_end - p >= 3
+     && memcmp(p, "\xEF\xBB\xBF", 3) == 0)
+        p += 3;
+    p = skip_spaces(p, p_end);
+    p_end = trim_end(p, p_end);
+    if (p == p_end)
+        return 0;
+
+    if (p_parser->format == FORMAT_UNKNOWN)
+    {
+        p_parser->format = has_prefix(p, p_end, "[playlist]") ? FORMAT_PLS
+                                                             : FORMAT_M3U;
+        if (p_parser->format == FORMAT_PLS)
+            return 0;
+    }
+    return p_parser->format == FORMAT_PLS
+         ? parser_ParsePLSLine(p_parser, p, p_end)
+         : parser_ParseM3ULine(p_parser, p, p_end);
+}
+
+int
+playlist_parser_Feed(playlist_parser *p_parser, const char *p_data,
+                     size_t size)
+{
+    const char *p = p_data, *p_end = p_data + size;
+
+    while (p < p_end)
+    {
+        const char *p_eol = memchr(p, '\n', p_end - p);
+        if (!p_eol)
+            return buffer_Append(&p_parser->line, p, p_end - p);
+
+        int ret;
+        if (p_parser->line.size > 0)
+        {
+            /* Line started in the previous chunk */
+            ret = buffer_Append(&p_parser->line, p, p_eol - p);
+            if (ret == 0)
+                ret = parser_ParseLine(p_parser, p_parser->line.p,
+                                       p_parser->line.p + p_parser->line.size);
+            p_parser->line.size = 0;
+        }
+        else
+            ret = parser_ParseLine(p_parser, p, p_eol);
+        if (ret != 0)
+            return ret;
+        p = p_eol + 1;
+    }
+    return 0;
+}
+
+int
+playlist_parser_End(playlist_parser *p_parser)
+{
+    int ret = 0;
+    if (p_parser->line.size > 0)
+    {
+        ret = parser_ParseLine(p_parser, p_parser->line.p,
+                               p_parser->line.p + p_parser->line.size);
+        p_parser->line.size = 0;
+    }
+    /* Last PLS entry */
+    if (ret == 0 && p_parser->format == FORMAT_PLS)
+        ret = parser_AddEntry(p_parser);
+    return ret;
+}
@@ -0,0 +1,53 @@
+/*****************************************************************************
+ * playlistparser.h
+ *****************************************************************************
+ * Copyright © 2023 VLC authors, VideoLAN and VideoLabs
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef PLAYLISTPARSER_H
+#define PLAYLISTPARSER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "playliststore.h"
+
+/* Streaming parser of M3U (with #EXTINF attributes) and PLS playlists,
+ * appending the entries to a playlist_store. The playlist is fed in chunks
+ * of any size: only the last incomplete line is copied.
+ *
+ * The format is detected from the first line. Relative locations are
+ * resolved against the base mrl, if any. */
+
+typedef struct playlist_parser playlist_parser;
+
+/* psz_base is the mrl of the directory of the playlist, can be NULL */
+playlist_parser *playlist_parser_New(playlist_store *p_store,
+                                     const char *psz_base);
+void playlist_parser_Delete(playlist_parser *p_parser);
+
+/* Returns 0 on success, -1 on allocation failure */
+int playlist_parser_Feed(playlist_parser *p_parser, const char *p_data,
+                         size_t size);
+/* Parse the last line and the pending entry. Returns 0 on success, -1 on
+ * allocation failure. */
+int playlist_parser_End(playlist_parser *p_parser);
+
+/* Number of entries added to the store */
+uint32_t playlist_parser_Count(const playlist_parser *p_parser);
+
+#endif // PLAYLISTPARSER_H
@@ -0,0 +1,351 @@
+/*****************************************************************************
+ * playliststore.c
+ *****************************************************************************
+ * Copyright © 2023 VLC authors, VideoLAN and VideoLabs
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef _GNU_SOURCE
+# define _GNU_SOURCE /* strcasestr */
+#endif
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+#include "playliststore.h"
+
+#define ARENA_INIT_SIZE (64 * 1024)
+#define RECORDS_INIT_SIZE 256
+
+struct playlist_record
+{
+    /* Offsets in the arena, 0 is the shared empty string */
+    uint32_t strings[PLAYLIST_FIELD_COUNT];
+    int64_t duration;
+};
+
+struct playlist_store
+{
+    char *p_arena;
+    size_t arena_size;
+    size_t arena_alloc;
+
+    struct playlist_record *p_records;
+    uint32_t count;
+    uint32_t alloc;
+
+    /* All the records, in sort order */
+    uint32_t *p_order;
+    /* Records of p_order matching psz_filter, unused without filter */
+    uint32_t *p_view;
+    uint32_t view_count;
+    char *psz_filter;
+};
+
+playlist_store *
+playlist_store_New(void)
+{
+    playlist_store *p_store = calloc(1, sizeof(*p_store));
+    if (!p_store)
+        return NULL;
+
+    p_store->p_arena = malloc(ARENA_INIT_SIZE);
+    if (!p_store->p_arena)
+    {
+        free(p_store);
+        return NULL;
+    }
+    p_store->p_arena[0] = '\0';
+    p_store->arena_size = 1;
+    p_store->arena_alloc = ARENA_INIT_SIZE;
+    return p_store;
+}
+
+void
+playlist_store_Delete(playlist_store *p_store)
+{
+    free(p_store->p_arena);
+    free(p_store->p_records);
+    free(p_store->p_order);
+    free(p_store->p_view);
+    free(p_store->psz_filter);
+    free(p_store);
+}
+
+void
+playlist_store_Clear(playlist_store *p_store)
+{
+    p_store->arena_size = 1;
+    p_store->count = 0;
+    p_store->view_count = 0;
+}
+
+/* Returns the offset of the copied string, 0 for empty strings and
+ * UINT32_MAX on error */
+static uint32_t
+playlist_store_AddString(playlist_store *p_store, const char *psz)
+{
+    if (!psz || !*psz)
+        return 0;
+
+    size_t len = strlen(psz) + 1;
+    if (len > UINT32_MAX - p_store->arena_size)
+        return UINT32_MAX;
+
+    if (p_store->arena_size + len > p_store->arena_alloc)
+    {
+        size_t alloc = p_store->arena_alloc * 2;
+        while (alloc < p_store->arena_size + len)
+            alloc *= 2;
+        char *p_arena = realloc(p_store->p_arena, alloc);
+        if (!p_arena)
+            return UINT32_MAX;
+        p_store->p_arena = p_arena;
+        p_store->arena_alloc = alloc;
+    }
+
+    uint32_t offset = p_store->arena_size;
+    memcpy(p_store->p_arena + offset, psz, len);
+    p_store->arena_size += len;
+    return offset;
+}
+
+static bool
+playlist_store_Matches(const playlist_store *p_store, uint32_t record)
+{
+    const struct playlist_record *p_rec = &p_store->p_records[record];
+
+    for (int i = 0; i <= PLAYLIST_FIELD_GROUP; ++i)
+        if (strcasestr(p_store->p_arena + p_rec->strings[i],
+                       p_store->psz_filter))
+            return true;
+    return false;
+}
+
+static void
+playlist_store_UpdateView(playlist_store *p_store)
+{
+    p_store->view_count = 0;
+    for (uint32_t i = 0; i < p_store->count; ++i)
+        if (playlist_store_Matches(p_store, p_store->p_order[i]))
+            p_store->p_view[p_store->view_count++] = p_store->p_order[i];
+}
+
+int
+playlist_store_Add(playlist_store *p_store,
+                   const char *const ppsz_fields[PLAYLIST_FIELD_COUNT],
+                   int64_t duration)
+{
+    if (!ppsz_fields[PLAYLIST_FIELD_MRL])
+        return -1;
+
+    if (p_store->count == p_store->alloc)
+    {
+        uint32_t alloc = p_store->alloc ? p_store->alloc * 2
+                                        : RECORDS_INIT_SIZE;
+        struct playlist_record *p_records =
+            realloc(p_store->p_records, alloc * sizeof(*p_records));
+        if (!p_records)
+            return -1;
+        p_store->p_records = p_records;
+
+        uint32_t *p_order = realloc(p_store->p_order, alloc * sizeof(*p_order));
+        if (!p_order)
+            return -1;
+        p_store->p_order = p_order;
+
+        uint32_t *p_view = realloc(p_store->p_view, alloc * sizeof(*p_view));
+        if (!p_view)
+            return -1;
+        p_store->p_view = p_view;
+
+        p_store->alloc = alloc;
+    }
+
+    /* On failure, the strings already copied are lost until the next
+     * clear */
+    size_t arena_size = p_store->arena_size;
+    struct playlist_record *p_rec = &p_store->p_records[p_store->count];
+    const struct playlist_record *p_prev = p_store->count > 0 ? p_rec - 1 : NULL;
+    for (int i = 0; i < PLAYLIST_FIELD_COUNT; ++i)
+    {
+        /* Metas like the album or the group are often the same for
+         * consecutive entries */
+        if (p_prev && ppsz_fields[i]
+         && strcmp(p_store->p_arena + p_prev->strings[i], ppsz_fields[i]) == 0)
+        {
+            p_rec->strings[i] = p_prev->strings[i];
+            continue;
+        }
+        p_rec->strings[i] = playlist_store_AddString(p_store, ppsz_fields[i]);
+        if (p_rec->strings[i] == UINT32_MAX)
+        {
+            p_store->arena_size = arena_size;
+            return -1;
+        }
+    }
+    p_rec->duration = duration;
+
+    uint32_t record = p_store->count++;
+    p_store->p_order[record] = record;
+    if (p_store->psz_filter && playlist_store_Matches(p_store, record))
+        p_store->p_view[p_store->view_count++] = record;
+    return 0;
+}
+
+uint32_t
+playlist_store_Count(const playlist_store *p_store)
+{
+    return p_store->psz_filter ? p_store->view_count : p_store->count;
+}
+
+uint32_t
+playlist_store_TotalCount(const playlist_store *p_store)
+{
+    return p_store->count;
+}
+
+static const struct playlist_record *
+playlist_store_RecordAt(const playlist_store *p_store, uint32_t index)
+{
+    uint32_t record = p_store->psz_filter ? p_store->p_view[index]
+                                          : p_store->p_order[index];
+    return &p_store->p_records[record];
+}
+
+const char *
+playlist_store_GetString(const playlist_store *p_store, uint32_t index,
+                         enum playlist_field field)
+{
+    return p_store->p_arena
+         + playlist_store_RecordAt(p_store, index)->strings[field];
+}
+
+int64_t
+playlist_store_GetDuration(const playlist_store *p_store, uint32_t index)
+{
+    return playlist_store_RecordAt(p_store, index)->duration;
+}
+
+static int
+playlist_store_Compare(const playlist_store *p_store, enum playlist_sort key,
+                       uint32_t a, uint32_t b)
+{
+    const struct playlist_record *p_a = &p_store->p_records[a];
+    const struct playlist_record *p_b = &p_store->p_records[b];
+
+    switch (key)
+    {
+        case PLAYLIST_SORT_DURATION:
+            return (p_a->duration > p_b->duration)
+                 - (p_a->duration < p_b->duration);
+        case PLAYLIST_SORT_TITLE:
+        case PLAYLIST_SORT_ARTIST:
+        case PLAYLIST_SORT_PATH:
+        {
+            enum playlist_field field =
+                key == PLAYLIST_SORT_TITLE ? PLAYLIST_FIELD_TITLE :
+                key == PLAYLIST_SORT_ARTIST ? PLAYLIST_FIELD_ARTIST :
+                PLAYLIST_FIELD_MRL;
+            return strcasecmp(p_store->p_arena + p_a->strings[field],
+                              p_store->p_arena + p_b->strings[field]);
+        }
+        default:
+            return 0;
+    }
+}
+
+int
+playlist_store_Sort(playlist_store *p_store, enum playlist_sort key,
+                    bool ascending)
+{
+    uint32_t count = p_store->count;
+
+    if (key == PLAYLIST_SORT_NONE)
+    {
+        /* Back to the insertion order */
+        for (uint32_t i = 0; i < count; ++i)
+            p_store->p_order[i] = i;
+    }
+    else if (count > 1)
+    {
+        uint32_t *p_tmp = malloc(count * sizeof(*p_tmp));
+        if (!p_tmp)
+            return -1;
+
+        /* Bottom-up merge sort: stable, and O(n log n) in the worst case */
+        uint32_t *p_src = p_store->p_order, *p_dst = p_tmp;
+        for (uint32_t width = 1; width < count; width *= 2)
+        {
+            for (uint32_t lo = 0; lo < count; lo += 2 * width)
+            {
+                uint32_t mid = lo + width < count ? lo + width : count;
+                uint32_t hi = mid + width < count ? mid + width : count;
+                uint32_t i = lo, j = mid, k = lo;
+
+                while (i < mid && j < hi)
+                {
+                    int cmp = playlist_store_Compare(p_store, key, p_src[i],
+                                                     p_src[j]);
+                    if (!ascending)
+                        cmp = -cmp;
+                    p_dst[k++] = cmp <= 0 ? p_src[i++] : p_src[j++];
+                }
+                while (i < mid)
+                    p_dst[k++] = p_src[i++];
+                while (j < hi)
+                    p_dst[k++] = p_src[j++];
+            }
+            uint32_t *p_swap = p_src;
+            p_src = p_dst;
+            p_dst = p_swap;
+        }
+        if (p_src != p_store->p_order)
+            memcpy(p_store->p_order, p_src, count * sizeof(*p_src));
+        free(p_tmp);
+    }
+
+    /* The view follows the new order */
+    if (p_store->psz_filter)
+        playlist_store_UpdateView(p_store);
+    return 0;
+}
+
+int
+playlist_store_SetFilter(playlist_store *p_store, const char *psz_query)
+{
+    free(p_store->psz_filter);
+    p_store->psz_filter = NULL;
+    p_store->view_count = 0;
+
+    if (!psz_query || !*psz_query)
+        return 0;
+
+    p_store->psz_filter = strdup(psz_query);
+    if (!p_store->psz_filter)
+        return -1;
+
+    playlist_store_UpdateView(p_store);
+    return 0;
+}
+
+size_t
+playlist_store_MemoryUsage(const playlist_store *p_store)
+{
+    return sizeof(*p_store) + p_store->arena_alloc
+         + (size_t) p_store->alloc * (sizeof(struct playlist_record)
+                                      + 2 * sizeof(uint32_t));
+}
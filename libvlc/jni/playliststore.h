@@ -0,0 +1,96 @@
+/*****************************************************************************
+ * playliststore.h
+ *****************************************************************************
+ * Copyright © 2023 VLC authors, VideoLAN and VideoLabs
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef PLAYLISTSTORE_H
+#define PLAYLISTSTORE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Compact playlist: the strings of all entries are stored back to back in a
+ * single arena, and each entry is a fixed width record of arena offsets.
+ * Sorting and filtering only reorder 32 bits record indexes.
+ *
+ * Not thread-safe: callers serialize the accesses. */
+
+/* Keep in sync with PlaylistStore.java */
+enum playlist_field
+{
+    PLAYLIST_FIELD_MRL,
+    PLAYLIST_FIELD_TITLE,
+    PLAYLIST_FIELD_ARTIST,
+    PLAYLIST_FIELD_ALBUM,
+    /* From IPTV playlists */
+    PLAYLIST_FIELD_GROUP,
+    PLAYLIST_FIELD_TVG_ID,
+    PLAYLIST_FIELD_LOGO,
+    PLAYLIST_FIELD_COUNT,
+};
+
+enum playlist_sort
+{
+    PLAYLIST_SORT_TITLE,
+    PLAYLIST_SORT_ARTIST,
+    PLAYLIST_SORT_DURATION,
+    PLAYLIST_SORT_PATH,
+    PLAYLIST_SORT_NONE,
+};
+
+typedef struct playlist_store playlist_store;
+
+playlist_store *playlist_store_New(void);
+void playlist_store_Delete(playlist_store *p_store);
+
+/* Append an entry, NULL fields are stored as empty strings. The mrl is
+ * mandatory. Fields equal to the ones of the previous entry share its
+ * string. Returns 0 on success, -1 on allocation failure. */
+int playlist_store_Add(playlist_store *p_store,
+                       const char *const ppsz_fields[PLAYLIST_FIELD_COUNT],
+                       int64_t duration);
+
+void playlist_store_Clear(playlist_store *p_store);
+
+/* Number of entries matching the filter */
+uint32_t playlist_store_Count(const playlist_store *p_store);
+/* Number of entries, ignoring the filter */
+uint32_t playlist_store_TotalCount(const playlist_store *p_store);
+
+/* Accessors of the index-th entry matching the filter, in sort order. The
+ * index must be lower than playlist_store_Count(). */
+const char *playlist_store_GetString(const playlist_store *p_store,
+                                     uint32_t index, enum playlist_field field);
+int64_t playlist_store_GetDuration(const playlist_store *p_store,
+                                   uint32_t index);
+
+/* Stable sort of all the entries, the ones added later are appended
+ * unsorted. Returns 0 on success, -1 on allocation failure. */
+int playlist_store_Sort(playlist_store *p_store, enum playlist_sort key,
+                        bool ascending);
+
+/* Keep only the entries whose title, artist, album, group or mrl contains
+ * query, ignoring case. NULL or "" removes the filter. Returns 0 on success, -1 on
+ * allocation failure. */
+int playlist_store_SetFilter(playlist_store *p_store, const char *psz_query);
+
+/* Bytes allocated by the store */
+size_t playlist_store_MemoryUsage(const playlist_store *p_store);
+
+#endif // PLAYLISTSTORE_H
@@ -0,0 +1,566 @@
+/*****************************************************************************
+ * subtitleindex.c
+ *****************************************************************************
+ * Copyright © 2023 VLC authors, VideoLAN and VideoLabs
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef _GNU_SOURCE
+# define _GNU_SOURCE /* strndup, st_mtim */
+#endif
+#include <dirent.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/stat.h>
+
+#include "fingerprint.h"
+#include "subtitleindex.h"
+
+/* Keep in sync with DirectoryScanner.Category */
+#define CATEGORY_SUBTITLE 4
+
+#define PRIORITY_EXACT 4
+#define PRIORITY_PREFIX 3
+#define PRIORITY_HASH 4
+
+struct subtitle_entry
+{
+    char *psz_path;
+    /* Lower case base name, without extension, separators replaced by a
+     * single space */
+    char *psz_norm;
+    /* OpenSubtitles hash found in the name, 0 if none */
+    uint64_t hash;
+};
+
+struct subtitle_dir
+{
+    char *psz_path;
+    struct timespec mtime;
+    bool b_exists;
+    uint64_t last_use;
+    struct subtitle_entry *p_entries;
+    size_t count;
+    /* "Subs" and "Subtitles" sub directories */
+    char *ppsz_subdirs[2];
+};
+
+struct subtitle_index
+{
+    pthread_mutex_t lock;
+    const ext_set *p_set;
+
+    struct subtitle_dir *p_dirs;
+    size_t dir_count;
+    unsigned max_dirs;
+    uint64_t clock;
+
+    char **ppsz_folders;
+    size_t folder_count;
+
+    uint64_t lookups;
+    uint64_t scans;
+    uint64_t cache_hits;
+    uint64_t hashes;
+};
+
+subtitle_index *
+subtitle_index_New(const ext_set *p_set, unsigned max_dirs)
+{
+    subtitle_index *p_index = calloc(1, sizeof(*p_index));
+    if (!p_index)
+        return NULL;
+    p_index->p_dirs = calloc(max_dirs > 0 ? max_dirs : 1,
+                             sizeof(*p_index->p_dirs));
+    if (!p_index->p_dirs)
+    {
+        free(p_index);
+        return NULL;
+    }
+    pthread_mutex_init(&p_index->lock, NULL);
+    p_index->p_set = p_set;
+    p_index->max_dirs = max_dirs > 0 ? max_dirs : 1;
+    return p_index;
+}
+
+static void
+subtitle_dir_Clean(struct subtitle_dir *p_dir)
+{
+    for (size_t i = 0; i < p_dir->count; ++i)
+    {
+        free(p_dir->p_entries[i].psz_path);
+        free(p_dir->p_entries[i].psz_norm);
+    }
+    free(p_dir->p_entries);
+    free(p_dir->ppsz_subdirs[0]);
+    free(p_dir->ppsz_subdirs[1]);
+    free(p_dir->psz_path);
+    memset(p_dir, 0, sizeof(*p_dir));
+}
+
+void
+subtitle_index_Delete(subtitle_index *p_index)
+{
+    for (size_t i = 0; i < p_index->dir_count; ++i)
+        subtitle_dir_Clean(&p_index->p_dirs[i]);
+    free(p_index->p_dirs);
+    for (size_t i = 0; i < p_index->folder_count; ++i)
+        free(p_index->ppsz_folders[i]);
+    free(p_index->ppsz_folders);
+    ext_set_Release(p_index->p_set);
+    pthread_mutex_destroy(&p_index->lock);
+    free(p_index);
+}
+
+int
+subtitle_index_AddFolder(subtitle_index *p_index, const char *psz_dir)
+{
+    int ret = -1;
+
+    pthread_mutex_lock(&p_index->lock);
+    char **ppsz_folders = realloc(p_index->ppsz_folders,
+                                  (p_index->folder_count + 1)
+                                  * sizeof(*ppsz_folders));
+    if (ppsz_folders)
+    {
+        p_index->ppsz_folders = ppsz_folders;
+        ppsz_folders[p_index->folder_count] = strdup(psz_dir);
+        if (ppsz_folders[p_index->folder_count])
+        {
+            p_index->folder_count++;
+            ret = 0;
+        }
+    }
+    pthread_mutex_unlock(&p_index->lock);
+    return ret;
+}
+
+/* Normalized base name of a file name, from its start to p_end */
+static char *
+normalize(const char *psz_name, const char *p_end)
+{
+    char *psz_norm = malloc(p_end - psz_name + 1);
+    if (!psz_norm)
+        return NULL;
+
+    char *p_out = psz_norm;
+    bool b_sep = false;
+    for (const char *p = psz_name; p < p_end; ++p)
+    {
+        unsigned char c = *p;
+        if (c >= 'A' && c <= 'Z')
+            c += 'a' - 'A';
+        bool b_alnum = (c >= 'a' && c <= 'z') || (c >= '0' && c <= '9')
+                    || c >= 0x80;
+        if (!b_alnum)
+        {
+            b_sep = p_out != psz_norm;
+            continue;
+        }
+        if (b_sep)
+            *p_out++ = ' ';
+        b_sep = false;
+        *p_out++ = c;
+    }
+    *p_out = '\0';
+    return psz_norm;
+}
+
+static const char *
+strip_extension(const char *psz_name)
+{
+    const char *psz_dot = strrchr(psz_name, '.');
+    return psz_dot && psz_dot != psz_name ? psz_dot
+                                          : psz_name + strlen(psz_name);
+}
+
+/* 16 hexadecimal digits separated from the rest of the name */
+static uint64_t
+parse_hash(const char *psz_norm)
+{
+    for (const char *p = psz_norm; *p;)
+    {
+        size_t len = strcspn(p, " ");
+        if (len == 16)
+        {
+            uint64_t hash = 0;
+            size_t i;
+            for (i = 0; i < 16; ++i)
+            {
+                char c = p[i];
+                int digit = c >= '0' && c <= '9' ? c - '0'
+                          : c >= 'a' && c <= 'f' ? c - 'a' + 10 : -1;
+                if (digit < 0)
+                    break;
+                hash = hash << 4 | digit;
+            }
+            if (i == 16 && hash != 0)
+                return hash;
+        }
+        p += len;
+        while (*p == ' ')
+            p++;
+    }
+    return 0;
+}
+
+static char *
+join_path(const char *psz_dir, const char *psz_name)
+{
+    size_t dir_len = strlen(psz_dir), name_len = strlen(psz_name);
+    char *psz_path = malloc(dir_len + 1 + name_len + 1);
+    if (psz_path)
+    {
+        memcpy(psz_path, psz_dir, dir_len);
+        psz_path[dir_len] = '/';
+        memcpy(psz_path + dir_len + 1, psz_name, name_len + 1);
+    }
+    return psz_path;
+}
+
+/* List the subtitles of a directory. Returns 0 on success, -1 on allocation
+ * failure. */
+static int
+subtitle_dir_Scan(subtitle_index *p_index, struct subtitle_dir *p_dir)
+{
+    DIR *p_d = opendir(p_dir->psz_path);
+    if (!p_d)
+        return 0;
+
+    size_t alloc = 0;
+    struct dirent *p_ent;
+    int ret = 0;
+    p_index->scans++;
+    while (ret == 0 && (p_ent = readdir(p_d)) != NULL)
+    {
+        const char *psz_name = p_ent->d_name;
+        if (psz_name[0] == '.')
+            continue;
+
+        if (p_ent->d_type == DT_DIR || p_ent->d_type == DT_UNKNOWN)
+        {
+            int subdir = strcasecmp(psz_name, "subs") == 0 ? 0
+                       : strcasecmp(psz_name, "subtitles") == 0 ? 1 : -1;
+            if (subdir >= 0 && !p_dir->ppsz_subdirs[subdir])
+            {
+                p_dir->ppsz_subdirs[subdir] = join_path(p_dir->psz_path,
+                                                        psz_name);
+                if (!p_dir->ppsz_subdirs[subdir])
+                    ret = -1;
+                continue;
+            }
+            if (p_ent->d_type == DT_DIR)
+                continue;
+        }
+        if (!(ext_set_Lookup(p_index->p_set, psz_name) & CATEGORY_SUBTITLE))
+            continue;
+
+        if (p_dir->count == alloc)
+        {
+            alloc = alloc ? alloc * 2 : 16;
+            struct subtitle_entry *p_entries =
+                realloc(p_dir->p_entries, alloc * sizeof(*p_entries));
+            if (!p_entries)
+            {
+                ret = -1;
+                break;
+            }
+            p_dir->p_entries = p_entries;
+        }
+        struct subtitle_entry *p_entry = &p_dir->p_entries[p_dir->count];
+        p_entry->psz_path = join_path(p_dir->psz_path, psz_name);
+        p_entry->psz_norm = normalize(psz_name, strip_extension(psz_name));
+        if (!p_entry->psz_path || !p_entry->psz_norm)
+        {
+            free(p_entry->psz_path);
+            free(p_entry->psz_norm);
+            ret = -1;
+            break;
+        }
+        p_entry->hash = parse_hash(p_entry->psz_norm);
+        p_dir->count++;
+    }
+    closedir(p_d);
+    return ret;
+}
+
+/* Get the cached listing of a directory, listing it again if it changed */
+static struct subtitle_dir *
+subtitle_index_GetDir(subtitle_index *p_index, const char *psz_path)
+{
+    struct stat st;
+    bool b_exists = stat(psz_path, &st) == 0 && S_ISDIR(st.st_mode);
+    struct subtitle_dir *p_dir = NULL;
+
+    for (size_t i = 0; i < p_index->dir_count && !p_dir; ++i)
+        if (strcmp(p_index->p_dirs[i].psz_path, psz_path) == 0)
+            p_dir = &p_index->p_dirs[i];
+
+    if (p_dir)
+    {
+        p_dir->last_use = ++p_index->clock;
+        if (p_dir->b_exists == b_exists
+         && (!b_exists || (p_dir->mtime.tv_sec == st.st_mtim.tv_sec
+                        && p_dir->mtime.tv_nsec == st.st_mtim.tv_nsec)))
+        {
+            p_index->cache_hits++;
+            return p_dir;
+        }
+        subtitle_dir_Clean(p_dir);
+    }
+    else if (p_index->dir_count < p_index->max_dirs)
+        p_dir = &p_index->p_dirs[p_index->dir_count++];
+    else
+    {
+        /* Evict the least recently used directory */
+        p_dir = &p_index->p_dirs[0];
+        for (size_t i = 1; i < p_index->dir_count; ++i)
+            if (p_index->p_dirs[i].last_use < p_dir->last_use)
+                p_dir = &p_index->p_dirs[i];
+        subtitle_dir_Clean(p_dir);
+    }
+
+    p_dir->psz_path = strdup(psz_path);
+    p_dir->last_use = ++p_index->clock;
+    p_dir->b_exists = b_exists;
+    if (b_exists)
+        p_dir->mtime = st.st_mtim;
+    /* On failure, the directory is listed again on the next lookup */
+    if (!p_dir->psz_path || (b_exists && subtitle_dir_Scan(p_index, p_dir) != 0))
+    {
+        subtitle_dir_Clean(p_dir);
+        *p_dir = p_index->p_dirs[--p_index->dir_count];
+        memset(&p_index->p_dirs[p_index->dir_count], 0, sizeof(*p_dir));
+        return NULL;
+    }
+    return p_dir;
+}
+
+struct match_list
+{
+    struct subtitle_match *p_matches;
+    int count;
+    int alloc;
+};
+
+static int
+match_list_Add(struct match_list *p_list, const char *psz_path,
+               unsigned priority)
+{
+    for (int i = 0; i < p_list->count; ++i)
+    {
+        if (strcmp(p_list->p_matches[i].psz_path, psz_path) == 0)
+        {
+            if (priority > p_list->p_matches[i].priority)
+                p_list->p_matches[i].priority = priority;
+            return 0;
+        }
+    }
+    if (p_list->count == p_list->alloc)
+    {
+        int alloc = p_list->alloc ? p_list->alloc * 2 : 4;
+        struct subtitle_match *p_matches =
+            realloc(p_list->p_matches, alloc * sizeof(*p_matches));
+        if (!p_matches)
+            return -1;
+        p_list->p_matches = p_matches;
+        p_list->alloc = alloc;
+    }
+    char *psz_dup = strdup(psz_path);
+    if (!psz_dup)
+        return -1;
+    p_list->p_matches[p_list->count].psz_path = psz_dup;
+    p_list->p_matches[p_list->count].priority = priority;
+    p_list->count++;
+    return 0;
+}
+
+static int
+match_cmp(const void *a, const void *b)
+{
+    const struct subtitle_match *p_a = a, *p_b = b;
+    if (p_a->priority != p_b->priority)
+        return p_a->priority < p_b->priority ? 1 : -1;
+    return strcmp(p_a->psz_path, p_b->psz_path);
+}
+
+struct video
+{
+    const char *psz_path;
+    const char *psz_norm;
+    size_t norm_len;
+    uint64_t hash;
+    bool b_hashed;
+};
+
+static int
+subtitle_dir_Match(subtitle_index *p_index, const struct subtitle_dir *p_dir,
+                   struct video *p_video, bool b_video_dir,
+                   struct match_list *p_list)
+{
+    /* Folders shared by all videos hold subtitles of several videos: a
+     * match is less likely to be the right one */
+    unsigned penalty = b_video_dir ? 0 : 1;
+
+    for (size_t i = 0; i < p_dir->count; ++i)
+    {
+        const struct subtitle_entry *p_entry = &p_dir->p_entries[i];
+        unsigned priority = 0;
+
+        if (p_video->norm_len > 0
+         && strncmp(p_entry->psz_norm, p_video->psz_norm,
+                    p_video->norm_len) == 0)
+        {
+            /* "name.srt", or "name.en.srt" but not "name2.srt" */
+            char next = p_entry->psz_norm[p_video->norm_len];
+            if (next == '\0')
+                priority = PRIORITY_EXACT;
+            else if (next == ' ')
+                priority = PRIORITY_PREFIX;
+        }
+        if (priority == 0 && p_entry->hash != 0)
+        {
+            /* Hash the video only if a subtitle may need it */
+            if (!p_video->b_hashed)
+            {
+                fingerprint fp;
+                p_video->b_hashed = true;
+                if (fingerprint_ComputePath(p_video->psz_path, 0, &fp) == 0)
+                    p_video->hash = fp.osdb_hash;
+                p_index->hashes++;
+            }
+            if (p_video->hash == p_entry->hash)
+                priority = PRIORITY_HASH;
+        }
+        if (priority > 0
+         && match_list_Add(p_list, p_entry->psz_path, priority - penalty) != 0)
+            return -1;
+    }
+    return 0;
+}
+
+int
+subtitle_index_Find(subtitle_index *p_index, const char *psz_video,
+                    struct subtitle_match **pp_matches)
+{
+    struct match_list list = { NULL, 0, 0 };
+    const char *psz_name = strrchr(psz_video, '/');
+    char *psz_dir = NULL, *psz_norm = NULL;
+    int ret = -1;
+
+    psz_dir = psz_name ? strndup(psz_video, psz_name > psz_video
+                                            ? (size_t)(psz_name - psz_video)
+                                            : 1)
+                       : strdup(".");
+    psz_name = psz_name ? psz_name + 1 : psz_video;
+    psz_norm = normalize(psz_name, strip_extension(psz_name));
+    if (!psz_dir || !psz_norm)
+        goto end;
+
+    struct video video = {
+        .psz_path = psz_video,
+        .psz_norm = psz_norm,
+        .norm_len = strlen(psz_norm),
+    };
+
+    pthread_mutex_lock(&p_index->lock);
+    p_index->lookups++;
+
+    ret = 0;
+    struct subtitle_dir *p_dir = subtitle_index_GetDir(p_index, psz_dir);
+    if (!p_dir)
+        ret = -1;
+    else
+    {
+        /* Copied: looking the sub directories up can evict p_dir */
+        char *ppsz_subdirs[2] = { NULL, NULL };
+        for (int i = 0; i < 2 && ret == 0; ++i)
+            if (p_dir->ppsz_subdirs[i]
+             && !(ppsz_subdirs[i] = strdup(p_dir->ppsz_subdirs[i])))
+                ret = -1;
+        if (ret == 0)
+            ret = subtitle_dir_Match(p_index, p_dir, &video, true, &list);
+        for (int i = 0; i < 2; ++i)
+        {
+            if (ret == 0 && ppsz_subdirs[i])
+            {
+                p_dir = subtitle_index_GetDir(p_index, ppsz_subdirs[i]);
+                ret = p_dir ? subtitle_dir_Match(p_index, p_dir, &video, true,
+                                                 &list) : -1;
+            }
+            free(ppsz_subdirs[i]);
+        }
+    }
+    for (size_t i = 0; ret == 0 && i < p_index->folder_count; ++i)
+    {
+        if (strcmp(p_index->ppsz_folders[i], psz_dir) == 0)
+            continue;
+        p_dir = subtitle_index_GetDir(p_index, p_index->ppsz_folders[i]);
+        ret = p_dir ? subtitle_dir_Match(p_index, p_dir, &video, false, &list)
+                    : -1;
+    }
+    pthread_mutex_unlock(&p_index->lock);
+
+end:
+    free(psz_dir);
+    free(psz_norm);
+    if (ret != 0)
+    {
+        subtitle_index_FreeMatches(list.p_matches, list.count);
+        return -1;
+    }
+    qsort(list.p_matches, list.count, sizeof(*list.p_matches), match_cmp);
+    *pp_matches = list.p_matches;
+    return list.count;
+}
+
+void
+subtitle_index_FreeMatches(struct subtitle_match *p_matches, int count)
+{
+    for (int i = 0; i < count; ++i)
+        free(p_matches[i].psz_path);
+    free(p_matches);
+}
+
+void
+subtitle_index_Invalidate(subtitle_index *p_index, const char *psz_dir)
+{
+    pthread_mutex_lock(&p_index->lock);
+    for (size_t i = p_index->dir_count; i-- > 0;)
+    {
+        if (psz_dir && strcmp(p_index->p_dirs[i].psz_path, psz_dir) != 0)
+            continue;
+        subtitle_dir_Clean(&p_index->p_dirs[i]);
+        p_index->p_dirs[i] = p_index->p_dirs[--p_index->dir_count];
+        memset(&p_index->p_dirs[p_index->dir_count], 0,
+               sizeof(*p_index->p_dirs));
+    }
+    pthread_mutex_unlock(&p_index->lock);
+}
+
+void
+subtitle_index_GetStats(subtitle_index *p_index, uint64_t p_stats[4])
+{
+    pthread_mutex_lock(&p_index->lock);
+    p_stats[0] = p_index->lookups;
+    p_stats[1] = p_index->scans;
+    p_stats[2] = p_index->cache_hits;
+    p_stats[3] = p_index->hashes;
+    pthread_mutex_unlock(&p_index->lock);
+}
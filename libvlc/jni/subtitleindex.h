@@ -0,0 +1,72 @@
+/*****************************************************************************
+ * subtitleindex.h
+ *****************************************************************************
+ * Copyright © 2023 VLC authors, VideoLAN and VideoLabs
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef SUBTITLEINDEX_H
+#define SUBTITLEINDEX_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "ext_set.h"
+
+/* Index of the subtitle files of local directories, to find the subtitles of
+ * a video without listing its directory on every play.
+ *
+ * Each directory is listed once and cached until its mtime changes. The
+ * directories searched for a video are its own directory, its "Subs" and
+ * "Subtitles" sub directories, and the folders added to the index.
+ *
+ * Thread-safe. */
+
+typedef struct subtitle_index subtitle_index;
+
+struct subtitle_match
+{
+    char *psz_path;
+    /* 0 (low) to 4 (high), like libvlc slaves */
+    unsigned priority;
+};
+
+/* Subtitles are the files of p_set with the subtitle category, the index
+ * takes ownership of the p_set reference on success. max_dirs is the number
+ * of directories kept in cache. */
+subtitle_index *subtitle_index_New(const ext_set *p_set, unsigned max_dirs);
+void subtitle_index_Delete(subtitle_index *p_index);
+
+/* Add a folder searched for all videos. Returns 0 on success, -1 on
+ * allocation failure. */
+int subtitle_index_AddFolder(subtitle_index *p_index, const char *psz_dir);
+
+/* Find the subtitles of a video, by normalized base name, or by the
+ * OpenSubtitles hash of the video in the subtitle name. Matches are sorted by
+ * decreasing priority. Returns the number of matches, -1 on allocation
+ * failure. */
+int subtitle_index_Find(subtitle_index *p_index, const char *psz_video,
+                        struct subtitle_match **pp_matches);
+void subtitle_index_FreeMatches(struct subtitle_match *p_matches, int count);
+
+/* Drop a directory from the cache, or all of them if psz_dir is NULL */
+void subtitle_index_Invalidate(subtitle_index *p_index, const char *psz_dir);
+
+/* Counters: lookups, directories listed, directories found in cache,
+ * videos hashed */
+void subtitle_index_GetStats(subtitle_index *p_index, uint64_t p_stats[4]);
+
+#endif // SUBTITLEINDEX_H
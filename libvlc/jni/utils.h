@@ -21,6 +21,8 @@
 #ifndef LIBVLCJNI_UTILS_H
 #define LIBVLCJNI_UTILS_H
 
+#include <stdbool.h>
+
 #include <vlc/vlc.h>
 #include <vlc/libvlc_media.h>
 #include <vlc/libvlc_media_list.h>
@@ -28,6 +30,7 @@
 #define LOG_TAG "VLC/JNI/VLCObject"
 #include "log.h"
 
+#define ARRAY_SIZE(x) (sizeof(x) / sizeof((x)[0]))
 
 struct fields {
 #define CLAZZ(name, fullname) jclass name##_clazz;
@@ -39,10 +42,8 @@ struct fields {
 #undef METHOD
 };
 
-static inline jstring vlcNewStringUTF(JNIEnv* env, const char* psz_string)
+static inline bool vlcIsValidUTF(const char* psz_string)
 {
-    if (psz_string == NULL)
-        return NULL;
     for (int i = 0 ; psz_string[i] != '\0' ; ) {
         uint8_t lead = psz_string[i++];
         uint8_t nbBytes;
@@ -56,16 +57,23 @@ static inline jstring vlcNewStringUTF(JNIEnv* env, const char* psz_string)
             nbBytes = 3;
         else {
             LOGE("Invalid UTF lead character\n");
-            return NULL;
+            return false;
         }
         for (int j = 0 ; j < nbBytes && psz_string[i] != '\0' ; j++) {
             uint8_t byte = psz_string[i++];
             if ((byte & 0x80) == 0) {
                 LOGE("Invalid UTF byte\n");
-                return NULL;
+                return false;
             }
         }
     }
+    return true;
+}
+
+static inline jstring vlcNewStringUTF(JNIEnv* env, const char* psz_string)
+{
+    if (psz_string == NULL || !vlcIsValidUTF(psz_string))
+        return NULL;
     return (*env)->NewStringUTF(env, psz_string);
 }
 
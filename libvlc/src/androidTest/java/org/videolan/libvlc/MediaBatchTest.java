@@ -0,0 +1,124 @@
+package org.videolan.libvlc;
+
+import static org.junit.Assert.*;
+
+import android.content.Context;
+import android.net.Uri;
+import android.util.Log;
+
+import androidx.test.ext.junit.runners.AndroidJUnit4;
+import androidx.test.platform.app.InstrumentationRegistry;
+
+import org.junit.After;
+import org.junit.Before;
+import org.junit.Test;
+import org.junit.runner.RunWith;
+
+@RunWith(AndroidJUnit4.class)
+public class MediaBatchTest {
+    private static final String TAG = "MediaBatchTest";
+    private static final int COUNT = 10000;
+
+    private LibVLC mLibVLC;
+    private String[] mPaths;
+
+    @Before
+    public void setUp() {
+        Context appContext = InstrumentationRegistry.getInstrumentation().getTargetContext();
+        mLibVLC = new LibVLC(appContext);
+        mPaths = new String[COUNT];
+        for (int i = 0; i < COUNT; ++i)
+            mPaths[i] = "/sdcard/Music/album " + (i / 20) + "/track " + i + ".mp3";
+    }
+
+    @After
+    public void tearDown() {
+        if (!mLibVLC.isReleased())
+            mLibVLC.release();
+    }
+
+    @Test
+    public void handlesMatchInput() {
+        final MediaBatch batch = MediaBatch.fromPaths(mLibVLC, mPaths);
+        assertEquals(mPaths.length, batch.size());
+        for (int i = 0; i < COUNT; ++i) {
+            assertFalse(batch.isInvalid(i));
+            final String mrl = batch.getMrl(i);
+            assertNotNull(mrl);
+            assertEquals(mPaths[i], Uri.parse(mrl).getPath());
+        }
+        batch.release();
+    }
+
+    @Test
+    public void invalidEntries() {
+        final Uri[] uris = new Uri[] {
+                Uri.parse("file:///sdcard/Music/first.mp3"),
+                null,
+                Uri.parse("file:///sdcard/Music/third.mp3"),
+                null,
+        };
+        final MediaBatch batch = MediaBatch.fromUris(mLibVLC, uris);
+        assertEquals(uris.length, batch.size());
+        for (int i = 0; i < uris.length; ++i) {
+            if (uris[i] == null) {
+                assertTrue(batch.isInvalid(i));
+                assertNull(batch.getMrl(i));
+                assertNull(batch.getMedia(i));
+            } else {
+                assertFalse(batch.isInvalid(i));
+                assertEquals(uris[i].getPath(), Uri.parse(batch.getMrl(i)).getPath());
+            }
+        }
+        batch.release();
+    }
+
+    @Test
+    public void failedBatchReleasesLibVLC() {
+        try {
+            MediaBatch.fromPaths(mLibVLC, null);
+            fail("a null array must be rejected");
+        } catch (IllegalArgumentException expected) {
+        }
+        /* the reference taken by the failed batch was given back */
+        mLibVLC.release();
+        assertTrue(mLibVLC.isReleased());
+    }
+
+    @Test
+    public void promote() {
+        final MediaBatch batch = MediaBatch.fromPaths(mLibVLC, mPaths);
+        assertEquals(COUNT, batch.size());
+
+        final Media media = batch.getMedia(42);
+        assertNotNull(media);
+        assertTrue(batch.getMrl(42).startsWith("file://"));
+        assertNotNull(media.getUri());
+        batch.release();
+
+        /* The promoted Media outlives the batch */
+        assertFalse(media.isReleased());
+        assertNotNull(media.getUri());
+        media.release();
+    }
+
+    @Test
+    public void benchmark() {
+        long start = System.nanoTime();
+        final Media[] medias = new Media[COUNT];
+        for (int i = 0; i < COUNT; ++i)
+            medias[i] = new Media(mLibVLC, mPaths[i]);
+        final long loopNs = System.nanoTime() - start;
+        for (Media media : medias)
+            media.release();
+
+        start = System.nanoTime();
+        final MediaBatch batch = MediaBatch.fromPaths(mLibVLC, mPaths);
+        final long batchNs = System.nanoTime() - start;
+        assertEquals(COUNT, batch.size());
+        batch.release();
+
+        Log.i(TAG, "created " + COUNT + " medias: loop " + loopNs / 1000000 + "ms, batch "
+                + batchNs / 1000000 + "ms");
+    }
+}
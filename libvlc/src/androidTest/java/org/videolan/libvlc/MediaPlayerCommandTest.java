@@ -0,0 +1,126 @@
+package org.videolan.libvlc;
+
+import static org.junit.Assert.*;
+
+import android.content.Context;
+import android.net.Uri;
+
+import androidx.test.ext.junit.runners.AndroidJUnit4;
+import androidx.test.platform.app.InstrumentationRegistry;
+
+import org.junit.After;
+import org.junit.Before;
+import org.junit.Test;
+import org.junit.runner.RunWith;
+
+import java.io.IOException;
+import java.net.InetAddress;
+import java.net.ServerSocket;
+import java.net.Socket;
+import java.util.ArrayList;
+import java.util.Arrays;
+import java.util.List;
+import java.util.concurrent.TimeUnit;
+
+@RunWith(AndroidJUnit4.class)
+public class MediaPlayerCommandTest {
+    private static final long RELEASE_TIMEOUT_MS = 5000;
+
+    private LibVLC mLibVLC;
+    /* Accepts connections and never answers, like a stalled network share */
+    private ServerSocket mStalledServer;
+    private final List<Socket> mClients = new ArrayList<>();
+    private Thread mAcceptThread;
+
+    @Before
+    public void setUp() throws IOException {
+        Context appContext = InstrumentationRegistry.getInstrumentation().getTargetContext();
+        mLibVLC = new LibVLC(appContext, new ArrayList<>(Arrays.asList(
+                "--aout=adummy", "--vout=vdummy")));
+
+        mStalledServer = new ServerSocket(0, 4, InetAddress.getByName("127.0.0.1"));
+        mAcceptThread = new Thread(new Runnable() {
+            @Override
+            public void run() {
+                try {
+                    while (true) {
+                        final Socket client = mStalledServer.accept();
+                        synchronized (mClients) {
+                            mClients.add(client);
+                        }
+                    }
+                } catch (IOException ignored) {}
+            }
+        });
+        mAcceptThread.start();
+    }
+
+    @After
+    public void tearDown() throws Exception {
+        mStalledServer.close();
+        mAcceptThread.join();
+        synchronized (mClients) {
+            for (Socket client : mClients)
+                client.close();
+        }
+        mLibVLC.release();
+    }
+
+    private MediaPlayer newStalledPlayer() {
+        final MediaPlayer player = new MediaPlayer(mLibVLC);
+        final Media media = new Media(mLibVLC,
+                Uri.parse("http://127.0.0.1:" + mStalledServer.getLocalPort() + "/stalled.mkv"));
+        player.setMediaAsync(media);
+        media.release();
+        player.playAsync();
+        return player;
+    }
+
+    /* release() must not wait for a queued stop to complete */
+    private static void releaseInTime(final MediaPlayer player) throws InterruptedException {
+        final Thread thread = new Thread(new Runnable() {
+            @Override
+            public void run() {
+                player.release();
+            }
+        });
+        thread.start();
+        thread.join(RELEASE_TIMEOUT_MS);
+        assertFalse("release() is blocked", thread.isAlive());
+    }
+
+    @Test
+    public void stopAsyncThenRelease() throws Exception {
+        final MediaPlayer player = newStalledPlayer();
+        final MediaPlayer.CommandFuture stop = player.stopAsync();
+        releaseInTime(player);
+
+        final int status = stop.get(RELEASE_TIMEOUT_MS, TimeUnit.MILLISECONDS);
+        assertTrue(status == MediaPlayer.CommandStatus.Done
+                || status == MediaPlayer.CommandStatus.Cancelled);
+    }
+
+    @Test
+    public void scrubStopThenRelease() throws Exception {
+        final MediaPlayer player = newStalledPlayer();
+        player.startScrubbing();
+        for (long time = 0; time < 10000; time += 500)
+            player.scrubTo(time);
+        final MediaPlayer.CommandFuture seek = player.stopScrubbing(true);
+        player.stopAsync();
+        releaseInTime(player);
+
+        seek.get(RELEASE_TIMEOUT_MS, TimeUnit.MILLISECONDS);
+        assertTrue(seek.isDone());
+    }
+
+    @Test
+    public void cancelAfterRelease() throws Exception {
+        final MediaPlayer player = newStalledPlayer();
+        final MediaPlayer.CommandFuture stop = player.stopAsync();
+        releaseInTime(player);
+
+        assertFalse(stop.cancel(false));
+        assertTrue(stop.isDone());
+    }
+}
@@ -0,0 +1,409 @@
+package org.videolan.libvlc;
+
+import static org.junit.Assert.*;
+import static org.junit.Assume.assumeTrue;
+
+import android.net.Uri;
+import android.os.Bundle;
+import android.util.Log;
+
+import androidx.test.ext.junit.runners.AndroidJUnit4;
+import androidx.test.platform.app.InstrumentationRegistry;
+
+import org.junit.After;
+import org.junit.Before;
+import org.junit.Test;
+import org.junit.runner.RunWith;
+import org.videolan.libvlc.interfaces.IMedia;
+
+import java.io.BufferedReader;
+import java.io.File;
+import java.io.IOException;
+import java.io.InputStreamReader;
+import java.io.OutputStream;
+import java.io.RandomAccessFile;
+import java.net.InetAddress;
+import java.net.ServerSocket;
+import java.net.Socket;
+import java.nio.charset.Charset;
+import java.util.ArrayList;
+import java.util.Arrays;
+import java.util.List;
+import java.util.Locale;
+import java.util.Map;
+import java.util.TreeMap;
+import java.util.concurrent.CountDownLatch;
+import java.util.concurrent.TimeUnit;
+
+/**
+ * Measure the start-up latencies of the medias of a corpus, from play() to the
+ * Opening, Buffering 100%, Playing, first Vout and first TimeChanged events,
+ * with dummy audio and video outputs.
+ *
+ * Instrumentation arguments:
+ * - corpus: directory or comma separated files, the test is skipped if missing
+ * - iterations: number of runs per media and per access (default 3)
+ * - http: "true" to also play the medias from a local HTTP server
+ * - timeout: maximum time in milliseconds per run (default 15000)
+ * - options: extra libvlc options, separated by spaces
+ *
+ * Percentiles are logged and reported as instrumentation status, per
+ * access, container and video (or audio) codec.
+ */
+@RunWith(AndroidJUnit4.class)
+public class TimeToFirstFrameBenchmark {
+    private static final String TAG = "TimeToFirstFrame";
+
+    private static final String[] MILESTONES = {
+            "opening", "buffered", "playing", "vout", "time"
+    };
+    private static final int OPENING = 0;
+    private static final int BUFFERED = 1;
+    private static final int PLAYING = 2;
+    private static final int VOUT = 3;
+    private static final int TIME = 4;
+
+    private LibVLC mLibVLC;
+    private List<File> mCorpus;
+    private int mIterations;
+    private boolean mHttp;
+    private long mTimeout;
+    private HttpServer mServer;
+
+    /* Latencies in microseconds by group, then by milestone */
+    private final Map<String, List<long[]>> mResults = new TreeMap<>();
+
+    private static class Run {
+        final long[] times = new long[MILESTONES.length];
+        final CountDownLatch done = new CountDownLatch(1);
+        boolean failed = false;
+
+        Run() {
+            Arrays.fill(times, -1);
+        }
+    }
+
+    @Before
+    public void setUp() throws IOException {
+        final Bundle args = InstrumentationRegistry.getArguments();
+        mCorpus = listCorpus(args.getString("corpus"));
+        assumeTrue("no corpus", !mCorpus.isEmpty());
+        mIterations = Integer.parseInt(args.getString("iterations", "3"));
+        mHttp = Boolean.parseBoolean(args.getString("http", "false"));
+        mTimeout = Long.parseLong(args.getString("timeout", "15000"));
+
+        final ArrayList<String> options = new ArrayList<>();
+        options.add("--aout=adummy");
+        options.add("--vout=vdummy");
+        options.add("--no-sub-autodetect-file");
+        final String extra = args.getString("options");
+        if (extra != null && !extra.trim().isEmpty())
+            options.addAll(Arrays.asList(extra.trim().split("\\s+")));
+        mLibVLC = new LibVLC(InstrumentationRegistry.getInstrumentation().getTargetContext(),
+                options);
+
+        if (mHttp)
+            mServer = new HttpServer(mCorpus);
+    }
+
+    @After
+    public void tearDown() throws IOException {
+        if (mServer != null)
+            mServer.close();
+        if (mLibVLC != null)
+            mLibVLC.release();
+    }
+
+    private static List<File> listCorpus(String corpus) {
+        final ArrayList<File> files = new ArrayList<>();
+        if (corpus == null)
+            return files;
+        for (String path : corpus.split(",")) {
+            final File file = new File(path.trim());
+            if (file.isDirectory()) {
+                final File[] children = file.listFiles();
+                if (children == null)
+                    continue;
+                Arrays.sort(children);
+                for (File child : children) {
+                    if (child.isFile() && !child.isHidden())
+                        files.add(child);
+                }
+            } else if (file.isFile())
+                files.add(file);
+        }
+        return files;
+    }
+
+    @Test
+    public void benchmark() throws InterruptedException {
+        int failures = 0;
+        for (int i = 0; i < mCorpus.size(); ++i) {
+            final File file = mCorpus.get(i);
+            for (int n = 0; n < mIterations; ++n) {
+                if (!measure("file", file, Uri.fromFile(file)))
+                    failures++;
+                if (mServer != null && !measure("http", file, mServer.getUri(i)))
+                    failures++;
+            }
+        }
+        report();
+        if (failures > 0)
+            Log.w(TAG, failures + " runs failed or timed out");
+        assertFalse("no run completed", mResults.isEmpty());
+    }
+
+    private boolean measure(String access, File file, Uri uri) throws InterruptedException {
+        final Run run = new Run();
+        final MediaPlayer player = new MediaPlayer(mLibVLC);
+        final long start = System.nanoTime();
+
+        player.setEventListener(new MediaPlayer.EventListener() {
+            @Override
+            public void onEvent(MediaPlayer.Event event) {
+                final long now = (System.nanoTime() - start) / 1000;
+                switch (event.type) {
+                    case MediaPlayer.Event.Opening:
+                        mark(run, OPENING, now);
+                        break;
+                    case MediaPlayer.Event.Buffering:
+                        if (event.getBuffering() >= 100.f)
+                            mark(run, BUFFERED, now);
+                        break;
+                    case MediaPlayer.Event.Playing:
+                        mark(run, PLAYING, now);
+                        break;
+                    case MediaPlayer.Event.Vout:
+                        if (event.getVoutCount() > 0)
+                            mark(run, VOUT, now);
+                        break;
+                    case MediaPlayer.Event.TimeChanged:
+                        mark(run, TIME, now);
+                        run.done.countDown();
+                        break;
+                    case MediaPlayer.Event.EncounteredError:
+                    case MediaPlayer.Event.EndReached:
+                    case MediaPlayer.Event.Stopped:
+                        run.failed = run.times[TIME] < 0;
+                        run.done.countDown();
+                        break;
+                }
+            }
+        });
+
+        final Media media = new Media(mLibVLC, uri);
+        player.setMedia(media);
+        media.release();
+        player.play();
+        final boolean completed = run.done.await(mTimeout, TimeUnit.MILLISECONDS);
+
+        final String codec = getCodec(player);
+        player.setEventListener(null);
+        player.stop();
+        player.release();
+
+        if (!completed || run.failed) {
+            Log.w(TAG, access + " " + file + ": " + (completed ? "failed" : "timed out"));
+            return false;
+        }
+        final String group = access + " " + getContainer(file) + " " + codec;
+        List<long[]> runs = mResults.get(group);
+        if (runs == null) {
+            runs = new ArrayList<>();
+            mResults.put(group, runs);
+        }
+        runs.add(run.times);
+        return true;
+    }
+
+    private static void mark(Run run, int milestone, long time) {
+        if (run.times[milestone] < 0)
+            run.times[milestone] = time;
+    }
+
+    private static String getContainer(File file) {
+        final String name = file.getName();
+        final int dot = name.lastIndexOf('.');
+        return dot < 0 ? "?" : name.substring(dot + 1).toLowerCase(Locale.US);
+    }
+
+    private static String getCodec(MediaPlayer player) {
+        IMedia.Track track = player.getSelectedTrack(IMedia.Track.Type.Video);
+        if (track == null)
+            track = player.getSelectedTrack(IMedia.Track.Type.Audio);
+        return track != null && track.codec != null ? track.codec.trim() : "?";
+    }
+
+    /* Nearest-rank percentile of the runs that reached the milestone */
+    private static long percentile(long[] sorted, int count, int p) {
+        if (count == 0)
+            return -1;
+        final int rank = (int) Math.ceil(p / 100.0 * count);
+        return sorted[Math.max(rank, 1) - 1];
+    }
+
+    private void report() {
+        final Bundle status = new Bundle();
+        for (Map.Entry<String, List<long[]>> entry : mResults.entrySet()) {
+            final List<long[]> runs = entry.getValue();
+            final StringBuilder line = new StringBuilder(entry.getKey())
+                    .append(" (").append(runs.size()).append(" runs)");
+            for (int m = 0; m < MILESTONES.length; ++m) {
+                final long[] values = new long[runs.size()];
+                int count = 0;
+                for (long[] times : runs) {
+                    if (times[m] >= 0)
+                        values[count++] = times[m];
+                }
+                Arrays.sort(values, 0, count);
+                final long p50 = percentile(values, count, 50);
+                final long p90 = percentile(values, count, 90);
+                final long p99 = percentile(values, count, 99);
+                line.append(String.format(Locale.US, " %s p50/p90/p99 %.1f/%.1f/%.1fms",
+                        MILESTONES[m], p50 / 1000.0, p90 / 1000.0, p99 / 1000.0));
+
+                final String key = entry.getKey().replace(' ', '_') + "_" + MILESTONES[m];
+                status.putLong(key + "_p50_us", p50);
+                status.putLong(key + "_p90_us", p90);
+                status.putLong(key + "_p99_us", p99);
+            }
+            Log.i(TAG, line.toString());
+        }
+        InstrumentationRegistry.getInstrumentation().sendStatus(0, status);
+    }
+
+    /**
+     * Minimal HTTP/1.1 server serving the corpus files at /<index>, with byte
+     * ranges, as a stand-in for network shares and servers.
+     */
+    private static class HttpServer implements Runnable {
+        private final List<File> mFiles;
+        private final ServerSocket mSocket;
+        private final Thread mThread;
+
+        HttpServer(List<File> files) throws IOException {
+            mFiles = files;
+            mSocket = new ServerSocket(0, 16, InetAddress.getByName("127.0.0.1"));
+            mThread = new Thread(this, "vlc-benchmark-http");
+            mThread.start();
+        }
+
+        Uri getUri(int index) {
+            return Uri.parse("http://127.0.0.1:" + mSocket.getLocalPort() + "/" + index);
+        }
+
+        void close() throws IOException {
+            mSocket.close();
+            try {
+                mThread.join();
+            } catch (InterruptedException ignored) {}
+        }
+
+        @Override
+        public void run() {
+            while (!mSocket.isClosed()) {
+                final Socket client;
+                try {
+                    client = mSocket.accept();
+                } catch (IOException e) {
+                    return;
+                }
+                new Thread(new Runnable() {
+                    @Override
+                    public void run() {
+                        try {
+                            serve(client);
+                        } catch (IOException ignored) {
+                        } finally {
+                            try {
+                                client.close();
+                            } catch (IOException ignored) {}
+                        }
+                    }
+                }, "vlc-benchmark-http-client").start();
+            }
+        }
+
+        private void serve(Socket client) throws IOException {
+            final Charset ascii = Charset.forName("US-ASCII");
+            final BufferedReader reader =
+                    new BufferedReader(new InputStreamReader(client.getInputStream(), ascii));
+            final OutputStream out = client.getOutputStream();
+
+            String request;
+            while ((request = reader.readLine()) != null && !request.isEmpty()) {
+                String range = null;
+                String header;
+                while ((header = reader.readLine()) != null && !header.isEmpty()) {
+                    if (header.toLowerCase(Locale.US).startsWith("range:"))
+                        range = header.substring(6).trim();
+                }
+
+                final String[] parts = request.split(" ");
+                File file = null;
+                try {
+                    final int index = Integer.parseInt(parts[1].substring(1));
+                    if (index >= 0 && index < mFiles.size())
+                        file = mFiles.get(index);
+                } catch (RuntimeException ignored) {}
+                if (file == null) {
+                    out.write("HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\n\r\n".getBytes(ascii));
+                    continue;
+                }
+
+                final long length = file.length();
+                long first = 0, last = length - 1;
+                boolean partial = false;
+                if (range != null && range.startsWith("bytes=")) {
+                    final String[] bounds = range.substring(6).split("-", -1);
+                    try {
+                        if (!bounds[0].isEmpty())
+                            first = Long.parseLong(bounds[0]);
+                        else
+                            first = length - Long.parseLong(bounds[1]);
+                        if (!bounds[0].isEmpty() && !bounds[1].isEmpty())
+                            last = Math.min(Long.parseLong(bounds[1]), length - 1);
+                        partial = true;
+                    } catch (NumberFormatException ignored) {}
+                }
+                if (first < 0 || first > last) {
+                    out.write(("HTTP/1.1 416 Range Not Satisfiable\r\nContent-Range: bytes */"
+                            + length + "\r\nContent-Length: 0\r\n\r\n").getBytes(ascii));
+                    continue;
+                }
+
+                final StringBuilder response = new StringBuilder(partial
+                        ? "HTTP/1.1 206 Partial Content\r\n" : "HTTP/1.1 200 OK\r\n")
+                        .append("Accept-Ranges: bytes\r\n")
+                        .append("Content-Type: application/octet-stream\r\n")
+                        .append("Content-Length: ").append(last - first + 1).append("\r\n");
+                if (partial)
+                    response.append("Content-Range: bytes ").append(first).append('-')
+                            .append(last).append('/').append(length).append("\r\n");
+                response.append("\r\n");
+                out.write(response.toString().getBytes(ascii));
+                if (!"HEAD".equals(parts[0]))
+                    send(file, first, last - first + 1, out);
+                out.flush();
+            }
+        }
+
+        private static void send(File file, long offset, long count, OutputStream out)
+                throws IOException {
+            final RandomAccessFile raf = new RandomAccessFile(file, "r");
+            try {
+                final byte[] buffer = new byte[64 * 1024];
+                raf.seek(offset);
+                while (count > 0) {
+                    final int read = raf.read(buffer, 0, (int) Math.min(buffer.length, count));
+                    if (read < 0)
+                        break;
+                    out.write(buffer, 0, read);
+                    count -= read;
+                }
+            } finally {
+                raf.close();
+            }
+        }
+    }
+}
@@ -35,6 +35,7 @@ public class LibVLC extends VLCObject<ILibVLC.Event> implements ILibVLC {
     private static final String TAG = "VLC/LibVLC";
 
     final Context mAppContext;
+    private final MediaIdentityMap mMediaIdentityMap = new MediaIdentityMap();
 
     public static class Event extends AbstractVLCEvent {
         protected Event(int type) {
@@ -105,6 +106,14 @@ public class LibVLC extends VLCObject<ILibVLC.Event> implements ILibVLC {
         nativeRelease();
     }
 
+    /**
+     * Get the map sharing Media wrappers between the MediaList of this LibVLC,
+     * and its lookup statistics
+     */
+    public MediaIdentityMap getMediaIdentityMap() {
+        return mMediaIdentityMap;
+    }
+
     /**
      * Sets the application name. LibVLC passes this as the user agent string
      * when a protocol requires it.
@@ -22,6 +22,7 @@ package org.videolan.libvlc;
 
 import android.content.res.AssetFileDescriptor;
 import android.net.Uri;
+import android.util.Log;
 
 import androidx.annotation.Nullable;
 
@@ -32,6 +33,9 @@ import org.videolan.libvlc.util.AndroidUtil;
 import org.videolan.libvlc.util.VLCUtil;
 
 import java.io.FileDescriptor;
+import java.io.IOException;
+import java.nio.ByteBuffer;
+import java.util.ArrayList;
 
 @SuppressWarnings("unused, JniMissingFunction")
 public class Media extends VLCObject<IMedia.Event> implements IMedia {
@@ -100,6 +104,15 @@ public class Media extends VLCObject<IMedia.Event> implements IMedia {
                          sentPackets, sentBytes, sendBitrate);
     }
 
+    @SuppressWarnings("unused") /* Used from JNI */
+    private static ProbeResult createProbeResultFromNative(int status, long duration, int type,
+                                                           int audioTracks, int videoTracks,
+                                                           int subtitleTracks, long bytesRead,
+                                                           long elapsedTime) {
+        return new ProbeResult(status, duration, type, audioTracks, videoTracks,
+                               subtitleTracks, bytesRead, elapsedTime);
+    }
+
     private static final int PARSE_STATUS_INIT = 0x00;
     private static final int PARSE_STATUS_PARSING = 0x01;
     private static final int PARSE_STATUS_PARSED = 0x02;
@@ -113,6 +126,18 @@ public class Media extends VLCObject<IMedia.Event> implements IMedia {
     private boolean mCodecOptionSet = false;
     private boolean mFileCachingSet = false;
     private boolean mNetworkCachingSet = false;
+    private SourceFeeder mSourceFeeder = null;
+
+    private static final int DEFAULT_SOURCE_RING_SIZE = 1024 * 1024;
+    private static final int SOURCE_CHUNK_SIZE = 64 * 1024;
+    /* Keep in sync with libvlcjni-media.c */
+    private static final long SOURCE_REQUEST_FILL = -1;
+    private static final long SOURCE_REQUEST_CLOSED = -2;
+    private static final int SOURCE_WRITE_EOF = -1;
+    private static final int SOURCE_WRITE_ERROR = -2;
+    private static final long SOURCE_FEEDER_JOIN_TIMEOUT_MS = 1000;
+    private static final long SOURCE_RETRY_MIN_DELAY_MS = 1;
+    private static final long SOURCE_RETRY_MAX_DELAY_MS = 100;
 
 
     /**
@@ -165,6 +190,186 @@ public class Media extends VLCObject<IMedia.Event> implements IMedia {
         mUri = VLCUtil.UriFromMrl(nativeGetMrl());
     }
 
+    /**
+     * Create a Media from libVLC and a direct ByteBuffer
+     *
+     * The bytes between the buffer position and its limit are read in place, without any copy.
+     * The content of the buffer must not be modified while the Media is alive.
+     *
+     * @param ILibVLC a valid LibVLC
+     * @param buffer a direct ByteBuffer, see {@link ByteBuffer#allocateDirect(int)}
+     */
+    public Media(ILibVLC ILibVLC, ByteBuffer buffer) {
+        super(ILibVLC);
+        if (buffer == null || !buffer.isDirect())
+            throw new IllegalArgumentException("buffer is null or not direct");
+        nativeNewFromByteBuffer(ILibVLC, buffer, buffer.position(), buffer.remaining());
+        mUri = VLCUtil.UriFromMrl(nativeGetMrl());
+    }
+
+    /**
+     * Create a Media from libVLC and a {@link DataSource}
+     *
+     * A feeder thread reads the source ahead into a native ring buffer of
+     * ringSize bytes, so that a slow source does not block the libvlc input
+     * thread from the JVM. Only one player can read the Media at a time.
+     *
+     * @param ILibVLC a valid LibVLC
+     * @param source the source of the stream
+     * @param ringSize size in bytes of the native ring buffer
+     */
+    public Media(ILibVLC ILibVLC, DataSource source, int ringSize) {
+        super(ILibVLC);
+        if (source == null)
+            throw new IllegalArgumentException("source is null");
+        nativeNewFromDataSource(ILibVLC, source.size(), ringSize);
+        mUri = VLCUtil.UriFromMrl(nativeGetMrl());
+        mSourceFeeder = new SourceFeeder(source, nativeSourceAcquire(),
+                Math.min(ringSize, SOURCE_CHUNK_SIZE));
+        mSourceFeeder.start();
+    }
+
+    public Media(ILibVLC ILibVLC, DataSource source) {
+        this(ILibVLC, source, DEFAULT_SOURCE_RING_SIZE);
+    }
+
+    /**
+     * Create a Media from a handle of a {@link MediaBatch}
+     *
+     * @param mrl mrl of the handle, or null to query it
+     */
+    Media(ILibVLC ILibVLC, long handle, String mrl) {
+        super(ILibVLC);
+        nativeNewFromHandle(ILibVLC, handle);
+        mUri = VLCUtil.UriFromMrl(mrl != null ? mrl : nativeGetMrl());
+    }
+
+    /**
+     * Builds a Media with its options, slaves and parse request in a single native call
+     */
+    public static class Builder {
+        private final ILibVLC mILibVLC;
+        private String mLocation = null;
+        private Uri mUri = null;
+        private boolean mIsPath = false;
+        private final ArrayList<String> mOptions = new ArrayList<>();
+        private final ArrayList<Slave> mSlaves = new ArrayList<>();
+        private boolean mDefaultMediaPlayerOptions = false;
+        private int mParseFlags = -1;
+        private int mParseTimeout = -1;
+
+        public Builder(ILibVLC ILibVLC) {
+            mILibVLC = ILibVLC;
+        }
+
+        /**
+         * @param path an absolute local path
+         */
+        public Builder setPath(String path) {
+            mLocation = path;
+            mUri = null;
+            mIsPath = true;
+            return this;
+        }
+
+        /**
+         * @param uri a valid RFC 2396 Uri
+         */
+        public Builder setUri(Uri uri) {
+            mLocation = VLCUtil.encodeVLCUri(uri);
+            mUri = uri;
+            mIsPath = false;
+            return this;
+        }
+
+        /**
+         * @see Media#addOption(String)
+         */
+        public Builder addOption(String option) {
+            mOptions.add(option);
+            return this;
+        }
+
+        /**
+         * @see Media#addSlave(Slave)
+         */
+        public Builder addSlave(Slave slave) {
+            mSlaves.add(slave);
+            return this;
+        }
+
+        /**
+         * @see Media#setHWDecoderEnabled(boolean, boolean)
+         */
+        public Builder setHWDecoderEnabled(boolean enabled, boolean force) {
+            if (!enabled) /* LibVLC >= 4.0 */
+                mOptions.add(":no-hw-dec");
+            return this;
+        }
+
+        /**
+         * @see Media#setDefaultMediaPlayerOptions()
+         */
+        public Builder setDefaultMediaPlayerOptions() {
+            mDefaultMediaPlayerOptions = true;
+            return this;
+        }
+
+        /**
+         * Parse the media asynchronously once created
+         *
+         * @see Media#parseAsync(int, int)
+         */
+        public Builder parseAsync(int flags, int timeout) {
+            mParseFlags = flags;
+            mParseTimeout = timeout;
+            return this;
+        }
+
+        public Media build() {
+            if (mLocation == null)
+                throw new IllegalStateException("no path or uri set");
+            return new Media(this);
+        }
+    }
+
+    private Media(Builder builder) {
+        super(builder.mILibVLC);
+        if (builder.mDefaultMediaPlayerOptions) {
+            /* The codec option is only tracked for LibVLC 3, see setDefaultMediaPlayerOptions */
+            if (LibVLC.majorVersion() == 3)
+                mCodecOptionSet = true;
+            final String option = getDefaultMediaPlayerOption(builder.mUri);
+            if (option != null)
+                builder.mOptions.add(option);
+        }
+        for (String option : builder.mOptions)
+            trackOption(option);
+
+        final int slaveCount = builder.mSlaves.size();
+        final int[] slaveInfos = new int[slaveCount * 2];
+        final String[] slaveUris = new String[slaveCount];
+        for (int i = 0; i < slaveCount; ++i) {
+            final Slave slave = builder.mSlaves.get(i);
+            slaveInfos[2 * i] = slave.type;
+            slaveInfos[2 * i + 1] = slave.priority;
+            slaveUris[i] = slave.uri;
+        }
+
+        final boolean[] parsing = new boolean[1];
+        if (builder.mParseFlags >= 0)
+            mParseStatus |= PARSE_STATUS_PARSING;
+        final String mrl = nativeNewFromBuilder(builder.mILibVLC, builder.mLocation,
+                builder.mIsPath, builder.mOptions.toArray(new String[0]), slaveInfos,
+                slaveUris, builder.mParseFlags, builder.mParseTimeout, parsing);
+        if (!parsing[0]) {
+            synchronized (this) {
+                mParseStatus &= ~PARSE_STATUS_PARSING;
+            }
+        }
+        mUri = builder.mUri != null ? builder.mUri : VLCUtil.UriFromMrl(mrl);
+    }
+
     /**
      *
      * @param ml Should not be released and locked
@@ -264,14 +469,14 @@ public class Media extends VLCObject<IMedia.Event> implements IMedia {
      * @return true in case of success, false otherwise.
      */
     public boolean parse(int flags) {
-        boolean parse = false;
         synchronized (this) {
-            if ((mParseStatus & (PARSE_STATUS_PARSED | PARSE_STATUS_PARSING)) == 0) {
-                mParseStatus |= PARSE_STATUS_PARSING;
-                parse = true;
-            }
+            if ((mParseStatus & PARSE_STATUS_PARSED) != 0)
+                return false;
+            mParseStatus |= PARSE_STATUS_PARSING;
         }
-        if (parse && nativeParse(flags)) {
+        /* If a parsing is already in progress, from any thread, the native
+         * side waits for it instead of starting a new one */
+        if (nativeParse(flags)) {
             postParse();
             return true;
         } else
@@ -300,14 +505,13 @@ public class Media extends VLCObject<IMedia.Event> implements IMedia {
      * @return true in case of success, false otherwise.
      */
     public boolean parseAsync(int flags, int timeout) {
-        boolean parse = false;
         synchronized (this) {
-            if ((mParseStatus & (PARSE_STATUS_PARSED | PARSE_STATUS_PARSING)) == 0) {
-                mParseStatus |= PARSE_STATUS_PARSING;
-                parse = true;
-            }
+            if ((mParseStatus & PARSE_STATUS_PARSED) != 0)
+                return false;
+            mParseStatus |= PARSE_STATUS_PARSING;
         }
-        return parse && nativeParseAsync(flags, timeout);
+        /* Joins a parsing in progress, ParsedChanged is then sent once */
+        return nativeParseAsync(flags, timeout);
     }
 
     public boolean parseAsync(int flags) {
@@ -464,10 +668,18 @@ public class Media extends VLCObject<IMedia.Event> implements IMedia {
                 setHWDecoderEnabled(true, false);
         }
 
+        final String option = getDefaultMediaPlayerOption(mUri);
+        if (option != null)
+            addOption(option);
+    }
+
+    @Nullable
+    private static String getDefaultMediaPlayerOption(Uri uri) {
         /* dvdnav need to be explicitly forced for network playbacks */
-        if (mUri != null && mUri.getScheme() != null && !mUri.getScheme().equalsIgnoreCase("file") &&
-                mUri.getLastPathSegment() != null && mUri.getLastPathSegment().toLowerCase().endsWith(".iso"))
-            addOption(":demux=dvdnav,any");
+        if (uri != null && uri.getScheme() != null && !uri.getScheme().equalsIgnoreCase("file") &&
+                uri.getLastPathSegment() != null && uri.getLastPathSegment().toLowerCase().endsWith(".iso"))
+            return ":demux=dvdnav,any";
+        return null;
     }
 
     /**
@@ -477,16 +689,21 @@ public class Media extends VLCObject<IMedia.Event> implements IMedia {
      */
     public void addOption(String option) {
         synchronized (this) {
-            if (!mCodecOptionSet && option.startsWith(":codec="))
-                mCodecOptionSet = true;
-            if (!mNetworkCachingSet && option.startsWith(":network-caching="))
-                mNetworkCachingSet = true;
-            if (!mFileCachingSet && option.startsWith(":file-caching="))
-                mFileCachingSet = true;
+            trackOption(option);
         }
         nativeAddOption(option);
     }
 
+    /* Must be called locked, or from the constructor */
+    private void trackOption(String option) {
+        if (!mCodecOptionSet && option.startsWith(":codec="))
+            mCodecOptionSet = true;
+        if (!mNetworkCachingSet && option.startsWith(":network-caching="))
+            mNetworkCachingSet = true;
+        if (!mFileCachingSet && option.startsWith(":file-caching="))
+            mFileCachingSet = true;
+    }
+
 
     /**
      * Add a slave to the current media.
@@ -520,6 +737,95 @@ public class Media extends VLCObject<IMedia.Event> implements IMedia {
         return nativeGetSlaves();
     }
 
+    /**
+     * Probe the header of a local file to get its duration and track counts,
+     * without creating a Media nor running a full preparse: no art is fetched,
+     * no subitem nor subtitle file is looked for. This call is blocking.
+     *
+     * @param ILibVLC a valid LibVLC
+     * @param path an absolute local path
+     * @param byteBudget maximum number of bytes read from the file, 0 for no limit
+     * @param timeout maximum time in milliseconds, -1 for the "preparse-timeout"
+     * option, 0 to wait indefinitely
+     */
+    public static ProbeResult probe(ILibVLC ILibVLC, String path, long byteBudget, int timeout) {
+        if (path == null)
+            throw new IllegalArgumentException("path is null");
+        return nativeProbe(ILibVLC, path, null, byteBudget, timeout);
+    }
+
+    /**
+     * Probe a regular file from its descriptor, the descriptor is not closed
+     *
+     * @see #probe(ILibVLC, String, long, int)
+     */
+    public static ProbeResult probe(ILibVLC ILibVLC, FileDescriptor fd, long byteBudget, int timeout) {
+        if (fd == null)
+            throw new IllegalArgumentException("fd is null");
+        return nativeProbe(ILibVLC, null, fd, byteBudget, timeout);
+    }
+
+    /**
+     * Compute the content fingerprint of a local file. This call is blocking.
+     *
+     * @param path an absolute local path
+     * @param samples number of 64 KiB blocks hashed for {@link Fingerprint#sampledHash}, 0 to skip it
+     * @return the fingerprint, or null in case of I/O error
+     */
+    @Nullable
+    public static Fingerprint computeFingerprint(String path, int samples) {
+        return toFingerprint(nativeFingerprintPath(path, samples));
+    }
+
+    /**
+     * Compute the content fingerprint of a file descriptor range, the descriptor is not closed
+     *
+     * @param length length of the range, or -1 up to the end of the file
+     * @see #computeFingerprint(String, int)
+     */
+    @Nullable
+    public static Fingerprint computeFingerprint(FileDescriptor fd, long offset, long length, int samples) {
+        return toFingerprint(nativeFingerprintFd(fd, offset, length, samples));
+    }
+
+    /**
+     * Compute the content fingerprints of local files from a pool of native threads
+     *
+     * @param threads number of threads, 0 to use one per CPU
+     * @return one fingerprint per path, null for the paths that failed
+     * @see #computeFingerprint(String, int)
+     */
+    public static Fingerprint[] computeFingerprints(String[] paths, int samples, int threads) {
+        final long[] values = nativeFingerprintPaths(paths, samples, threads);
+        final Fingerprint[] fingerprints = new Fingerprint[paths.length];
+        for (int i = 0; values != null && i < paths.length; ++i) {
+            if (values[3 * i] >= 0)
+                fingerprints[i] = new Fingerprint(values[3 * i], values[3 * i + 1], values[3 * i + 2]);
+        }
+        return fingerprints;
+    }
+
+    /**
+     * Compute the content fingerprint of this Media, if it was created from
+     * a file descriptor or a local path
+     *
+     * @see #computeFingerprint(String, int)
+     */
+    @Nullable
+    public Fingerprint computeFingerprint(int samples) {
+        final Fingerprint fingerprint = toFingerprint(nativeFingerprint(samples));
+        if (fingerprint != null)
+            return fingerprint;
+        final Uri uri = getUri();
+        if (uri != null && "file".equals(uri.getScheme()) && uri.getPath() != null)
+            return computeFingerprint(uri.getPath(), samples);
+        return null;
+    }
+
+    private static Fingerprint toFingerprint(long[] values) {
+        return values != null ? new Fingerprint(values[0], values[1], values[2]) : null;
+    }
+
     /**
      * Get the stats related to the playing media
      */
@@ -528,10 +834,96 @@ public class Media extends VLCObject<IMedia.Event> implements IMedia {
         return nativeGetStats();
     }
 
+    /**
+     * Get the counters of the native ring buffer
+     *
+     * @return the stats or null if this Media was not created from a {@link DataSource}
+     */
+    @Nullable
+    public SourceStats getSourceStats() {
+        synchronized (this) {
+            if (mSourceFeeder == null || isReleased())
+                return null;
+        }
+        final long[] stats = new long[6];
+        if (!nativeGetSourceStats(stats))
+            return null;
+        return new SourceStats(stats[0], stats[1], stats[2], stats[3], stats[4], stats[5]);
+    }
+
+    /* The feeder only uses its own reference to the native ring, so that it
+     * can outlive this Media when the DataSource blocks */
+    private static class SourceFeeder extends Thread {
+        private final DataSource mSource;
+        private final long mRing;
+        private final int mChunkSize;
+
+        SourceFeeder(DataSource source, long ring, int chunkSize) {
+            super("vlc-media-source");
+            mSource = source;
+            mRing = ring;
+            mChunkSize = chunkSize;
+        }
+
+        @Override
+        public void run() {
+            try {
+                feed();
+            } finally {
+                nativeSourceRelease(mRing);
+            }
+        }
+
+        private void feed() {
+            final ByteBuffer chunk = ByteBuffer.allocateDirect(mChunkSize);
+            long retryDelay = SOURCE_RETRY_MIN_DELAY_MS;
+            while (true) {
+                final long request = nativeSourceWaitRequest(mRing, mChunkSize);
+                if (request == SOURCE_REQUEST_CLOSED)
+                    break;
+                try {
+                    if (request != SOURCE_REQUEST_FILL) {
+                        mSource.seek(request);
+                        continue;
+                    }
+                    chunk.clear();
+                    final int read = mSource.read(chunk);
+                    if (read == 0) {
+                        /* Nothing available yet: don't spin on the source */
+                        Thread.sleep(retryDelay);
+                        retryDelay = Math.min(retryDelay * 2, SOURCE_RETRY_MAX_DELAY_MS);
+                        continue;
+                    }
+                    retryDelay = SOURCE_RETRY_MIN_DELAY_MS;
+                    nativeSourceWrite(mRing, chunk, read < 0 ? SOURCE_WRITE_EOF : read);
+                } catch (InterruptedException e) {
+                    break;
+                } catch (IOException e) {
+                    Log.w(TAG, "DataSource failed", e);
+                    nativeSourceWrite(mRing, chunk, SOURCE_WRITE_ERROR);
+                }
+            }
+        }
+    }
+
     @Override
     protected void onReleaseNative() {
         if (mSubItems != null)
             mSubItems.release();
+        if (mSourceFeeder != null) {
+            /* Wake the feeder up, but don't wait forever for a DataSource
+             * blocked in read(): it holds its own ring reference, and the
+             * closed ring drops whatever it writes later */
+            nativeSourceClose();
+            mSourceFeeder.interrupt();
+            try {
+                mSourceFeeder.join(SOURCE_FEEDER_JOIN_TIMEOUT_MS);
+            } catch (InterruptedException e) {
+                Thread.currentThread().interrupt();
+            }
+            if (mSourceFeeder.isAlive())
+                Log.w(TAG, "DataSource feeder still blocked, detaching it");
+        }
         nativeRelease();
     }
 
@@ -540,6 +932,25 @@ public class Media extends VLCObject<IMedia.Event> implements IMedia {
     private native void nativeNewFromLocation(ILibVLC ILibVLC, String location);
     private native void nativeNewFromFd(ILibVLC ILibVLC, FileDescriptor fd);
     private native void nativeNewFromFdWithOffsetLength(ILibVLC ILibVLC, FileDescriptor fd, long offset, long length);
+    private native void nativeNewFromByteBuffer(ILibVLC ILibVLC, ByteBuffer buffer, long offset, long length);
+    private static native long[] nativeFingerprintPath(String path, int samples);
+    private static native long[] nativeFingerprintFd(FileDescriptor fd, long offset, long length, int samples);
+    private static native long[] nativeFingerprintPaths(String[] paths, int samples, int threads);
+    private native long[] nativeFingerprint(int samples);
+    private static native ProbeResult nativeProbe(ILibVLC ILibVLC, String path, FileDescriptor fd,
+                                                  long byteBudget, int timeout);
+    private native void nativeNewFromHandle(ILibVLC ILibVLC, long handle);
+    private native String nativeNewFromBuilder(ILibVLC ILibVLC, String location, boolean isPath,
+                                               String[] options, int[] slaveInfos,
+                                               String[] slaveUris, int parseFlags,
+                                               int parseTimeout, boolean[] parsing);
+    private native void nativeNewFromDataSource(ILibVLC ILibVLC, long size, int ringSize);
+    private native long nativeSourceAcquire();
+    private static native void nativeSourceRelease(long ring);
+    private static native long nativeSourceWaitRequest(long ring, int chunkSize);
+    private static native void nativeSourceWrite(long ring, ByteBuffer buffer, int length);
+    private native void nativeSourceClose();
+    private native boolean nativeGetSourceStats(long[] stats);
     private native void nativeNewFromMediaList(IMediaList ml, int index);
     private native void nativeRelease();
     private native boolean nativeParseAsync(int flags, int timeout);
@@ -0,0 +1,148 @@
+/*****************************************************************************
+ * MediaBatch.java
+ *****************************************************************************
+ * Copyright © 2023 VLC authors, VideoLAN and VideoLabs
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+package org.videolan.libvlc;
+
+import android.net.Uri;
+
+import androidx.annotation.Nullable;
+
+import org.videolan.libvlc.interfaces.ILibVLC;
+import org.videolan.libvlc.util.VLCUtil;
+
+/**
+ * A set of medias created in a single native call.
+ *
+ * Items are kept as native handles, without any Java object nor event
+ * listener, until they are promoted to a {@link Media} by {@link #getMedia(int)}.
+ */
+public class MediaBatch {
+    private final ILibVLC mILibVLC;
+    private long[] mHandles;
+    private final String[] mMrls;
+
+    private MediaBatch(ILibVLC ILibVLC, String[] locations, boolean isPath) {
+        if (!ILibVLC.retain())
+            throw new IllegalStateException("LibVLC is released");
+        mILibVLC = ILibVLC;
+        boolean created = false;
+        try {
+            mHandles = nativeNew(locations, isPath);
+            created = true;
+        } finally {
+            /* nobody can release() a batch that failed to be created */
+            if (!created)
+                ILibVLC.release();
+        }
+        mMrls = new String[mHandles.length];
+    }
+
+    /**
+     * Create a batch of medias from absolute local paths
+     *
+     * @param ILibVLC a valid LibVLC
+     * @param paths absolute local paths
+     */
+    public static MediaBatch fromPaths(ILibVLC ILibVLC, String[] paths) {
+        return new MediaBatch(ILibVLC, paths, true);
+    }
+
+    /**
+     * Create a batch of medias from Uris
+     *
+     * @param ILibVLC a valid LibVLC
+     * @param uris valid RFC 2396 Uris
+     */
+    public static MediaBatch fromUris(ILibVLC ILibVLC, Uri[] uris) {
+        final String[] locations = new String[uris.length];
+        for (int i = 0; i < uris.length; ++i)
+            locations[i] = uris[i] != null ? VLCUtil.encodeVLCUri(uris[i]) : null;
+        return new MediaBatch(ILibVLC, locations, false);
+    }
+
+    public synchronized int size() {
+        return mHandles != null ? mHandles.length : 0;
+    }
+
+    /**
+     * @return true if the media at index could not be created
+     */
+    public synchronized boolean isInvalid(int index) {
+        checkIndex(index);
+        return mHandles[index] == 0;
+    }
+
+    /**
+     * Get the mrl of a media, queried once on demand
+     */
+    @Nullable
+    public synchronized String getMrl(int index) {
+        checkIndex(index);
+        if (mMrls[index] == null && mHandles[index] != 0)
+            mMrls[index] = nativeGetMrl(mHandles[index]);
+        return mMrls[index];
+    }
+
+    /**
+     * Promote a media of this batch to a full Media object.
+     *
+     * Each call returns a new Media sharing the same native media, that must
+     * be released by the caller. It stays valid after this batch is released.
+     *
+     * @return the Media or null if it could not be created
+     */
+    @Nullable
+    public Media getMedia(int index) {
+        synchronized (this) {
+            checkIndex(index);
+            if (mHandles[index] == 0)
+                return null;
+            /* created locked so that release() can't free the handle meanwhile */
+            return new Media(mILibVLC, mHandles[index], mMrls[index]);
+        }
+    }
+
+    /**
+     * Release the native medias that were not promoted
+     */
+    public void release() {
+        final long[] handles;
+        synchronized (this) {
+            if (mHandles == null)
+                return;
+            handles = mHandles;
+            mHandles = null;
+        }
+        nativeRelease(handles);
+        mILibVLC.release();
+    }
+
+    private void checkIndex(int index) {
+        if (mHandles == null)
+            throw new IllegalStateException("MediaBatch is released");
+        if (index < 0 || index >= mHandles.length)
+            throw new IndexOutOfBoundsException("index " + index);
+    }
+
+    /* JNI */
+    private static native long[] nativeNew(String[] locations, boolean isPath);
+    private static native String nativeGetMrl(long handle);
+    private static native void nativeRelease(long[] handles);
+}
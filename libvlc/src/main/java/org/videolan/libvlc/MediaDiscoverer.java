@@ -20,11 +20,15 @@
 
 package org.videolan.libvlc;
 
+import android.util.SparseArray;
+
 import androidx.annotation.Nullable;
 
 import org.videolan.libvlc.interfaces.AbstractVLCEvent;
 import org.videolan.libvlc.interfaces.ILibVLC;
 
+import java.util.WeakHashMap;
+
 @SuppressWarnings("unused, JniMissingFunction")
 public class MediaDiscoverer extends VLCObject<MediaDiscoverer.Event> {
     private final static String TAG = "LibVLC/MediaDiscoverer";
@@ -146,13 +150,32 @@ public class MediaDiscoverer extends VLCObject<MediaDiscoverer.Event> {
         nativeRelease();
     }
 
+    /* The modules of a LibVLC don't change: lists are only fetched once */
+    private static final WeakHashMap<ILibVLC, SparseArray<Description[]>> sDescriptions =
+            new WeakHashMap<>();
+
     /**
      * Get media discoverers by category
      * @param category see {@link Description.Category}
      */
     @Nullable
     public static Description[] list(ILibVLC ILibVLC, int category) {
-        return nativeList(ILibVLC, category);
+        synchronized (sDescriptions) {
+            SparseArray<Description[]> descriptionsByCategory = sDescriptions.get(ILibVLC);
+            Description[] descriptions = descriptionsByCategory != null
+                    ? descriptionsByCategory.get(category) : null;
+            if (descriptions == null) {
+                descriptions = nativeList(ILibVLC, category);
+                if (descriptions == null)
+                    return null;
+                if (descriptionsByCategory == null) {
+                    descriptionsByCategory = new SparseArray<>();
+                    sDescriptions.put(ILibVLC, descriptionsByCategory);
+                }
+                descriptionsByCategory.put(category, descriptions);
+            }
+            return descriptions.clone();
+        }
     }
 
     /* JNI */
@@ -0,0 +1,108 @@
+/*****************************************************************************
+ * MediaIdentityMap.java
+ *****************************************************************************
+ * Copyright © 2023 VLC authors, VideoLAN and VideoLabs
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+package org.videolan.libvlc;
+
+import android.util.LongSparseArray;
+
+import java.lang.ref.WeakReference;
+
+/**
+ * Weak map from native libvlc_media_t to their live Java Media, one per LibVLC.
+ *
+ * MediaList items are looked up here before creating a new Media, so that the
+ * same native media is always wrapped by the same Media, with a single event
+ * attachment and parse state, as long as it is referenced.
+ */
+public final class MediaIdentityMap {
+    private static final int PURGE_MIN_SIZE = 64;
+
+    private final LongSparseArray<WeakReference<Media>> mMedias = new LongSparseArray<>();
+    private int mPurgeSize = PURGE_MIN_SIZE;
+    private long mHits = 0;
+    private long mMisses = 0;
+
+    MediaIdentityMap() {
+    }
+
+    /**
+     * Get the live Media wrapping handle, retained, or null
+     */
+    synchronized Media acquire(long handle) {
+        final WeakReference<Media> ref = mMedias.get(handle);
+        final Media media = ref != null ? ref.get() : null;
+        /* A released Media can't be reused: its native media may be a new one
+         * allocated at the same address */
+        if (media != null && media.retain()) {
+            mHits++;
+            return media;
+        }
+        if (ref != null)
+            mMedias.remove(handle);
+        mMisses++;
+        return null;
+    }
+
+    synchronized void put(long handle, Media media) {
+        mMedias.put(handle, new WeakReference<>(media));
+        if (mMedias.size() >= mPurgeSize) {
+            purge();
+            mPurgeSize = Math.max(PURGE_MIN_SIZE, mMedias.size() * 2);
+        }
+    }
+
+    /* Remove the entries of collected or released Media */
+    private void purge() {
+        for (int i = mMedias.size() - 1; i >= 0; --i) {
+            final Media media = mMedias.valueAt(i).get();
+            if (media == null || media.isReleased())
+                mMedias.removeAt(i);
+        }
+    }
+
+    /**
+     * Get the number of lookups that returned an existing Media
+     */
+    public synchronized long getHits() {
+        return mHits;
+    }
+
+    /**
+     * Get the number of lookups that needed a new Media
+     */
+    public synchronized long getMisses() {
+        return mMisses;
+    }
+
+    /**
+     * Get the ratio of lookups that returned an existing Media, between 0 and 1
+     */
+    public synchronized float getHitRate() {
+        final long lookups = mHits + mMisses;
+        return lookups > 0 ? (float) mHits / lookups : 0.f;
+    }
+
+    /**
+     * Get the number of entries, including not yet purged ones
+     */
+    public synchronized int size() {
+        return mMedias.size();
+    }
+}
@@ -21,27 +21,69 @@
 package org.videolan.libvlc;
 
 import android.os.Handler;
-import android.util.SparseArray;
 
+import androidx.annotation.NonNull;
 import androidx.annotation.Nullable;
 
 import org.videolan.libvlc.interfaces.ILibVLC;
 import org.videolan.libvlc.interfaces.IMedia;
 import org.videolan.libvlc.interfaces.IMediaList;
 
+import java.util.ArrayList;
+import java.util.Collections;
+import java.util.List;
+
 @SuppressWarnings("unused, JniMissingFunction")
 public class MediaList extends VLCObject<IMediaList.Event> implements IMediaList {
     private final static String TAG = "LibVLC/MediaList";
 
+    /**
+     * Compact copy of all the items of a MediaList, see {@link #getSnapshot()}
+     */
+    public static class Snapshot {
+        public final String[] mrls;
+        /** see {@link IMedia.Type} */
+        public final int[] types;
+        /** durations in milliseconds, -1 if unknown */
+        public final long[] durations;
+        public final String[] titles;
+        public final String[] artists;
+        public final String[] albums;
+        public final String[] artworkUrls;
+
+        private Snapshot(String[] mrls, int[] types, long[] durations, String[] titles,
+                         String[] artists, String[] albums, String[] artworkUrls) {
+            this.mrls = mrls;
+            this.types = types;
+            this.durations = durations;
+            this.titles = titles;
+            this.artists = artists;
+            this.albums = albums;
+            this.artworkUrls = artworkUrls;
+        }
+
+        public int getCount() {
+            return mrls.length;
+        }
+    }
+
+    @SuppressWarnings("unused") /* Used from JNI */
+    private static Snapshot createSnapshotFromNative(String[] mrls, int[] types, long[] durations,
+                                                     String[] titles, String[] artists,
+                                                     String[] albums, String[] artworkUrls) {
+        return new Snapshot(mrls, types, durations, titles, artists, albums, artworkUrls);
+    }
+
     private int mCount = 0;
-    private final SparseArray<IMedia> mMediaArray = new SparseArray<IMedia>();
+    /* Media are created on demand by getMediaAt(), null until then */
+    private final ArrayList<IMedia> mMediaArray = new ArrayList<>();
     private boolean mLocked = false;
 
     private void init() {
         lock();
         mCount = nativeGetCount();
         for (int i = 0; i < mCount; ++i)
-            mMediaArray.put(i, new Media(this, i));
+            mMediaArray.add(null);
         unlock();
     }
 
@@ -74,23 +116,39 @@ public class MediaList extends VLCObject<IMediaList.Event> implements IMediaList
         init();
     }
 
+    /*
+     * Get the Media of the item at index, shared with other lists through the
+     * LibVLC MediaIdentityMap. The native list must be locked.
+     */
+    private IMedia newMediaLocked(int index) {
+        if (!(mILibVLC instanceof LibVLC))
+            return new Media(this, index);
+        final MediaIdentityMap map = ((LibVLC) mILibVLC).getMediaIdentityMap();
+        final long handle = nativeGetItemHandle(index);
+        if (handle == 0)
+            return new Media(this, index);
+        synchronized (map) {
+            Media media = map.acquire(handle);
+            if (media == null) {
+                media = new Media(this, index);
+                map.put(handle, media);
+            }
+            return media;
+        }
+    }
+
     private synchronized IMedia insertMediaFromEvent(int index) {
-        for (int i = mCount - 1; i >= index; --i)
-            mMediaArray.put(i + 1, mMediaArray.valueAt(i));
         mCount++;
-        final IMedia media = new Media(this, index);
-        mMediaArray.put(index, media);
+        final IMedia media = newMediaLocked(index);
+        mMediaArray.add(index, media);
         return media;
     }
 
     private synchronized IMedia removeMediaFromEvent(int index) {
         mCount--;
-        final IMedia media = mMediaArray.get(index);
+        final IMedia media = mMediaArray.remove(index);
         if (media != null)
             media.release();
-        for (int i = index; i < mCount; ++i) {
-            mMediaArray.put(i, mMediaArray.valueAt(i + 1));
-        }
         return media;
     }
 
@@ -124,6 +182,36 @@ public class MediaList extends VLCObject<IMediaList.Event> implements IMediaList
             case Event.EndReached:
                 event = new Event(eventType, null, false, -1);
                 break;
+            case Event.ItemsAdded: {
+                index = (int) arg1;
+                final int count = (int) arg2;
+                /* Created on demand, like the initial items */
+                mMediaArray.addAll(index, Collections.<IMedia>nCopies(count, null));
+                mCount += count;
+                event = new Event(eventType, null, false, index, count, -1);
+                break;
+            }
+            case Event.ItemsDeleted: {
+                index = (int) arg1;
+                final int count = (int) arg2;
+                final List<IMedia> range = mMediaArray.subList(index, index + count);
+                for (IMedia media : range) {
+                    if (media != null)
+                        media.release();
+                }
+                range.clear();
+                mCount -= count;
+                event = new Event(eventType, null, false, index, count, -1);
+                break;
+            }
+            case Event.ItemMoved: {
+                final int from = (int) arg1;
+                index = (int) arg2;
+                final IMedia media = mMediaArray.remove(from);
+                mMediaArray.add(index, media);
+                event = new Event(eventType, media, media != null, index, 1, from);
+                break;
+            }
         }
         mLocked = false;
         return event;
@@ -142,18 +230,108 @@ public class MediaList extends VLCObject<IMediaList.Event> implements IMediaList
      * @param index index of the media
      * @return Media hold by MediaList. This Media should be released with {@link #release()}.
      */
-    public synchronized IMedia getMediaAt(int index) {
-        if (index < 0 || index >= getCount())
+    public IMedia getMediaAt(int index) {
+        synchronized (this) {
+            if (index < 0 || index >= getCount())
+                throw new IndexOutOfBoundsException();
+            final IMedia media = mMediaArray.get(index);
+            if (media != null) {
+                media.retain();
+                return media;
+            }
+        }
+
+        /* The native lock is held by libvlc when events are sent, and the
+         * event callback takes the Java lock: take them in the same order. */
+        nativeLock();
+        try {
+            synchronized (this) {
+                if (index >= getCount())
+                    throw new IndexOutOfBoundsException();
+                IMedia media = mMediaArray.get(index);
+                if (media == null) {
+                    mLocked = true;
+                    try {
+                        media = newMediaLocked(index);
+                    } finally {
+                        mLocked = false;
+                    }
+                    mMediaArray.set(index, media);
+                }
+                media.retain();
+                return media;
+            }
+        } finally {
+            nativeUnlock();
+        }
+    }
+
+    /**
+     * Append medias with a single native call. Listeners receive one
+     * {@link Event#ItemsAdded} event instead of one {@link Event#ItemAdded} per media.
+     *
+     * @return the number of medias added
+     * @throws IllegalStateException if the list is read-only (from a discoverer or sub items)
+     */
+    public int addMedias(@NonNull IMedia[] medias) {
+        return nativeInsertMedias(-1, medias);
+    }
+
+    /**
+     * Insert medias at index, see {@link #addMedias(IMedia[])}
+     */
+    public int insertMedias(int index, @NonNull IMedia[] medias) {
+        if (index < 0)
             throw new IndexOutOfBoundsException();
-        final IMedia media = mMediaArray.get(index);
-        media.retain();
-        return media;
+        return nativeInsertMedias(index, medias);
+    }
+
+    /**
+     * Append medias created from locations, invalid locations are skipped.
+     * See {@link #addMedias(IMedia[])}
+     */
+    public int addLocations(@NonNull String[] mrls) {
+        return nativeInsertLocations(-1, mrls);
+    }
+
+    /**
+     * Insert medias created from locations at index, see {@link #addLocations(String[])}
+     */
+    public int insertLocations(int index, @NonNull String[] mrls) {
+        if (index < 0)
+            throw new IndexOutOfBoundsException();
+        return nativeInsertLocations(index, mrls);
+    }
+
+    /**
+     * Remove count medias from index with a single native call. Listeners
+     * receive one {@link Event#ItemsDeleted} event.
+     */
+    public void removeRange(int index, int count) {
+        nativeRemoveRange(index, count);
+    }
+
+    /**
+     * Move a media, listeners receive one {@link Event#ItemMoved} event.
+     *
+     * @param from current index of the media
+     * @param to index of the media once moved
+     */
+    public void move(int from, int to) {
+        nativeMove(from, to);
+    }
+
+    /**
+     * Get a copy of the mrl, type, duration and main metas of all items,
+     * read with a single native lock and without creating any Media.
+     */
+    public Snapshot getSnapshot() {
+        return nativeGetSnapshot();
     }
 
     @Override
     public void onReleaseNative() {
-        for (int i = 0; i < mMediaArray.size(); ++i) {
-            final IMedia media = mMediaArray.get(i);
+        for (IMedia media : mMediaArray) {
             if (media != null)
                 media.release();
         }
@@ -193,4 +371,11 @@ public class MediaList extends VLCObject<IMediaList.Event> implements IMediaList
     private native void nativeLock();
 
     private native void nativeUnlock();
+
+    private native Snapshot nativeGetSnapshot();
+    private native int nativeInsertMedias(int index, IMedia[] medias);
+    private native int nativeInsertLocations(int index, String[] mrls);
+    private native void nativeRemoveRange(int index, int count);
+    private native void nativeMove(int from, int to);
+    private native long nativeGetItemHandle(int index);
 }
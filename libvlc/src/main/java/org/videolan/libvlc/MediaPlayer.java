@@ -53,6 +53,10 @@ import org.videolan.libvlc.util.VLCVideoLayout;
 
 import java.io.File;
 import java.io.IOException;
+import java.util.HashMap;
+import java.util.concurrent.Future;
+import java.util.concurrent.TimeUnit;
+import java.util.concurrent.TimeoutException;
 
 @SuppressWarnings("unused, JniMissingFunction")
 public class MediaPlayer extends VLCObject<MediaPlayer.Event> {
@@ -244,6 +248,327 @@ public class MediaPlayer extends VLCObject<MediaPlayer.Event> {
         return new Chapter(timeOffset, duration, name);
     }
 
+    /**
+     * Time series recorded by the stats sampler, see {@link #startStatsSampler(int, int)}
+     *
+     * All arrays have the same length, the oldest sample first. Rates are
+     * computed from the difference between two consecutive readings of
+     * {@link Media#getStats()}.
+     */
+    public static class StatsSeries {
+        /**
+         * sample times in milliseconds, from a monotonic clock
+         */
+        public final long[] times;
+        /**
+         * input and demux bitrates in bytes per second
+         */
+        public final float[] inputBitrates;
+        public final float[] demuxBitrates;
+        /**
+         * decoded and displayed video frames per second
+         */
+        public final float[] decodedFps;
+        public final float[] displayedFps;
+        /**
+         * lost and late pictures, lost audio buffers, per second
+         */
+        public final float[] lostPictures;
+        public final float[] latePictures;
+        public final float[] lostAbuffers;
+
+        private StatsSeries(long[] times, float[] inputBitrates, float[] demuxBitrates,
+                            float[] decodedFps, float[] displayedFps, float[] lostPictures,
+                            float[] latePictures, float[] lostAbuffers) {
+            this.times = times;
+            this.inputBitrates = inputBitrates;
+            this.demuxBitrates = demuxBitrates;
+            this.decodedFps = decodedFps;
+            this.displayedFps = displayedFps;
+            this.lostPictures = lostPictures;
+            this.latePictures = latePictures;
+            this.lostAbuffers = lostAbuffers;
+        }
+
+        public int size() {
+            return times.length;
+        }
+    }
+
+    /**
+     * Playback state read with a single native call, see {@link #getState(State)}
+     */
+    public static class State {
+        private static final int COUNT = 12;
+
+        /** see {@link #getPlayerState()} */
+        public int playerState = -1;
+        /** time and length in milliseconds, -1 if there is no media */
+        public long time = -1;
+        public long length = -1;
+        public float position = -1;
+        public boolean playing = false;
+        public boolean seekable = false;
+        public float rate = 1.f;
+        public int volume = -1;
+        /** audio and spu delays in microseconds */
+        public long audioDelay = 0;
+        public long spuDelay = 0;
+        public int title = -1;
+        public int chapter = -1;
+
+        private final long[] mValues = new long[COUNT];
+
+        private void update() {
+            /* Keep in sync with libvlcjni-mediaplayer.c */
+            playerState = (int) mValues[0];
+            time = mValues[1];
+            length = mValues[2];
+            position = Float.intBitsToFloat((int) mValues[3]);
+            playing = mValues[4] != 0;
+            seekable = mValues[5] != 0;
+            rate = Float.intBitsToFloat((int) mValues[6]);
+            volume = (int) mValues[7];
+            audioDelay = mValues[8];
+            spuDelay = mValues[9];
+            title = (int) mValues[10];
+            chapter = (int) mValues[11];
+        }
+    }
+
+    /**
+     * Commands run by the command queue, see {@link #playAsync()}
+     */
+    public static class Command {
+        public static final int SetMedia = 0;
+        public static final int Play = 1;
+        public static final int Pause = 2;
+        public static final int Stop = 3;
+        public static final int SetTime = 4;
+        public static final int SetPosition = 5;
+        public static final int SetRate = 6;
+        public static final int SetVolume = 7;
+        public static final int SelectTracks = 8;
+    }
+
+    public static class CommandStatus {
+        public static final int Done = 0;
+        public static final int Failed = 1;
+        /** Not run: overridden by a later command, like a newer seek or volume */
+        public static final int Coalesced = 2;
+        /** Not run: cancelled or the MediaPlayer was released */
+        public static final int Cancelled = 3;
+    }
+
+    public interface CommandCallback {
+        void onCommandDone(@NonNull CommandFuture future);
+    }
+
+    /**
+     * Completion of a queued command, the result is a {@link CommandStatus}
+     */
+    public class CommandFuture implements Future<Integer> {
+        private final long mId;
+        private final int mCommand;
+        private boolean mDone = false;
+        private int mStatus = -1;
+        private long mQueueLatency = 0;
+        private long mExecutionTime = 0;
+        private CommandCallback mCallback = null;
+        private Handler mHandler = null;
+
+        private CommandFuture(long id, int command) {
+            mId = id;
+            mCommand = command;
+        }
+
+        /** see {@link Command} */
+        public int getCommand() {
+            return mCommand;
+        }
+
+        /**
+         * Time spent in the queue in microseconds, 0 if the command was not run
+         */
+        public synchronized long getQueueLatency() {
+            return mQueueLatency;
+        }
+
+        /**
+         * Time spent running the command in microseconds
+         */
+        public synchronized long getExecutionTime() {
+            return mExecutionTime;
+        }
+
+        /**
+         * Set the callback called once the command is done, immediately if it
+         * is already done
+         *
+         * @param handler handler running the callback, null to run it from the
+         *                command thread, where it must not block. Commands
+         *                cancelled by {@link #release()} are reported on the
+         *                main thread instead.
+         */
+        public void setCallback(@NonNull CommandCallback callback, @Nullable Handler handler) {
+            synchronized (this) {
+                mCallback = callback;
+                mHandler = handler;
+                if (!mDone)
+                    return;
+            }
+            notifyCallback(callback, handler);
+        }
+
+        private void complete(int status, long queueLatency, long executionTime) {
+            final CommandCallback callback;
+            final Handler handler;
+            synchronized (this) {
+                if (mDone)
+                    return;
+                mDone = true;
+                mStatus = status;
+                mQueueLatency = queueLatency;
+                mExecutionTime = executionTime;
+                callback = mCallback;
+                handler = mHandler;
+                notifyAll();
+            }
+            if (callback != null)
+                notifyCallback(callback, handler);
+        }
+
+        private void notifyCallback(final CommandCallback callback, @Nullable Handler handler) {
+            /* Commands are reported from the worker while release() holds the
+             * MediaPlayer lock and waits for it: don't run callbacks there */
+            if (handler == null && mReleasing)
+                handler = new Handler(Looper.getMainLooper());
+            if (handler == null) {
+                callback.onCommandDone(this);
+                return;
+            }
+            handler.post(new Runnable() {
+                @Override
+                public void run() {
+                    callback.onCommandDone(CommandFuture.this);
+                }
+            });
+        }
+
+        /**
+         * Cancel the command if it is still in the queue, a running command
+         * can't be interrupted
+         */
+        @Override
+        public boolean cancel(boolean mayInterruptIfRunning) {
+            synchronized (this) {
+                if (mDone)
+                    return false;
+            }
+            /* Pending commands are cancelled by release() */
+            synchronized (MediaPlayer.this) {
+                if (isReleased() || !nativeCancelCommand(mId))
+                    return false;
+            }
+            synchronized (mCommands) {
+                mCommands.remove(mId);
+            }
+            complete(CommandStatus.Cancelled, 0, 0);
+            return true;
+        }
+
+        @Override
+        public synchronized boolean isCancelled() {
+            return mDone && mStatus == CommandStatus.Cancelled;
+        }
+
+        @Override
+        public synchronized boolean isDone() {
+            return mDone;
+        }
+
+        @Override
+        public synchronized Integer get() throws InterruptedException {
+            while (!mDone)
+                wait();
+            return mStatus;
+        }
+
+        @Override
+        public synchronized Integer get(long timeout, @NonNull TimeUnit unit)
+                throws InterruptedException, TimeoutException {
+            final long deadline = System.nanoTime() + unit.toNanos(timeout);
+            while (!mDone) {
+                final long remaining = deadline - System.nanoTime();
+                if (remaining <= 0)
+                    throw new TimeoutException();
+                TimeUnit.NANOSECONDS.timedWait(this, remaining);
+            }
+            return mStatus;
+        }
+    }
+
+    /**
+     * Counters of the command queue, times in microseconds
+     */
+    public static class CommandStats {
+        public final long queued;
+        public final long executed;
+        public final long failed;
+        public final long coalesced;
+        public final long cancelled;
+        /** total and maximum time spent by executed commands in the queue */
+        public final long totalQueueLatency;
+        public final long maxQueueLatency;
+        /** total and maximum time spent running the commands */
+        public final long totalExecutionTime;
+        public final long maxExecutionTime;
+
+        private CommandStats(long[] stats) {
+            queued = stats[0];
+            executed = stats[1];
+            failed = stats[2];
+            coalesced = stats[3];
+            cancelled = stats[4];
+            totalQueueLatency = stats[5];
+            maxQueueLatency = stats[6];
+            totalExecutionTime = stats[7];
+            maxExecutionTime = stats[8];
+        }
+    }
+
+    /**
+     * Counters of the scrub sessions, see {@link #startScrubbing()}
+     */
+    public static class ScrubStats {
+        /** number of {@link #scrubTo(long)} calls */
+        public final long requests;
+        /** number of seeks run, lower than requests when targets were skipped */
+        public final long seeks;
+        /** seeks that didn't complete in time and didn't hold the next one back */
+        public final long timeouts;
+        /**
+         * latencies between the latest seeks and the first time update at
+         * the new time, in microseconds, the oldest first
+         */
+        public final long[] latencies;
+
+        private ScrubStats(long[] counters, long[] latencies) {
+            requests = counters[0];
+            seeks = counters[1];
+            timeouts = counters[2];
+            this.latencies = latencies != null ? latencies : new long[0];
+        }
+    }
+
+    @SuppressWarnings("unused") /* Used from JNI */
+    private static StatsSeries createStatsSeriesFromNative(long[] times, float[] inputBitrates,
+            float[] demuxBitrates, float[] decodedFps, float[] displayedFps,
+            float[] lostPictures, float[] latePictures, float[] lostAbuffers) {
+        return new StatsSeries(times, inputBitrates, demuxBitrates, decodedFps, displayedFps,
+                lostPictures, latePictures, lostAbuffers);
+    }
+
     public static class Equalizer {
         @SuppressWarnings("unused") /* Used from JNI */
         private long mInstance;
@@ -432,6 +757,11 @@ public class MediaPlayer extends VLCObject<MediaPlayer.Event> {
     // Video tools
     private VideoHelper mVideoHelper = null;
 
+    /* Queued commands waiting for their completion, by id */
+    private final HashMap<Long, CommandFuture> mCommands = new HashMap<>();
+    private long mNextCommandId = 1;
+    private volatile boolean mReleasing = false;
+
     private final AWindow mWindow = new AWindow(new AWindow.SurfaceCallback() {
         @Override
         public void onSurfacesCreated(AWindow vout) {
@@ -805,6 +1135,10 @@ public class MediaPlayer extends VLCObject<MediaPlayer.Event> {
             mPlaying = false;
         }
         nativeStop();
+        closeAssetFd();
+    }
+
+    private void closeAssetFd() {
         if (mAfd != null) try {
             mAfd.close();
         } catch (IOException ignored) {}
@@ -1398,9 +1732,287 @@ public class MediaPlayer extends VLCObject<MediaPlayer.Event> {
         if (mRenderer != null)
             mRenderer.release();
         mVoutCount = 0;
+        mReleasing = true;
         nativeRelease();
     }
 
+    /**
+     * Start sampling the stats of the current media from a native thread
+     *
+     * Restarts the sampler and drops the previous samples if it was already running.
+     *
+     * @param intervalMs sampling interval in milliseconds
+     * @param capacity maximum number of samples kept, older ones are overwritten
+     * @return true if the sampler is running
+     */
+    public boolean startStatsSampler(int intervalMs, int capacity) {
+        return nativeStartStatsSampler(intervalMs, capacity);
+    }
+
+    /**
+     * Stop the stats sampler, the recorded samples are kept
+     */
+    public void stopStatsSampler() {
+        nativeStopStatsSampler();
+    }
+
+    /**
+     * Get the samples recorded by the stats sampler
+     *
+     * @return the series or null if the sampler was never started
+     */
+    @Nullable
+    public StatsSeries getStatsSeries() {
+        return nativeGetStatsSeries();
+    }
+
+    /**
+     * Get the time, length, position, playing and seekable flags, player state,
+     * rate, volume, audio and spu delays, title and chapter with a single
+     * native call, instead of one call per value.
+     *
+     * @param state state to update, null to allocate a new one. UIs refreshing
+     *              periodically can reuse the same instance.
+     * @return the updated state
+     */
+    @NonNull
+    public State getState(@Nullable State state) {
+        if (state == null)
+            state = new State();
+        synchronized (state) {
+            nativeGetState(state.mValues);
+            state.update();
+        }
+        return state;
+    }
+
+    private CommandFuture queueCommand(int command, @Nullable IMedia media, long larg,
+                                       float farg, boolean fast, @Nullable String sarg) {
+        final CommandFuture future;
+        synchronized (mCommands) {
+            future = new CommandFuture(mNextCommandId++, command);
+            mCommands.put(future.mId, future);
+        }
+        try {
+            nativeQueueCommand(future.mId, command, media, larg, farg, fast, sarg);
+        } catch (RuntimeException e) {
+            synchronized (mCommands) {
+                mCommands.remove(future.mId);
+            }
+            throw e;
+        }
+        return future;
+    }
+
+    @SuppressWarnings("unused") /* Used from JNI */
+    private void onCommandDoneFromNative(long id, int status, long queueLatency,
+                                         long executionTime) {
+        final CommandFuture future;
+        synchronized (mCommands) {
+            future = mCommands.remove(id);
+        }
+        if (future == null)
+            return;
+        if (future.mCommand == Command.Stop && status == CommandStatus.Done)
+            closeAssetFd();
+        future.complete(status, queueLatency, executionTime);
+    }
+
+    private CommandFuture completedCommand(int command) {
+        final CommandFuture future;
+        synchronized (mCommands) {
+            future = new CommandFuture(mNextCommandId++, command);
+        }
+        future.complete(CommandStatus.Done, 0, 0);
+        return future;
+    }
+
+    /**
+     * Same as {@link #setMedia(IMedia)}, run by the command queue.
+     *
+     * The asynchronous variants queue the commands to a native worker thread
+     * of this MediaPlayer, started on the first call, so that the calling
+     * thread never waits for libvlc. Commands are run in order; pending seeks
+     * are dropped by a new media or a stop, and consecutive seeks, rate,
+     * volume or track selections of the same type are coalesced into the
+     * last one. Synchronous calls are not ordered with the queued commands.
+     */
+    @NonNull
+    public CommandFuture setMediaAsync(@Nullable IMedia media) {
+        if (media != null) {
+            if (media.isReleased())
+                throw new IllegalArgumentException("Media is released");
+            media.setDefaultMediaPlayerOptions();
+        }
+        final CommandFuture future = queueCommand(Command.SetMedia, media, 0, 0.f, false, null);
+        synchronized (this) {
+            if (mMedia != null) {
+                mMedia.release();
+            }
+            if (media != null)
+                media.retain();
+            mMedia = media;
+        }
+        return future;
+    }
+
+    /**
+     * Same as {@link #play()}, run by the command queue
+     *
+     * @return a future, already done if the playback waits for the surfaces
+     */
+    @NonNull
+    public CommandFuture playAsync() {
+        synchronized (this) {
+            if (!mPlaying) {
+                if (mListenAudioPlug)
+                    registerAudioPlug(true);
+                mPlayRequested = true;
+                if (mWindow.areSurfacesWaiting())
+                    return completedCommand(Command.Play);
+            }
+            mPlaying = true;
+        }
+        return queueCommand(Command.Play, null, 0, 0.f, false, null);
+    }
+
+    /**
+     * Same as {@link #pause()}, run by the command queue
+     */
+    @NonNull
+    public CommandFuture pauseAsync() {
+        return queueCommand(Command.Pause, null, 0, 0.f, false, null);
+    }
+
+    /**
+     * Same as {@link #stop()}, run by the command queue: the caller doesn't wait
+     * for the input to be stopped, that can take long on stalled network streams.
+     */
+    @NonNull
+    public CommandFuture stopAsync() {
+        synchronized (this) {
+            mPlayRequested = false;
+            mPlaying = false;
+        }
+        return queueCommand(Command.Stop, null, 0, 0.f, false, null);
+    }
+
+    /**
+     * Same as {@link #setTime(long, boolean)}, run by the command queue
+     */
+    @NonNull
+    public CommandFuture setTimeAsync(long time, boolean fast) {
+        return queueCommand(Command.SetTime, null, time, 0.f, fast, null);
+    }
+
+    /**
+     * Same as {@link #setPosition(float, boolean)}, run by the command queue
+     */
+    @NonNull
+    public CommandFuture setPositionAsync(float pos, boolean fast) {
+        return queueCommand(Command.SetPosition, null, 0, pos, fast, null);
+    }
+
+    /**
+     * Same as {@link #setRate(float)}, run by the command queue
+     */
+    @NonNull
+    public CommandFuture setRateAsync(float rate) {
+        return queueCommand(Command.SetRate, null, 0, rate, false, null);
+    }
+
+    /**
+     * Same as {@link #setVolume(int)}, run by the command queue
+     */
+    @NonNull
+    public CommandFuture setVolumeAsync(int volume) {
+        return queueCommand(Command.SetVolume, null, volume, 0.f, false, null);
+    }
+
+    /**
+     * Same as {@link #selectTracks(int, String)}, run by the command queue
+     */
+    @NonNull
+    public CommandFuture selectTracksAsync(int type, @Nullable String ids) {
+        return queueCommand(Command.SelectTracks, null, type, 0.f, false, ids);
+    }
+
+    /**
+     * Get the counters of the command queue
+     */
+    @NonNull
+    public CommandStats getCommandStats() {
+        final long[] stats = new long[9];
+        nativeGetCommandStats(stats);
+        return new CommandStats(stats);
+    }
+
+    /**
+     * Start a scrub session, to follow a seek bar being dragged
+     *
+     * While scrubbing, only one seek is run at a time, on a key frame: targets
+     * set while it is running are skipped but the latest one, run once the
+     * seek is done. Seeks are run by the command queue, see {@link #setMediaAsync(IMedia)}.
+     */
+    public void startScrubbing() {
+        nativeScrubStart();
+    }
+
+    /**
+     * Set the scrub target
+     *
+     * @param time time in milliseconds
+     * @throws IllegalStateException if no scrub session is started
+     */
+    public void scrubTo(long time) {
+        nativeScrubTo(time);
+    }
+
+    /**
+     * Set the scrub target from a position, see {@link #scrubTo(long)}
+     *
+     * @return false if the length of the media is not known
+     */
+    public boolean scrubToPosition(float pos) {
+        final long length = getLength();
+        if (length <= 0)
+            return false;
+        nativeScrubTo((long) (pos * length));
+        return true;
+    }
+
+    /**
+     * Stop the scrub session and seek to the last target
+     *
+     * @param precise true to seek to the exact time, false to stay on a key frame
+     * @return the final seek, already done if there was no target
+     */
+    @NonNull
+    public CommandFuture stopScrubbing(boolean precise) {
+        final CommandFuture future;
+        synchronized (mCommands) {
+            future = new CommandFuture(mNextCommandId++, Command.SetTime);
+            mCommands.put(future.mId, future);
+        }
+        if (!nativeScrubStop(future.mId, precise)) {
+            synchronized (mCommands) {
+                mCommands.remove(future.mId);
+            }
+            future.complete(CommandStatus.Done, 0, 0);
+        }
+        return future;
+    }
+
+    /**
+     * Get the counters of the scrub sessions
+     */
+    @NonNull
+    public ScrubStats getScrubStats() {
+        final long[] counters = new long[3];
+        final long[] latencies = nativeGetScrubStats(counters);
+        return new ScrubStats(counters, latencies);
+    }
+
     public boolean canDoPassthrough() {
         return mCanDoPassthrough;
     }
@@ -1411,6 +2023,18 @@ public class MediaPlayer extends VLCObject<MediaPlayer.Event> {
     private native void nativeNewFromLibVlc(ILibVLC ILibVLC, AWindow window);
     private native void nativeNewFromMedia(IMedia media, AWindow window);
     private native void nativeRelease();
+    private native boolean nativeStartStatsSampler(int interval, int capacity);
+    private native void nativeStopStatsSampler();
+    private native StatsSeries nativeGetStatsSeries();
+    private native void nativeGetState(long[] state);
+    private native void nativeQueueCommand(long id, int command, IMedia media, long larg,
+                                           float farg, boolean fast, String sarg);
+    private native boolean nativeCancelCommand(long id);
+    private native void nativeGetCommandStats(long[] stats);
+    private native void nativeScrubStart();
+    private native void nativeScrubTo(long time);
+    private native boolean nativeScrubStop(long id, boolean precise);
+    private native long[] nativeGetScrubStats(long[] counters);
     private native void nativeSetMedia(IMedia media);
     private native void nativePlay();
     private native void nativeStop();
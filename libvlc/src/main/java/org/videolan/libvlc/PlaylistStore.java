@@ -0,0 +1,362 @@
+/*****************************************************************************
+ * PlaylistStore.java
+ *****************************************************************************
+ * Copyright © 2023 VLC authors, VideoLAN and VideoLabs
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+package org.videolan.libvlc;
+
+import android.net.Uri;
+import android.os.SystemClock;
+
+import androidx.annotation.NonNull;
+import androidx.annotation.Nullable;
+
+import org.videolan.libvlc.interfaces.ILibVLC;
+import org.videolan.libvlc.util.VLCUtil;
+
+import java.io.File;
+import java.io.IOException;
+import java.io.InputStream;
+
+/**
+ * Off-heap playlist for very large queues.
+ *
+ * Entries are kept natively as mrls and a few metas in a single string arena,
+ * no Java or native Media is created until {@link #newMediaBuilder} or
+ * {@link #play} is called. Indexes are positions in the current sort order,
+ * among the entries matching the filter.
+ *
+ * Large M3U and PLS playlists can be loaded directly into the store with
+ * {@link #load(File, ProgressListener)}, without going through libvlc and one
+ * MediaList event per entry.
+ */
+@SuppressWarnings("JniMissingFunction")
+public class PlaylistStore {
+    public static class Field {
+        public static final int Mrl = 0;
+        public static final int Title = 1;
+        public static final int Artist = 2;
+        public static final int Album = 3;
+        /** group-title of M3U playlists */
+        public static final int Group = 4;
+        /** tvg-id of M3U playlists */
+        public static final int TvgId = 5;
+        /** tvg-logo of M3U playlists */
+        public static final int Logo = 6;
+    }
+
+    public static class SortKey {
+        public static final int Title = 0;
+        public static final int Artist = 1;
+        public static final int Duration = 2;
+        public static final int Path = 3;
+        /** Insertion order */
+        public static final int None = 4;
+    }
+
+    public interface ProgressListener {
+        /**
+         * Called from the loading thread, about every MiB parsed
+         *
+         * @param entries number of entries added so far
+         * @param totalBytes size of the playlist, -1 if unknown
+         * @return false to stop loading, the entries already added are kept
+         */
+        boolean onProgress(int entries, long bytesRead, long totalBytes);
+    }
+
+    public static class LoadResult {
+        /** number of entries added */
+        public final int entries;
+        /** number of bytes parsed */
+        public final long bytes;
+        /** duration of the load in milliseconds */
+        public final long duration;
+        public final boolean cancelled;
+
+        private LoadResult(int entries, long bytes, long duration, boolean cancelled) {
+            this.entries = entries;
+            this.bytes = bytes;
+            this.duration = duration;
+            this.cancelled = cancelled;
+        }
+
+        public float getEntriesPerSecond() {
+            return duration > 0 ? entries * 1000f / duration : 0f;
+        }
+
+        public float getBytesPerSecond() {
+            return duration > 0 ? bytes * 1000f / duration : 0f;
+        }
+    }
+
+    private static final int LOAD_CHUNK_SIZE = 64 * 1024;
+    private static final int LOAD_PROGRESS_SIZE = 1024 * 1024;
+
+    @SuppressWarnings("unused") /* Used from JNI */
+    private long mInstance;
+
+    public PlaylistStore() {
+        nativeNew();
+    }
+
+    @Override
+    protected void finalize() throws Throwable {
+        try {
+            nativeRelease();
+        } finally {
+            super.finalize();
+        }
+    }
+
+    /**
+     * Free the native memory now instead of when finalized
+     */
+    public synchronized void release() {
+        nativeRelease();
+    }
+
+    /**
+     * Append one entry
+     *
+     * @param duration duration in milliseconds, -1 if unknown
+     */
+    public synchronized void add(@NonNull String mrl, @Nullable String title,
+                                 @Nullable String artist, @Nullable String album, long duration) {
+        nativeAdd(new String[] { mrl }, new String[] { title }, new String[] { artist },
+                new String[] { album }, new long[] { duration });
+    }
+
+    /**
+     * Append entries from parallel arrays in a single native call. Only mrls
+     * is mandatory, null arrays or elements are stored as empty metas, and
+     * entries with a null mrl are skipped.
+     *
+     * @return the number of entries added
+     */
+    public synchronized int addAll(@NonNull String[] mrls, @Nullable String[] titles,
+                                   @Nullable String[] artists, @Nullable String[] albums,
+                                   @Nullable long[] durations) {
+        return nativeAdd(mrls, titles, artists, albums, durations);
+    }
+
+    public synchronized void clear() {
+        nativeClear();
+    }
+
+    /**
+     * Get the number of entries matching the filter
+     */
+    public synchronized int getCount() {
+        return nativeGetCount(false);
+    }
+
+    /**
+     * Get the number of entries, ignoring the filter
+     */
+    public synchronized int getTotalCount() {
+        return nativeGetCount(true);
+    }
+
+    public synchronized String getMrl(int index) {
+        return nativeGetString(index, Field.Mrl);
+    }
+
+    @Nullable
+    public synchronized String getTitle(int index) {
+        return nativeGetString(index, Field.Title);
+    }
+
+    @Nullable
+    public synchronized String getArtist(int index) {
+        return nativeGetString(index, Field.Artist);
+    }
+
+    @Nullable
+    public synchronized String getAlbum(int index) {
+        return nativeGetString(index, Field.Album);
+    }
+
+    @Nullable
+    public synchronized String getGroup(int index) {
+        return nativeGetString(index, Field.Group);
+    }
+
+    @Nullable
+    public synchronized String getTvgId(int index) {
+        return nativeGetString(index, Field.TvgId);
+    }
+
+    @Nullable
+    public synchronized String getLogo(int index) {
+        return nativeGetString(index, Field.Logo);
+    }
+
+    /**
+     * @return duration in milliseconds, -1 if unknown
+     */
+    public synchronized long getDuration(int index) {
+        return nativeGetDuration(index);
+    }
+
+    /**
+     * Get a field of count entries from start, for list adapters
+     *
+     * @param field see {@link Field}
+     */
+    public synchronized String[] getStrings(int field, int start, int count) {
+        return nativeGetStrings(field, start, count);
+    }
+
+    /**
+     * Stable sort of the entries, ignoring case for strings. Entries added
+     * later are appended unsorted.
+     *
+     * @param key see {@link SortKey}
+     */
+    public synchronized void sort(int key, boolean ascending) {
+        nativeSort(key, ascending);
+    }
+
+    /**
+     * Keep only the entries whose title, artist, album, group or mrl contain query,
+     * ignoring ASCII case.
+     *
+     * @param query null or empty to show all the entries
+     */
+    public synchronized void setFilter(@Nullable String query) {
+        nativeSetFilter(query);
+    }
+
+    /**
+     * Get the number of bytes allocated natively
+     */
+    public synchronized long getMemoryUsage() {
+        return nativeGetMemoryUsage();
+    }
+
+    /**
+     * Get a Media.Builder for the entry at index, to add options before
+     * building the Media
+     */
+    public Media.Builder newMediaBuilder(ILibVLC ILibVLC, int index) {
+        return new Media.Builder(ILibVLC).setUri(VLCUtil.UriFromMrl(getMrl(index)));
+    }
+
+    /**
+     * Create the Media of the entry at index and set it to the MediaPlayer
+     */
+    public void play(@NonNull MediaPlayer mediaPlayer, int index) {
+        final Media media = newMediaBuilder(mediaPlayer.getLibVLC(), index)
+                .setDefaultMediaPlayerOptions()
+                .build();
+        mediaPlayer.setMedia(media);
+        media.release();
+        mediaPlayer.play();
+    }
+
+    /**
+     * Append count entries from start to a MediaList, with a single native call
+     *
+     * @return the number of medias added
+     * @see MediaList#addLocations(String[])
+     */
+    public int fillMediaList(@NonNull MediaList mediaList, int start, int count) {
+        return mediaList.addLocations(getStrings(Field.Mrl, start, count));
+    }
+
+    /**
+     * Append the entries of a local M3U or PLS playlist. The file is mapped in
+     * memory and parsed natively, relative locations are resolved against its
+     * directory. Blocks until done.
+     *
+     * @param listener progress listener, can be null
+     * @throws IllegalArgumentException if the file can't be opened
+     */
+    public synchronized LoadResult load(@NonNull File file, @Nullable ProgressListener listener) {
+        final File parent = file.getAbsoluteFile().getParentFile();
+        final String base = parent != null ? Uri.fromFile(parent).toString() : null;
+        final long[] result = new long[3];
+        final long start = SystemClock.elapsedRealtime();
+        nativeLoadFile(file.getAbsolutePath(), base, listener, result);
+        return new LoadResult((int) result[0], result[1], SystemClock.elapsedRealtime() - start,
+                result[2] != 0);
+    }
+
+    /**
+     * Append the entries of a M3U or PLS playlist read from a stream, in
+     * chunks. Blocks until done, the stream is not closed.
+     *
+     * @param baseMrl mrl of the directory of the playlist, to resolve relative
+     *                locations, can be null
+     * @param totalBytes size of the stream, -1 if unknown
+     * @param listener progress listener, can be null
+     */
+    public synchronized LoadResult load(@NonNull InputStream stream, @Nullable String baseMrl,
+                                        long totalBytes, @Nullable ProgressListener listener)
+            throws IOException {
+        final byte[] buffer = new byte[LOAD_CHUNK_SIZE];
+        final long start = SystemClock.elapsedRealtime();
+        final long parser = nativeParserNew(baseMrl);
+        long bytes = 0, nextProgress = LOAD_PROGRESS_SIZE;
+        int entries = 0;
+        boolean cancelled = false;
+        try {
+            int read;
+            while ((read = stream.read(buffer)) != -1) {
+                entries = nativeParserFeed(parser, buffer, read);
+                bytes += read;
+                if (listener != null && bytes >= nextProgress) {
+                    nextProgress = bytes + LOAD_PROGRESS_SIZE;
+                    if (!listener.onProgress(entries, bytes, totalBytes)) {
+                        cancelled = true;
+                        break;
+                    }
+                }
+            }
+            if (!cancelled) {
+                entries = nativeParserEnd(parser);
+                if (listener != null)
+                    listener.onProgress(entries, bytes, totalBytes);
+            }
+        } finally {
+            nativeParserRelease(parser);
+        }
+        return new LoadResult(entries, bytes, SystemClock.elapsedRealtime() - start, cancelled);
+    }
+
+    /* JNI */
+    private native void nativeNew();
+    private native void nativeRelease();
+    private native int nativeAdd(String[] mrls, String[] titles, String[] artists,
+                                 String[] albums, long[] durations);
+    private native void nativeClear();
+    private native int nativeGetCount(boolean total);
+    private native String nativeGetString(int index, int field);
+    private native String[] nativeGetStrings(int field, int start, int count);
+    private native long nativeGetDuration(int index);
+    private native void nativeSort(int key, boolean ascending);
+    private native void nativeSetFilter(String query);
+    private native long nativeGetMemoryUsage();
+    private native void nativeLoadFile(String path, String base, ProgressListener listener,
+                                       long[] result);
+    private native long nativeParserNew(String base);
+    private native int nativeParserFeed(long parser, byte[] data, int size);
+    private native int nativeParserEnd(long parser);
+    private native void nativeParserRelease(long parser);
+}
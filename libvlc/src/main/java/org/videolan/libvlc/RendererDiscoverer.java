@@ -21,7 +21,9 @@
 package org.videolan.libvlc;
 
 import java.util.ArrayList;
+import java.util.Arrays;
 import java.util.List;
+import java.util.WeakHashMap;
 
 import androidx.annotation.Nullable;
 import androidx.collection.LongSparseArray;
@@ -33,6 +35,7 @@ public class RendererDiscoverer extends VLCObject<RendererDiscoverer.Event> {
     private final static String TAG = "LibVLC/RendererDiscoverer";
 
     final List<RendererItem> mRenderers = new ArrayList<>();
+    private boolean mStarted = false;
 
     public static class Event extends AbstractVLCEvent {
 
@@ -83,9 +86,65 @@ public class RendererDiscoverer extends VLCObject<RendererDiscoverer.Event> {
      */
     public boolean start() {
         if (isReleased()) throw new IllegalStateException("MediaDiscoverer is released");
+        synchronized (this) {
+            mStarted = true;
+        }
         return nativeStart();
     }
 
+    /**
+     * Debounce the renderer announcements. Renderers are identified by name and type, an
+     * item is only added once it was announced for the whole window, and only removed once
+     * it was gone for the whole window. Renderers that come and go faster don't send any
+     * event. Must be called before {@link #start()}.
+     *
+     * @param window window in milliseconds
+     */
+    public synchronized void setDebounceWindow(int window) {
+        if (isReleased()) throw new IllegalStateException("MediaDiscoverer is released");
+        if (mStarted) throw new IllegalStateException("RendererDiscoverer is started");
+        nativeSetDebounce(window);
+    }
+
+    /**
+     * Get the current renderers in one call. Each item should be released with
+     * {@link RendererItem#release()}.
+     */
+    public synchronized RendererItem[] getRenderers() {
+        final RendererItem[] items = new RendererItem[mRenderers.size()];
+        int count = 0;
+        for (RendererItem item : mRenderers) {
+            if (item.retain())
+                items[count++] = item;
+        }
+        return count == items.length ? items : Arrays.copyOf(items, count);
+    }
+
+    public static class RegistryStats {
+        /** renderers added after the debounce window */
+        public final long added;
+        /** renderers removed after the debounce window */
+        public final long removed;
+        /** announcements or removals cancelled within the debounce window */
+        public final long flaps;
+
+        private RegistryStats(long added, long removed, long flaps) {
+            this.added = added;
+            this.removed = removed;
+            this.flaps = flaps;
+        }
+    }
+
+    /**
+     * Get the debounce counters, all 0 without {@link #setDebounceWindow(int)}
+     */
+    public RegistryStats getRegistryStats() {
+        if (isReleased()) throw new IllegalStateException("MediaDiscoverer is released");
+        final long[] stats = new long[3];
+        nativeGetRegistryStats(stats);
+        return new RegistryStats(stats[0], stats[1], stats[2]);
+    }
+
     /**
      * Stops the discovery. This RendererDiscoverer should be alive (not released).
      * (You can also call {@link #release() to stop the discovery directly}.
@@ -101,8 +160,20 @@ public class RendererDiscoverer extends VLCObject<RendererDiscoverer.Event> {
         super.setEventListener(listener);
     }
 
+    /* The modules of a LibVLC don't change: lists are only fetched once */
+    private static final WeakHashMap<ILibVLC, Description[]> sDescriptions = new WeakHashMap<>();
+
     public static Description[] list(ILibVLC ILibVlc) {
-        return nativeList(ILibVlc);
+        synchronized (sDescriptions) {
+            Description[] descriptions = sDescriptions.get(ILibVlc);
+            if (descriptions == null) {
+                descriptions = nativeList(ILibVlc);
+                if (descriptions == null)
+                    return null;
+                sDescriptions.put(ILibVlc, descriptions);
+            }
+            return descriptions.clone();
+        }
     }
 
     public static class Description {
@@ -163,4 +234,6 @@ public class RendererDiscoverer extends VLCObject<RendererDiscoverer.Event> {
     private native void nativeStop();
     private static native Description[] nativeList(ILibVLC ILibVLC);
     private native RendererItem nativeNewItem(long ref);
+    private native void nativeSetDebounce(int window);
+    private native void nativeGetRegistryStats(long[] stats);
 }
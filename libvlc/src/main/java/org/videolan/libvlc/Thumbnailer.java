@@ -0,0 +1,275 @@
+/*****************************************************************************
+ * Thumbnailer.java
+ *****************************************************************************
+ * Copyright © 2023 VLC authors, VideoLAN and VideoLabs
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+package org.videolan.libvlc;
+
+import androidx.annotation.NonNull;
+
+import org.videolan.libvlc.interfaces.ILibVLC;
+import org.videolan.libvlc.interfaces.IMedia;
+
+import java.nio.ByteBuffer;
+import java.util.concurrent.LinkedBlockingQueue;
+import java.util.concurrent.RejectedExecutionException;
+import java.util.concurrent.ThreadFactory;
+import java.util.concurrent.ThreadPoolExecutor;
+import java.util.concurrent.TimeUnit;
+
+/**
+ * Generate thumbnails of medias from a bounded pool of worker threads.
+ *
+ * Pictures are decoded on the CPU, without any surface, and written into
+ * caller supplied direct ByteBuffers. Requires libvlc 4.0 or later.
+ */
+public class Thumbnailer {
+    public static class Format {
+        /** 4 bytes per pixel: R, G, B, A (Bitmap.Config.ARGB_8888 layout) */
+        public static final int RGBA = 0;
+        /** 2 bytes per pixel (Bitmap.Config.RGB_565 layout) */
+        public static final int RGB565 = 1;
+    }
+
+    public static class Status {
+        public static final int Success = 0;
+        public static final int Failed = 1;
+        public static final int Cancelled = 2;
+        public static final int BufferTooSmall = 3;
+    }
+
+    public interface Callback {
+        /**
+         * Called from a worker thread when the request is over
+         */
+        void onThumbnail(@NonNull Request request, @NonNull Result result);
+    }
+
+    public static class Result {
+        /** see {@link Status} */
+        public final int status;
+        public final int width;
+        public final int height;
+        /** bytes per line written into the buffer */
+        public final int stride;
+        public final ByteBuffer buffer;
+        /** time spent waiting for a worker, in milliseconds */
+        public final long queuedTime;
+        /** time spent generating and converting the thumbnail, in milliseconds */
+        public final long generationTime;
+
+        private Result(int status, int width, int height, int stride, ByteBuffer buffer,
+                       long queuedTime, long generationTime) {
+            this.status = status;
+            this.width = width;
+            this.height = height;
+            this.stride = stride;
+            this.buffer = buffer;
+            this.queuedTime = queuedTime;
+            this.generationTime = generationTime;
+        }
+    }
+
+    public class Request implements Runnable {
+        @SuppressWarnings("unused") /* Used from JNI */
+        private long mInstance;
+
+        private final IMedia mMedia;
+        private final boolean mByPos;
+        private final long mTime;
+        private final float mPos;
+        private final int mWidth;
+        private final int mHeight;
+        private final boolean mCrop;
+        private final boolean mFast;
+        private final long mTimeout;
+        private final int mFormat;
+        private final ByteBuffer mBuffer;
+        private final Callback mCallback;
+        private final long mQueuedAt;
+        private boolean mCancelled = false;
+
+        private Request(IMedia media, boolean byPos, long time, float pos, int width, int height,
+                        boolean crop, boolean fast, long timeout, int format, ByteBuffer buffer,
+                        Callback callback) {
+            mMedia = media;
+            mByPos = byPos;
+            mTime = time;
+            mPos = pos;
+            mWidth = width;
+            mHeight = height;
+            mCrop = crop;
+            mFast = fast;
+            mTimeout = timeout;
+            mFormat = format;
+            mBuffer = buffer;
+            mCallback = callback;
+            mQueuedAt = System.nanoTime();
+        }
+
+        /**
+         * Cancel the request, the callback is still called with {@link Status#Cancelled}
+         */
+        public void cancel() {
+            synchronized (this) {
+                if (mCancelled)
+                    return;
+                mCancelled = true;
+                if (mInstance != 0)
+                    nativeCancel();
+            }
+        }
+
+        public synchronized boolean isCancelled() {
+            return mCancelled;
+        }
+
+        public IMedia getMedia() {
+            return mMedia;
+        }
+
+        @Override
+        public void run() {
+            final long start = System.nanoTime();
+            final int[] info = new int[3];
+            int status = Status.Cancelled;
+            try {
+                synchronized (this) {
+                    if (!mCancelled)
+                        nativeNew(mMedia);
+                }
+                if (mInstance != 0) {
+                    status = nativeRun(mByPos, mTime, mPos, mFast, mWidth, mHeight, mCrop,
+                            mTimeout, mFormat, mBuffer, info);
+                }
+            } catch (IllegalStateException e) {
+                status = Status.Failed;
+            } finally {
+                synchronized (this) {
+                    if (mInstance != 0)
+                        nativeRelease();
+                }
+                mMedia.release();
+            }
+            final long end = System.nanoTime();
+            mCallback.onThumbnail(this, new Result(status, info[0], info[1], info[2], mBuffer,
+                    TimeUnit.NANOSECONDS.toMillis(start - mQueuedAt),
+                    TimeUnit.NANOSECONDS.toMillis(end - start)));
+        }
+
+        /* JNI */
+        private native void nativeNew(IMedia media);
+        private native void nativeRelease();
+        private native int nativeRun(boolean byPos, long time, float pos, boolean fast,
+                                     int width, int height, boolean crop, long timeout,
+                                     int format, ByteBuffer buffer, int[] info);
+        private native void nativeCancel();
+    }
+
+    private final ILibVLC mILibVLC;
+    private final ThreadPoolExecutor mExecutor;
+
+    /**
+     * Create a Thumbnailer
+     *
+     * @param ILibVLC a valid LibVLC, the medias must be created from it
+     * @param maxThreads maximum number of thumbnails generated at the same time
+     */
+    public Thumbnailer(ILibVLC ILibVLC, int maxThreads) {
+        if (maxThreads <= 0)
+            throw new IllegalArgumentException("maxThreads <= 0");
+        if (!ILibVLC.retain())
+            throw new IllegalStateException("LibVLC is released");
+        mILibVLC = ILibVLC;
+        mExecutor = new ThreadPoolExecutor(maxThreads, maxThreads, 30, TimeUnit.SECONDS,
+                new LinkedBlockingQueue<Runnable>(), new ThreadFactory() {
+            @Override
+            public Thread newThread(@NonNull Runnable r) {
+                return new Thread(r, "vlc-thumbnailer");
+            }
+        });
+        mExecutor.allowCoreThreadTimeOut(true);
+    }
+
+    /**
+     * Generate a thumbnail at a given time
+     *
+     * @param media a valid Media
+     * @param time time in milliseconds
+     * @param width target width, 0 to keep the aspect ratio from height
+     * @param height target height, 0 to keep the aspect ratio from width
+     * @param crop true to crop the picture to width x height instead of letterboxing it
+     * @param fast true to seek to the nearest key frame instead of the exact time
+     * @param timeout maximum time in milliseconds, 0 for no timeout
+     * @param format see {@link Format}
+     * @param buffer direct ByteBuffer receiving the pixels
+     * @param callback called once the request is over
+     * @return the request, that can be cancelled
+     */
+    public Request requestByTime(@NonNull IMedia media, long time, int width, int height,
+                                 boolean crop, boolean fast, long timeout, int format,
+                                 @NonNull ByteBuffer buffer, @NonNull Callback callback) {
+        return submit(new Request(media, false, time, 0.f, width, height, crop, fast, timeout,
+                format, buffer, callback));
+    }
+
+    /**
+     * Generate a thumbnail at a given position
+     *
+     * @param pos position between 0.0 and 1.0
+     * @see #requestByTime
+     */
+    public Request requestByPosition(@NonNull IMedia media, float pos, int width, int height,
+                                     boolean crop, boolean fast, long timeout, int format,
+                                     @NonNull ByteBuffer buffer, @NonNull Callback callback) {
+        return submit(new Request(media, true, 0, pos, width, height, crop, fast, timeout,
+                format, buffer, callback));
+    }
+
+    private Request submit(Request request) {
+        if (!request.mBuffer.isDirect())
+            throw new IllegalArgumentException("buffer is not direct");
+        if (request.mFormat != Format.RGBA && request.mFormat != Format.RGB565)
+            throw new IllegalArgumentException("invalid format");
+        if (!request.mMedia.retain())
+            throw new IllegalArgumentException("Media is released");
+        try {
+            mExecutor.execute(request);
+        } catch (RejectedExecutionException e) {
+            request.mMedia.release();
+            throw new IllegalStateException("Thumbnailer is released");
+        }
+        return request;
+    }
+
+    /**
+     * Release the Thumbnailer: pending requests are cancelled and running ones
+     * are completed.
+     */
+    public void release() {
+        if (mExecutor.isShutdown())
+            return;
+        for (Runnable r : mExecutor.shutdownNow()) {
+            /* Never started: run it cancelled to notify the callback */
+            final Request request = (Request) r;
+            request.cancel();
+            request.run();
+        }
+        mILibVLC.release();
+    }
+}
@@ -2,6 +2,9 @@ package org.videolan.libvlc.interfaces;
 
 import android.net.Uri;
 
+import java.io.IOException;
+import java.nio.ByteBuffer;
+
 public interface IMedia extends IVLCObject<IMedia.Event> {
     class Event extends AbstractVLCEvent {
         public static final int MetaChanged = 0;
@@ -344,6 +347,114 @@ public interface IMedia extends IVLCObject<IMedia.Event> {
         }
     }
 
+    /**
+     * Source of bytes for a Media that is not backed by a file or an URI.
+     *
+     * All methods are called from a dedicated feeder thread, never from the libvlc input thread.
+     */
+    interface DataSource {
+        /**
+         * Read bytes into the buffer, starting at its position.
+         *
+         * @return the number of bytes read, or -1 at the end of the stream
+         */
+        int read(ByteBuffer buffer) throws IOException;
+
+        /**
+         * Move the read position to offset, in bytes from the start of the stream.
+         */
+        void seek(long offset) throws IOException;
+
+        /**
+         * @return the size of the stream in bytes, or -1 if unknown
+         */
+        long size();
+    }
+
+    /**
+     * Counters of a Media created from a {@link DataSource}
+     */
+    class SourceStats {
+        /** Bytes written to the native ring buffer by the feeder */
+        public final long writtenBytes;
+        /** Bytes consumed by the libvlc input */
+        public final long readBytes;
+        /** Number of times the input had to wait for the feeder */
+        public final long underruns;
+        /** Number of times the feeder had to wait for the input */
+        public final long backpressureWaits;
+        public final long seeks;
+        /** Bytes currently buffered */
+        public final long bufferedBytes;
+
+        public SourceStats(long writtenBytes, long readBytes, long underruns,
+                           long backpressureWaits, long seeks, long bufferedBytes) {
+            this.writtenBytes = writtenBytes;
+            this.readBytes = readBytes;
+            this.underruns = underruns;
+            this.backpressureWaits = backpressureWaits;
+            this.seeks = seeks;
+            this.bufferedBytes = bufferedBytes;
+        }
+    }
+
+    /**
+     * Result of a header-only probe, see Media#probe
+     */
+    class ProbeResult {
+        /** see {@link ParsedStatus} */
+        public final int status;
+        /** duration in milliseconds, -1 if unknown */
+        public final long duration;
+        /** see {@link Type} */
+        public final int type;
+        public final int audioTracks;
+        public final int videoTracks;
+        public final int subtitleTracks;
+        /** bytes read from the file */
+        public final long bytesRead;
+        /** time spent probing, in milliseconds */
+        public final long elapsedTime;
+
+        public ProbeResult(int status, long duration, int type, int audioTracks,
+                           int videoTracks, int subtitleTracks, long bytesRead,
+                           long elapsedTime) {
+            this.status = status;
+            this.duration = duration;
+            this.type = type;
+            this.audioTracks = audioTracks;
+            this.videoTracks = videoTracks;
+            this.subtitleTracks = subtitleTracks;
+            this.bytesRead = bytesRead;
+            this.elapsedTime = elapsedTime;
+        }
+    }
+
+    /**
+     * Content fingerprint of a file, see Media#computeFingerprint
+     */
+    class Fingerprint {
+        /** size in bytes of the hashed content */
+        public final long size;
+        /** OpenSubtitles hash: size and first and last 64 KiB */
+        public final long osdbHash;
+        /** XXH64 of sampled 64 KiB blocks, 0 if no sample was requested */
+        public final long sampledHash;
+
+        public Fingerprint(long size, long osdbHash, long sampledHash) {
+            this.size = size;
+            this.osdbHash = osdbHash;
+            this.sampledHash = sampledHash;
+        }
+
+        /**
+         * @return the OpenSubtitles hash as 16 hex digits
+         */
+        public String getOsdbHashString() {
+            return String.format("%016x", osdbHash);
+        }
+    }
+
     long getDuration();
 
     IMediaList subItems();
@@ -10,22 +10,39 @@ public interface IMediaList extends IVLCObject<IMediaList.Event> {
         public static final int ItemDeleted = 0x202;
         //public static final int WillDeleteItem         = 0x203;
         public static final int EndReached = 0x204;
+        /** {@link #count} items added at {@link #index} by a single batch operation */
+        public static final int ItemsAdded = 0x280;
+        /** {@link #count} items removed from {@link #index} by a single batch operation */
+        public static final int ItemsDeleted = 0x281;
+        /** item moved from {@link #fromIndex} to {@link #index} */
+        public static final int ItemMoved = 0x282;
 
         /**
          * In case of ItemDeleted, the media will be already released. If it's released, cached
-         * attributes are still available (like {@link IMedia#getUri()}}).
+         * attributes are still available (like {@link IMedia#getUri()}}). It is null if the
+         * media was never retrieved with {@link IMediaList#getMediaAt(int)}.
          */
         public final IMedia media;
         private final boolean retain;
         public final int index;
+        /** Number of items, for range events */
+        public final int count;
+        /** Previous index, for ItemMoved */
+        public final int fromIndex;
 
         public Event(int type, IMedia media, boolean retain, int index) {
+            this(type, media, retain, index, 1, -1);
+        }
+
+        public Event(int type, IMedia media, boolean retain, int index, int count, int fromIndex) {
             super(type);
             if (retain && (media == null || !media.retain()))
                 throw new IllegalStateException("invalid media reference");
             this.media = media;
             this.retain = retain;
             this.index = index;
+            this.count = count;
+            this.fromIndex = fromIndex;
         }
 
         @Override
@@ -0,0 +1,154 @@
+/*****************************************************************************
+ * DirectoryScanner.java
+ *****************************************************************************
+ * Copyright © 2023 VLC authors, VideoLAN and VideoLabs
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+package org.videolan.libvlc.util;
+
+import androidx.annotation.NonNull;
+
+import org.videolan.libvlc.LibVLC;
+
+import java.nio.charset.Charset;
+import java.util.HashMap;
+import java.util.Map;
+import java.util.Set;
+
+/**
+ * Native scanner of local directories, returning the medias found below a
+ * root without going through libvlc and one MediaList event per entry.
+ *
+ * Directories are read in parallel and files are filtered by extension with
+ * the {@link Extensions} sets, as they were when the first scan started.
+ * Symbolic links are not followed.
+ */
+public class DirectoryScanner {
+    public static class Flags {
+        /** Scan files and directories starting with a dot */
+        public static final int ShowHidden = 1;
+        /** Skip the content of directories containing a .nomedia file */
+        public static final int RespectNoMedia = 2;
+    }
+
+    /** Bits of {@link Result#categories}, a file can be in several categories */
+    public static class Category {
+        public static final int Video = 1;
+        public static final int Audio = 2;
+        public static final int Subtitle = 4;
+        public static final int Playlist = 8;
+    }
+
+    public static class Result {
+        /** UTF-8 paths of all files, packed */
+        public final byte[] paths;
+        /** start of each path in {@link #paths}, and the end of the last one */
+        public final int[] offsets;
+        /** sizes in bytes */
+        public final long[] sizes;
+        /** modification times in milliseconds since the epoch */
+        public final long[] mtimes;
+        /** see {@link Category} */
+        public final byte[] categories;
+        /** number of directories read */
+        public final int directories;
+        /** duration of the scan, in milliseconds */
+        public final long duration;
+
+        private Result(byte[] paths, int[] offsets, long[] sizes, long[] mtimes,
+                       byte[] categories, int directories, long duration) {
+            this.paths = paths;
+            this.offsets = offsets;
+            this.sizes = sizes;
+            this.mtimes = mtimes;
+            this.categories = categories;
+            this.directories = directories;
+            this.duration = duration;
+        }
+
+        public int getCount() {
+            return sizes.length;
+        }
+
+        /**
+         * Decode the path of a file, paths are kept packed until then
+         */
+        public String getPath(int index) {
+            return new String(paths, offsets[index], offsets[index + 1] - offsets[index], UTF8);
+        }
+    }
+
+    @SuppressWarnings("unused") /* Used from JNI */
+    private static Result createResultFromNative(byte[] paths, int[] offsets, long[] sizes,
+                                                 long[] mtimes, byte[] categories,
+                                                 int directories, long duration) {
+        return new Result(paths, offsets, sizes, mtimes, categories, directories, duration);
+    }
+
+    private static final Charset UTF8 = Charset.forName("UTF-8");
+    private static boolean sInitialized = false;
+
+    /* Build the native extension set once, shared with DirectoryWatcher */
+    static synchronized void initExtensions() {
+        if (sInitialized)
+            return;
+        LibVLC.loadLibraries();
+
+        final Map<String, Integer> categories = new HashMap<>();
+        addCategory(categories, Extensions.VIDEO, Category.Video);
+        addCategory(categories, Extensions.AUDIO, Category.Audio);
+        addCategory(categories, Extensions.SUBTITLES, Category.Subtitle);
+        addCategory(categories, Extensions.PLAYLIST, Category.Playlist);
+
+        final String[] exts = new String[categories.size()];
+        final int[] cats = new int[exts.length];
+        int i = 0;
+        for (Map.Entry<String, Integer> entry : categories.entrySet()) {
+            exts[i] = entry.getKey();
+            cats[i++] = entry.getValue();
+        }
+        nativeInit(exts, cats);
+        sInitialized = true;
+    }
+
+    private static void addCategory(Map<String, Integer> categories, Set<String> exts,
+                                    int category) {
+        for (String ext : exts) {
+            final Integer previous = categories.get(ext);
+            categories.put(ext, previous != null ? previous | category : category);
+        }
+    }
+
+    /**
+     * Scan a directory and its sub directories, blocks until done.
+     *
+     * @param root absolute path of the directory
+     * @param flags see {@link Flags}
+     * @param threads number of threads reading directories, 0 for one per CPU
+     * @return the files with a known extension, in no particular order
+     * @throws IllegalArgumentException if root is not a directory
+     */
+    @NonNull
+    public static Result scan(@NonNull String root, int flags, int threads) {
+        initExtensions();
+        return nativeScan(root, flags, threads);
+    }
+
+    /* JNI */
+    private static native void nativeInit(String[] exts, int[] categories);
+    private static native Result nativeScan(String root, int flags, int threads);
+}
@@ -0,0 +1,193 @@
+/*****************************************************************************
+ * DirectoryWatcher.java
+ *****************************************************************************
+ * Copyright © 2023 VLC authors, VideoLAN and VideoLabs
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+package org.videolan.libvlc.util;
+
+import androidx.annotation.NonNull;
+import androidx.annotation.Nullable;
+
+import java.util.concurrent.Executor;
+import java.util.concurrent.LinkedBlockingQueue;
+import java.util.concurrent.ThreadFactory;
+import java.util.concurrent.ThreadPoolExecutor;
+import java.util.concurrent.TimeUnit;
+
+/**
+ * Watch root directories with inotify and report the changes of their medias,
+ * so that a library can be refreshed without scanning it again.
+ *
+ * Changes are coalesced per path during the latency window, filtered with the
+ * same extensions as {@link DirectoryScanner} and delivered in batches on an
+ * executor.
+ */
+public class DirectoryWatcher {
+    public static class Change {
+        /** A media file was created, or moved in from outside of the roots */
+        public static final int Created = 0;
+        /** A media file was written */
+        public static final int Modified = 1;
+        /** A media file or a directory was deleted, or moved out of the roots */
+        public static final int Deleted = 2;
+        /** A media file or a directory was moved within the roots */
+        public static final int Moved = 3;
+        /**
+         * The content of a directory must be scanned again with {@link DirectoryScanner}:
+         * it was created, moved in, or events were lost. Changes of files found
+         * by the scan can still be reported.
+         */
+        public static final int Rescan = 4;
+    }
+
+    public static class Batch {
+        /** see {@link Change} */
+        public final int[] types;
+        public final String[] paths;
+        /** source paths of {@link Change#Moved} changes, null otherwise */
+        public final String[] oldPaths;
+        /** see {@link DirectoryScanner.Category}, 0 for directories */
+        public final byte[] categories;
+        /**
+         * true if events were lost: the batch only contains a {@link Change#Rescan}
+         * of each root
+         */
+        public final boolean overflow;
+
+        private Batch(int[] types, String[] paths, String[] oldPaths, byte[] categories,
+                      boolean overflow) {
+            this.types = types;
+            this.paths = paths;
+            this.oldPaths = oldPaths;
+            this.categories = categories;
+            this.overflow = overflow;
+        }
+
+        public int getCount() {
+            return types.length;
+        }
+    }
+
+    public interface Listener {
+        /**
+         * Called from the executor, batches are delivered in order if the
+         * executor runs them in order
+         */
+        void onChanges(@NonNull DirectoryWatcher watcher, @NonNull Batch batch);
+    }
+
+    public static class Stats {
+        /** number of watched directories */
+        public final long watches;
+        /** directories that could not be watched, see /proc/sys/fs/inotify/max_user_watches */
+        public final long failedWatches;
+        public final long overflows;
+        public final long batches;
+        public final long changes;
+
+        private Stats(long[] stats) {
+            watches = stats[0];
+            failedWatches = stats[1];
+            overflows = stats[2];
+            batches = stats[3];
+            changes = stats[4];
+        }
+    }
+
+    @SuppressWarnings("unused") /* Used from JNI */
+    private long mInstance = 0;
+    private final Listener mListener;
+    private final Executor mExecutor;
+
+    /**
+     * Start watching directories and their sub directories
+     *
+     * @param roots absolute paths of the directories
+     * @param flags see {@link DirectoryScanner.Flags}
+     * @param latency time in milliseconds changes are coalesced before being delivered
+     * @param maxBatch maximum number of changes per batch
+     * @param listener listener receiving the batches
+     * @param executor executor running the listener, null for a single background thread
+     * @throws IllegalStateException if inotify can't be used
+     */
+    public DirectoryWatcher(@NonNull String[] roots, int flags, int latency, int maxBatch,
+                            @NonNull Listener listener, @Nullable Executor executor) {
+        if (roots.length == 0 || latency < 0 || maxBatch <= 0)
+            throw new IllegalArgumentException("invalid arguments");
+        DirectoryScanner.initExtensions();
+        mListener = listener;
+        mExecutor = executor != null ? executor : newDefaultExecutor();
+        nativeNew(roots, flags, latency, maxBatch);
+    }
+
+    private static Executor newDefaultExecutor() {
+        final ThreadPoolExecutor executor = new ThreadPoolExecutor(1, 1, 30, TimeUnit.SECONDS,
+                new LinkedBlockingQueue<Runnable>(), new ThreadFactory() {
+            @Override
+            public Thread newThread(@NonNull Runnable r) {
+                return new Thread(r, "vlc-watcher");
+            }
+        });
+        executor.allowCoreThreadTimeOut(true);
+        return executor;
+    }
+
+    @SuppressWarnings("unused") /* Used from JNI */
+    private void onChangesFromNative(int[] types, String[] paths, String[] oldPaths,
+                                     byte[] categories, boolean overflow) {
+        final Batch batch = new Batch(types, paths, oldPaths, categories, overflow);
+        mExecutor.execute(new Runnable() {
+            @Override
+            public void run() {
+                mListener.onChanges(DirectoryWatcher.this, batch);
+            }
+        });
+    }
+
+    /**
+     * Get the counters of the watcher
+     */
+    @NonNull
+    public synchronized Stats getStats() {
+        final long[] stats = new long[5];
+        nativeGetStats(stats);
+        return new Stats(stats);
+    }
+
+    /**
+     * Stop watching, no batch is delivered to the executor once this returns
+     */
+    public synchronized void release() {
+        if (mInstance != 0)
+            nativeRelease();
+    }
+
+    @Override
+    protected void finalize() throws Throwable {
+        try {
+            release();
+        } finally {
+            super.finalize();
+        }
+    }
+
+    /* JNI */
+    private native void nativeNew(String[] roots, int flags, int latency, int maxBatch);
+    private native void nativeRelease();
+    private native void nativeGetStats(long[] stats);
+}
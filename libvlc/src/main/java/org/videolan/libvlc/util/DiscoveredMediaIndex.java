@@ -0,0 +1,254 @@
+/*****************************************************************************
+ * DiscoveredMediaIndex.java
+ *****************************************************************************
+ * Copyright © 2023 VLC authors, VideoLAN and VideoLabs
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+package org.videolan.libvlc.util;
+
+import android.net.Uri;
+
+import org.videolan.libvlc.interfaces.IMedia;
+
+import java.util.HashMap;
+
+/**
+ * Medias found by several discoverers, deduplicated by mrl, in discovery order.
+ *
+ * Each unique media gets a slot when first added. Its index is the number of
+ * live slots before it, counted with a Fenwick tree, so that additions,
+ * removals and lookups are O(log n). Slots are compacted when full.
+ */
+class DiscoveredMediaIndex {
+    private static class Entry {
+        private final String key;
+        private IMedia media;
+        private int refs = 1;
+        private int slot;
+        /* Replayed from the WarmStartCache, not reported by a discoverer yet */
+        private boolean stale = false;
+        private String cachedTitle = null;
+        private int cachedType = IMedia.Type.Unknown;
+        private long lastSeen;
+
+        private Entry(String key, IMedia media) {
+            this.key = key;
+            this.media = media;
+        }
+    }
+
+    private final HashMap<String, Entry> mEntries = new HashMap<>();
+    private final HashMap<IMedia, Entry> mByMedia = new HashMap<>();
+    private Entry[] mSlots = new Entry[16];
+    private int[] mTree = new int[17];
+    private int mSlotCount = 0;
+
+    private static String keyOf(IMedia media) {
+        final Uri uri = media.getUri();
+        return uri != null ? uri.toString() : "media@" + System.identityHashCode(media);
+    }
+
+    private Entry insert(String key, IMedia media) {
+        if (mSlotCount == mSlots.length)
+            compact();
+        final Entry entry = new Entry(key, media);
+        entry.slot = mSlotCount++;
+        mSlots[entry.slot] = entry;
+        update(entry.slot, 1);
+        mEntries.put(key, entry);
+        return entry;
+    }
+
+    /**
+     * Add a media reported by a discoverer, the media is retained.
+     *
+     * @return the index of the media, or -1 if it was already known
+     */
+    int add(IMedia media) {
+        final String key = keyOf(media);
+        final Entry known = mEntries.get(key);
+        if (known != null) {
+            known.refs++;
+            mByMedia.put(media, known);
+            return -1;
+        }
+        if (!media.retain())
+            return -1;
+        final Entry entry = insert(key, media);
+        entry.lastSeen = System.currentTimeMillis();
+        mByMedia.put(media, entry);
+        return prefix(entry.slot);
+    }
+
+    /**
+     * Add a media from the WarmStartCache, owned by the index, until a
+     * discoverer reports it.
+     *
+     * @return the index of the media, or -1 if it was already known
+     */
+    int addStale(IMedia media, String title, int type, long lastSeen) {
+        final String key = keyOf(media);
+        if (mEntries.containsKey(key))
+            return -1;
+        final Entry entry = insert(key, media);
+        entry.refs = 0;
+        entry.stale = true;
+        entry.cachedTitle = title;
+        entry.cachedType = type;
+        entry.lastSeen = lastSeen;
+        return prefix(entry.slot);
+    }
+
+    /**
+     * Replace the stale media with the same mrl by the one reported by a
+     * discoverer, that is retained.
+     *
+     * @return the index of the media, or -1 if there was no stale media
+     */
+    int revalidate(IMedia media) {
+        final Entry entry = mEntries.get(keyOf(media));
+        if (entry == null || !entry.stale || !media.retain())
+            return -1;
+        entry.media.release();
+        entry.media = media;
+        entry.refs = 1;
+        entry.stale = false;
+        entry.cachedTitle = null;
+        entry.cachedType = IMedia.Type.Unknown;
+        entry.lastSeen = System.currentTimeMillis();
+        mByMedia.put(media, entry);
+        return prefix(entry.slot);
+    }
+
+    /**
+     * Remove a stale media
+     *
+     * @return the released media
+     */
+    IMedia removeStale(int index) {
+        final Entry entry = mSlots[select(index)];
+        if (!entry.stale)
+            throw new IllegalArgumentException("media is not stale");
+        update(entry.slot, -1);
+        mSlots[entry.slot] = null;
+        mEntries.remove(entry.key);
+        entry.media.release();
+        return entry.media;
+    }
+
+    /**
+     * Remove a media reported by a discoverer
+     *
+     * @return the index the media had, or -1 if other discoverers still report it
+     */
+    int remove(IMedia media) {
+        final Entry entry = mByMedia.remove(media);
+        if (entry == null || --entry.refs > 0)
+            return -1;
+        final int index = prefix(entry.slot);
+        update(entry.slot, -1);
+        mSlots[entry.slot] = null;
+        mEntries.remove(entry.key);
+        entry.media.release();
+        return index;
+    }
+
+    IMedia get(int index) {
+        return mSlots[select(index)].media;
+    }
+
+    boolean isStale(int index) {
+        return mSlots[select(index)].stale;
+    }
+
+    /* Title from the WarmStartCache, null once revalidated */
+    String getCachedTitle(int index) {
+        return mSlots[select(index)].cachedTitle;
+    }
+
+    /* Type from the WarmStartCache, Unknown once revalidated */
+    int getCachedType(int index) {
+        return mSlots[select(index)].cachedType;
+    }
+
+    /* Time of the last discovery, now for medias currently reported */
+    long getLastSeen(int index) {
+        final Entry entry = mSlots[select(index)];
+        return entry.stale ? entry.lastSeen : System.currentTimeMillis();
+    }
+
+    int size() {
+        return mEntries.size();
+    }
+
+    void clear() {
+        for (Entry entry : mEntries.values())
+            entry.media.release();
+        mEntries.clear();
+        mByMedia.clear();
+        mSlots = new Entry[16];
+        mTree = new int[17];
+        mSlotCount = 0;
+    }
+
+    /* Drop the empty slots, and grow if still more than half full */
+    private void compact() {
+        final int size = mEntries.size();
+        final Entry[] slots = new Entry[Math.max(16, size * 2)];
+        mTree = new int[slots.length + 1];
+        int count = 0;
+        for (int i = 0; i < mSlotCount; ++i) {
+            final Entry entry = mSlots[i];
+            if (entry == null)
+                continue;
+            entry.slot = count;
+            slots[count++] = entry;
+        }
+        mSlots = slots;
+        mSlotCount = count;
+        for (int i = 0; i < count; ++i)
+            update(i, 1);
+    }
+
+    private void update(int slot, int delta) {
+        for (int i = slot + 1; i < mTree.length; i += i & -i)
+            mTree[i] += delta;
+    }
+
+    /* Number of live slots before slot */
+    private int prefix(int slot) {
+        int sum = 0;
+        for (int i = slot; i > 0; i -= i & -i)
+            sum += mTree[i];
+        return sum;
+    }
+
+    /* Slot of the index-th live entry */
+    private int select(int index) {
+        if (index < 0 || index >= mEntries.size())
+            throw new IndexOutOfBoundsException();
+        int pos = 0;
+        for (int step = Integer.highestOneBit(mTree.length - 1); step > 0; step >>= 1) {
+            final int next = pos + step;
+            if (next < mTree.length && mTree[next] <= index) {
+                pos = next;
+                index -= mTree[next];
+            }
+        }
+        return pos;
+    }
+}
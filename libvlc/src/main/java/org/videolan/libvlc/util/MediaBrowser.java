@@ -22,9 +22,13 @@ package org.videolan.libvlc.util;
 
 import android.net.Uri;
 import android.os.Handler;
+import android.os.HandlerThread;
+import android.os.Looper;
+import android.os.SystemClock;
 import android.util.Log;
 
 import androidx.annotation.MainThread;
+import androidx.annotation.Nullable;
 
 import org.videolan.libvlc.FactoryManager;
 import org.videolan.libvlc.MediaDiscoverer;
@@ -34,24 +38,76 @@ import org.videolan.libvlc.interfaces.IMedia;
 import org.videolan.libvlc.interfaces.IMediaFactory;
 import org.videolan.libvlc.interfaces.IMediaList;
 
+import java.io.File;
 import java.util.ArrayList;
+import java.util.List;
+import java.util.concurrent.Executor;
+import java.util.concurrent.LinkedBlockingQueue;
+import java.util.concurrent.ThreadFactory;
+import java.util.concurrent.ThreadPoolExecutor;
+import java.util.concurrent.TimeUnit;
 
 public class MediaBrowser {
     private static final String TAG = "MediaBrowser";
 
     private final ILibVLC mILibVlc;
     private final ArrayList<MediaDiscoverer> mMediaDiscoverers = new ArrayList<MediaDiscoverer>();
-    private final ArrayList<IMedia> mDiscovererMediaArray = new ArrayList<IMedia>();
+    private final ArrayList<DiscovererListener> mDiscovererListeners = new ArrayList<>();
+    private final DiscoveredMediaIndex mDiscoveredMedias = new DiscoveredMediaIndex();
     private IMediaList mBrowserMediaList;
     private IMedia mMedia;
     private EventListener mEventListener;
     private Handler mHandler;
     private boolean mAlive;
     private IMediaFactory mFactory;
+    private int mBatchMaxCount = 0;
+    private long mBatchMaxDelay = 0;
+    private HandlerThread mBatchThread = null;
+    private volatile Batcher mBatcher = null;
+    private File mWarmStartFile = null;
+    private long mWarmStartMaxAge = 0;
+    /* True while the medias of all the Lan discoverers are listed */
+    private boolean mDiscoveringShares = false;
 
     private static final String IGNORE_LIST_OPTION =  ":ignore-filetypes=";
     private String mIgnoreList = "db,nfo,ini,jpg,jpeg,ljpg,gif,png,pgm,pgmyuv,pbm,pam,tga,bmp,pnm,xpm,xcf,pcx,tif,tiff,lbm,sfv,txt,sub,idx,srt,ssa,ass,smi,utf,utf-8,rt,aqt,txt,usf,jss,cdg,psb,mpsub,mpl2,pjs,dks,stl,vtt,ttml";
 
+    /* Discoverers can block while their modules load: start them concurrently */
+    private static final int DISCOVERER_THREADS = 4;
+    private static ThreadPoolExecutor sDiscovererExecutor = null;
+
+    private static synchronized Executor getDiscovererExecutor() {
+        if (sDiscovererExecutor == null) {
+            sDiscovererExecutor = new ThreadPoolExecutor(DISCOVERER_THREADS, DISCOVERER_THREADS,
+                    10, TimeUnit.SECONDS, new LinkedBlockingQueue<Runnable>(), new ThreadFactory() {
+                @Override
+                public Thread newThread(Runnable r) {
+                    return new Thread(r, "vlc-discoverer");
+                }
+            });
+            sDiscovererExecutor.allowCoreThreadTimeOut(true);
+        }
+        return sDiscovererExecutor;
+    }
+
+    public static class DiscovererStats {
+        public final String name;
+        /** time spent starting the discoverer, in milliseconds, -1 if not started yet */
+        public final long startDuration;
+        /** time from the start request to the first media, in milliseconds, -1 if none yet */
+        public final long timeToFirstItem;
+        /** number of medias reported, including duplicates and removed ones */
+        public final int itemCount;
+
+        private DiscovererStats(String name, long startDuration, long timeToFirstItem,
+                                int itemCount) {
+            this.name = name;
+            this.startDuration = startDuration;
+            this.timeToFirstItem = timeToFirstItem;
+            this.itemCount = itemCount;
+        }
+    }
+
     public static class Flag {
         /** If this flag is set, browse() could fire up dialogs */
         public final static int Interact = 1;
@@ -85,6 +141,30 @@ public class MediaBrowser {
         void onBrowseEnd();
     }
 
+    /**
+     * Listener receiving browsed medias in batches, see {@link #setBatching(int, long)}
+     */
+    public interface BatchEventListener extends EventListener {
+        /**
+         * Received instead of {@link #onMediaAdded(int, IMedia)} when batching is enabled.
+         * @param start index of the first media
+         * @param medias consecutive medias added from start, released after this call
+         */
+        void onMediaAdded(int start, IMedia[] medias);
+    }
+
+    /**
+     * Listener notified when a stale media, see {@link #setWarmStartFile(File, long)}, is
+     * found again by a discoverer
+     */
+    public interface WarmStartListener extends EventListener {
+        /**
+         * @param index index of the media, unchanged
+         * @param media media reported by the discoverer, replacing the stale one
+         */
+        void onMediaRevalidated(int index, IMedia media);
+    }
+
      /**
      *
      * @param libvlc The LibVLC instance to use
@@ -112,10 +192,17 @@ public class MediaBrowser {
     }
 
     private void reset() {
+        if (mDiscoveringShares) {
+            saveWarmStartFile();
+            mDiscoveringShares = false;
+        }
         for (MediaDiscoverer md : mMediaDiscoverers)
             md.release();
         mMediaDiscoverers.clear();
-        mDiscovererMediaArray.clear();
+        for (DiscovererListener listener : mDiscovererListeners)
+            listener.mCancelled = true;
+        mDiscovererListeners.clear();
+        mDiscoveredMedias.clear();
         if (mMedia != null) {
             mMedia.release();
             mMedia = null;
@@ -125,6 +212,10 @@ public class MediaBrowser {
             mBrowserMediaList.release();
             mBrowserMediaList = null;
         }
+        if (mBatcher != null) {
+            mBatcher.cancel();
+            mBatcher = null;
+        }
     }
 
     /**
@@ -137,6 +228,34 @@ public class MediaBrowser {
             throw new IllegalStateException("MediaBrowser released more than one time");
         mILibVlc.release();
         mAlive = false;
+        if (mBatchThread != null) {
+            /* After the cancelled batcher released its medias */
+            final HandlerThread thread = mBatchThread;
+            new Handler(thread.getLooper()).post(new Runnable() {
+                @Override
+                public void run() {
+                    thread.quit();
+                }
+            });
+            mBatchThread = null;
+        }
+    }
+
+    /**
+     * Deliver the medias found by the next {@link #browse} calls in batches. Items are
+     * accumulated on a worker thread, and each batch is posted once to the
+     * listener Handler, to {@link BatchEventListener#onMediaAdded(int, IMedia[])} if the
+     * listener implements it.
+     *
+     * @param maxCount maximum number of medias per batch, 0 or 1 to disable batching
+     * @param maxDelay maximum time in milliseconds an item waits before being delivered
+     */
+    @MainThread
+    public void setBatching(int maxCount, long maxDelay) {
+        if (maxCount < 0 || maxDelay < 0)
+            throw new IllegalArgumentException("invalid batching parameters");
+        mBatchMaxCount = maxCount;
+        mBatchMaxDelay = maxDelay;
     }
 
     /**
@@ -150,12 +269,45 @@ public class MediaBrowser {
     }
 
     private void startMediaDiscoverer(String discovererName) {
-        MediaDiscoverer md = new MediaDiscoverer(mILibVlc, discovererName);
+        final MediaDiscoverer md = new MediaDiscoverer(mILibVlc, discovererName);
         mMediaDiscoverers.add(md);
+        final DiscovererListener listener = new DiscovererListener(discovererName);
+        mDiscovererListeners.add(listener);
         final MediaList ml = md.getMediaList();
-        ml.setEventListener(mDiscovererMediaListEventListener, mHandler);
+        ml.setEventListener(listener, mHandler);
         ml.release();
-        if (!md.isReleased()) md.start();
+        getDiscovererExecutor().execute(new Runnable() {
+            @Override
+            public void run() {
+                /* Keep the native discoverer alive if reset() releases it meanwhile */
+                if (listener.mCancelled || !md.retain())
+                    return;
+                try {
+                    final long start = SystemClock.elapsedRealtime();
+                    if (!listener.mCancelled && !md.start())
+                        Log.w(TAG, "can't start " + listener.mName + " discoverer");
+                    listener.mStartDuration = SystemClock.elapsedRealtime() - start;
+                } finally {
+                    md.release();
+                }
+            }
+        });
+    }
+
+    /**
+     * Get the statistics of the discoverers started by the last {@link #discoverNetworkShares}
+     * call
+     */
+    @MainThread
+    public DiscovererStats[] getDiscovererStats() {
+        final DiscovererStats[] stats = new DiscovererStats[mDiscovererListeners.size()];
+        for (int i = 0; i < stats.length; ++i) {
+            final DiscovererListener listener = mDiscovererListeners.get(i);
+            stats[i] = new DiscovererStats(listener.mName, listener.mStartDuration,
+                    listener.mFirstItemTime != -1 ? listener.mFirstItemTime - listener.mStartTime : -1,
+                    listener.mItemCount);
+        }
+        return stats;
     }
 
     /**
@@ -169,12 +321,114 @@ public class MediaBrowser {
                 MediaDiscoverer.list(mILibVlc, MediaDiscoverer.Description.Category.Lan);
         if (descriptions == null)
             return;
+        mDiscoveringShares = true;
+        loadWarmStartFile();
         for (MediaDiscoverer.Description description : descriptions) {
             Log.i(TAG, "starting " + description.name + " discover (" + description.longName + ")");
             startMediaDiscoverer(description.name);
         }
     }
 
+    /**
+     * Save the network medias found by {@link #discoverNetworkShares()} to a file, and list
+     * them again as soon as the next discovery starts, as stale medias, until a discoverer
+     * reports them. The file is written when the discovery is reset or the browser released.
+     *
+     * @param file cache file, null to disable
+     * @param maxAge medias not seen for more than maxAge milliseconds are dropped
+     */
+    @MainThread
+    public void setWarmStartFile(@Nullable File file, long maxAge) {
+        mWarmStartFile = file;
+        mWarmStartMaxAge = maxAge;
+    }
+
+    private void loadWarmStartFile() {
+        if (mWarmStartFile == null)
+            return;
+        for (WarmStartCache.Item item : WarmStartCache.load(mWarmStartFile, mWarmStartMaxAge)) {
+            final IMedia media = mFactory.getFromUri(mILibVlc, Uri.parse(item.mrl));
+            final int index = mDiscoveredMedias.addStale(media, item.title, item.type,
+                    item.lastSeen);
+            if (index == -1)
+                media.release();
+            else if (mEventListener != null)
+                mEventListener.onMediaAdded(index, media);
+        }
+    }
+
+    private void saveWarmStartFile() {
+        if (mWarmStartFile == null)
+            return;
+        final File file = mWarmStartFile;
+        final int count = mDiscoveredMedias.size();
+        final List<WarmStartCache.Item> items = new ArrayList<>(count);
+        for (int i = 0; i < count; ++i) {
+            final IMedia media = mDiscoveredMedias.get(i);
+            if (media.getUri() == null)
+                continue;
+            /* Stale medias were never parsed: keep what was saved */
+            final boolean stale = mDiscoveredMedias.isStale(i);
+            final String title = stale
+                    ? mDiscoveredMedias.getCachedTitle(i) : media.getMeta(IMedia.Meta.Title);
+            final int type = stale ? mDiscoveredMedias.getCachedType(i) : media.getType();
+            items.add(new WarmStartCache.Item(media.getUri().toString(), title, type,
+                    mDiscoveredMedias.getLastSeen(i)));
+        }
+        getDiscovererExecutor().execute(new Runnable() {
+            @Override
+            public void run() {
+                WarmStartCache.save(file, items);
+            }
+        });
+    }
+
+    /**
+     * Returns true if the media at index comes from the warm start file and wasn't reported
+     * by a discoverer yet
+     */
+    @MainThread
+    public boolean isStale(int index) {
+        return mBrowserMediaList == null && mDiscoveredMedias.isStale(index);
+    }
+
+    /**
+     * Get the title saved in the warm start file for a stale media, null otherwise
+     */
+    @MainThread
+    @Nullable
+    public String getCachedTitle(int index) {
+        return mBrowserMediaList == null ? mDiscoveredMedias.getCachedTitle(index) : null;
+    }
+
+    /**
+     * Get the type saved in the warm start file for a stale media, so that it can be shown as
+     * a folder or a file before it is found again
+     *
+     * @return see {@link IMedia.Type}, {@link IMedia.Type#Unknown} if the media isn't stale
+     */
+    @MainThread
+    public int getCachedType(int index) {
+        return mBrowserMediaList == null ? mDiscoveredMedias.getCachedType(index)
+                : IMedia.Type.Unknown;
+    }
+
+    /**
+     * Remove the stale medias, for example once the discoverers had time to answer
+     */
+    @MainThread
+    public void removeStaleMedias() {
+        if (mBrowserMediaList != null)
+            return;
+        for (int i = mDiscoveredMedias.size() - 1; i >= 0; --i) {
+            if (!mDiscoveredMedias.isStale(i))
+                continue;
+            final IMedia media = mDiscoveredMedias.removeStale(i);
+            if (mEventListener != null)
+                mEventListener.onMediaRemoved(i, media);
+        }
+    }
+
     /**
      * Discover networks shares using a specified Discoverer
      * @param serviceName see {@link MediaDiscoverer.Description.Category#name}
@@ -233,7 +487,16 @@ public class MediaBrowser {
             mediaFlags |= IMedia.Parse.DoInteract;
         reset();
         mBrowserMediaList = media.subItems();
-        mBrowserMediaList.setEventListener(mBrowserMediaListEventListener, mHandler);
+        if (mBatchMaxCount > 1) {
+            if (mBatchThread == null) {
+                mBatchThread = new HandlerThread("vlc-browser");
+                mBatchThread.start();
+            }
+            mBatcher = new Batcher(mBatchThread.getLooper(), mBatchMaxCount, mBatchMaxDelay,
+                    mHandler != null ? mHandler : new Handler(Looper.getMainLooper()));
+            mBrowserMediaList.setEventListener(mBatcher, new Handler(mBatchThread.getLooper()));
+        } else
+            mBrowserMediaList.setEventListener(mBrowserMediaListEventListener, mHandler);
         media.parseAsync(mediaFlags, 0);
         mMedia = media;
     }
@@ -243,7 +506,7 @@ public class MediaBrowser {
      */
     @MainThread
     public int getMediaCount() {
-        return mBrowserMediaList != null ? mBrowserMediaList.getCount() : mDiscovererMediaArray.size();
+        return mBrowserMediaList != null ? mBrowserMediaList.getCount() : mDiscoveredMedias.size();
     }
 
     /**
@@ -254,7 +517,7 @@ public class MediaBrowser {
         if (index < 0 || index >= getMediaCount())
             throw new IndexOutOfBoundsException();
         final IMedia media = mBrowserMediaList != null ? mBrowserMediaList.getMediaAt(index) :
-                mDiscovererMediaArray.get(index);
+                mDiscoveredMedias.get(index);
         media.retain();
         return media;
     }
@@ -290,32 +553,160 @@ public class MediaBrowser {
         }
     };
 
-    private final MediaList.EventListener mDiscovererMediaListEventListener = new MediaList.EventListener() {
+    /*
+     * Receives the MediaList events on the batch thread, and posts consecutive
+     * added medias to the listener Handler in one go.
+     */
+    private class Batcher implements MediaList.EventListener {
+        private final Handler mWorker;
+        private final Handler mTarget;
+        private final int mMaxCount;
+        private final long mMaxDelay;
+        private final ArrayList<IMedia> mPending = new ArrayList<>();
+        private int mPendingStart = -1;
+        private volatile boolean mCancelled = false;
+
+        private final Runnable mFlushRunnable = new Runnable() {
+            @Override
+            public void run() {
+                flush();
+            }
+        };
+
+        private Batcher(Looper looper, int maxCount, long maxDelay, Handler target) {
+            mWorker = new Handler(looper);
+            mTarget = target;
+            mMaxCount = maxCount;
+            mMaxDelay = maxDelay;
+        }
+
+        /* Called from the main thread, pending medias are released from the batch thread */
+        private void cancel() {
+            mCancelled = true;
+            mWorker.post(new Runnable() {
+                @Override
+                public void run() {
+                    mWorker.removeCallbacks(mFlushRunnable);
+                    for (IMedia media : mPending)
+                        media.release();
+                    mPending.clear();
+                }
+            });
+        }
+
         @Override
         public void onEvent(MediaList.Event event) {
-            if (mEventListener == null)
+            if (mCancelled)
                 return;
-            final MediaList.Event mlEvent = event;
-            int index = -1;
+            switch (event.type) {
+                case MediaList.Event.ItemAdded:
+                    if (!mPending.isEmpty() && event.index != mPendingStart + mPending.size())
+                        flush();
+                    if (!event.media.retain())
+                        return;
+                    if (mPending.isEmpty()) {
+                        mPendingStart = event.index;
+                        mWorker.postDelayed(mFlushRunnable, mMaxDelay);
+                    }
+                    mPending.add(event.media);
+                    if (mPending.size() >= mMaxCount)
+                        flush();
+                    break;
+                case MediaList.Event.ItemDeleted:
+                case MediaList.Event.EndReached: {
+                    /* Keep the order of the events */
+                    flush();
+                    final int type = event.type;
+                    final int index = event.index;
+                    final IMedia media = event.media;
+                    mTarget.post(new Runnable() {
+                        @Override
+                        public void run() {
+                            if (mBatcher != Batcher.this || mEventListener == null)
+                                return;
+                            if (type == MediaList.Event.ItemDeleted)
+                                mEventListener.onMediaRemoved(index, media);
+                            else
+                                mEventListener.onBrowseEnd();
+                        }
+                    });
+                    break;
+                }
+            }
+        }
 
-            /*
-             * We use an intermediate array here since more than one MediaDiscoverer can be used
-             */
-            switch (mlEvent.type) {
+        private void flush() {
+            mWorker.removeCallbacks(mFlushRunnable);
+            if (mPending.isEmpty())
+                return;
+            final int start = mPendingStart;
+            final IMedia[] medias = mPending.toArray(new IMedia[0]);
+            mPending.clear();
+            mTarget.post(new Runnable() {
+                @Override
+                public void run() {
+                    final EventListener listener = mEventListener;
+                    if (mBatcher == Batcher.this && listener != null) {
+                        if (listener instanceof BatchEventListener)
+                            ((BatchEventListener) listener).onMediaAdded(start, medias);
+                        else {
+                            for (int i = 0; i < medias.length; ++i)
+                                listener.onMediaAdded(start + i, medias[i]);
+                        }
+                    }
+                    for (IMedia media : medias)
+                        media.release();
+                }
+            });
+        }
+    }
+
+    /*
+     * One per discoverer. Medias reported by several discoverers are merged
+     * by the DiscoveredMediaIndex.
+     */
+    private class DiscovererListener implements MediaList.EventListener {
+        private final String mName;
+        private final long mStartTime = SystemClock.elapsedRealtime();
+        private volatile long mStartDuration = -1;
+        private long mFirstItemTime = -1;
+        private int mItemCount = 0;
+        private volatile boolean mCancelled = false;
+
+        private DiscovererListener(String name) {
+            mName = name;
+        }
+
+        @Override
+        public void onEvent(MediaList.Event event) {
+            if (mCancelled)
+                return;
+            int index;
+
+            switch (event.type) {
             case MediaList.Event.ItemAdded:
-                mDiscovererMediaArray.add(mlEvent.media);
-                mEventListener.onMediaAdded(index, mlEvent.media);
+                if (mFirstItemTime == -1)
+                    mFirstItemTime = SystemClock.elapsedRealtime();
+                mItemCount++;
+                index = mDiscoveredMedias.revalidate(event.media);
+                if (index != -1) {
+                    if (mEventListener instanceof WarmStartListener)
+                        ((WarmStartListener) mEventListener).onMediaRevalidated(index, event.media);
+                    break;
+                }
+                index = mDiscoveredMedias.add(event.media);
+                if (index != -1 && mEventListener != null)
+                    mEventListener.onMediaAdded(index, event.media);
                 break;
             case MediaList.Event.ItemDeleted:
-                index = mDiscovererMediaArray.indexOf(mlEvent.media);
-                if (index != -1)
-                    mDiscovererMediaArray.remove(index);
-                if (index != -1)
-                    mEventListener.onMediaRemoved(index, mlEvent.media);
+                index = mDiscoveredMedias.remove(event.media);
+                if (index != -1 && mEventListener != null)
+                    mEventListener.onMediaRemoved(index, event.media);
                 break;
             case MediaList.Event.EndReached:
-                mEventListener.onBrowseEnd();
+                if (mEventListener != null)
+                    mEventListener.onBrowseEnd();
             }
         }
-    };
+    }
 }
\ No newline at end of file
@@ -0,0 +1,175 @@
+/*****************************************************************************
+ * SubtitleIndex.java
+ *****************************************************************************
+ * Copyright © 2023 VLC authors, VideoLAN and VideoLabs
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+package org.videolan.libvlc.util;
+
+import android.net.Uri;
+
+import androidx.annotation.NonNull;
+import androidx.annotation.Nullable;
+
+import org.videolan.libvlc.interfaces.IMedia;
+
+import java.io.File;
+
+/**
+ * Find the external subtitles of local videos and attach them as slaves.
+ *
+ * Each directory is listed once and cached until its modification time
+ * changes, instead of being probed by libvlc every time a media is opened.
+ * Subtitles are matched by normalized base name, or by the OpenSubtitles
+ * hash of the video when it is part of the subtitle file name. Subtitles from
+ * the "Subs" and "Subtitles" sub directories and from the folders added with
+ * {@link #addFolder(String)} are matched too.
+ */
+public class SubtitleIndex {
+    public static class Match {
+        public final String path;
+        /** slave priority, see {@link IMedia.Slave#priority} */
+        public final int priority;
+
+        private Match(String path, int priority) {
+            this.path = path;
+            this.priority = priority;
+        }
+    }
+
+    public static class Stats {
+        public final long lookups;
+        /** number of directories listed */
+        public final long scans;
+        /** lookups of directories found in the cache */
+        public final long cacheHits;
+        /** number of videos hashed */
+        public final long hashes;
+
+        private Stats(long[] stats) {
+            lookups = stats[0];
+            scans = stats[1];
+            cacheHits = stats[2];
+            hashes = stats[3];
+        }
+    }
+
+    @SuppressWarnings("unused") /* Used from JNI */
+    private static Match createMatchFromNative(String path, int priority) {
+        return new Match(path, priority);
+    }
+
+    @SuppressWarnings("unused") /* Used from JNI */
+    private long mInstance = 0;
+
+    /**
+     * Create a SubtitleIndex
+     *
+     * @param maxDirectories maximum number of directories kept in the cache
+     */
+    public SubtitleIndex(int maxDirectories) {
+        if (maxDirectories <= 0)
+            throw new IllegalArgumentException("maxDirectories <= 0");
+        DirectoryScanner.initExtensions();
+        nativeNew(maxDirectories);
+    }
+
+    /**
+     * Add a folder where subtitles of any video are looked for
+     *
+     * @param path absolute path of the folder
+     */
+    public synchronized void addFolder(@NonNull String path) {
+        nativeAddFolder(path);
+    }
+
+    /**
+     * Find the subtitles of a video
+     *
+     * @param videoPath absolute path of the video
+     * @return the matches, by decreasing priority
+     */
+    @NonNull
+    public synchronized Match[] find(@NonNull String videoPath) {
+        return nativeFind(videoPath);
+    }
+
+    /**
+     * Find the subtitles of a local media and add them as slaves with a single
+     * native call. The subtitle autodetection of libvlc is disabled for the
+     * media since the index already did it.
+     *
+     * @param media a Media with a "file" uri, not parsed nor played yet
+     * @return the number of subtitles attached, -1 if the media is not local
+     */
+    public int attach(@NonNull IMedia media) {
+        final Uri uri = media.getUri();
+        if (uri == null || !"file".equals(uri.getScheme()) || uri.getPath() == null)
+            return -1;
+
+        final Match[] matches = find(uri.getPath());
+        final String[] uris = new String[matches.length];
+        final int[] priorities = new int[matches.length];
+        for (int i = 0; i < matches.length; ++i) {
+            uris[i] = Uri.fromFile(new File(matches[i].path)).toString();
+            priorities[i] = matches[i].priority;
+        }
+        return nativeAttach(media, uris, priorities);
+    }
+
+    /**
+     * Drop a directory from the cache, it is listed again by the next lookup
+     *
+     * @param path absolute path of the directory, null to drop all of them
+     */
+    public synchronized void invalidate(@Nullable String path) {
+        nativeInvalidate(path);
+    }
+
+    /**
+     * Get the counters of the index
+     */
+    @NonNull
+    public synchronized Stats getStats() {
+        final long[] stats = new long[4];
+        nativeGetStats(stats);
+        return new Stats(stats);
+    }
+
+    public synchronized void release() {
+        if (mInstance != 0)
+            nativeRelease();
+    }
+
+    @Override
+    protected void finalize() throws Throwable {
+        try {
+            release();
+        } finally {
+            super.finalize();
+        }
+    }
+
+    /* JNI */
+    private native void nativeNew(int maxDirectories);
+    private native void nativeRelease();
+    private native void nativeAddFolder(String path);
+    private native Match[] nativeFind(String videoPath);
+    private native int nativeAttach(IMedia media, String[] uris, int[] priorities);
+    private native void nativeInvalidate(String path);
+    private native void nativeGetStats(long[] stats);
+}
@@ -0,0 +1,165 @@
+/*****************************************************************************
+ * WarmStartCache.java
+ *****************************************************************************
+ * Copyright © 2023 VLC authors, VideoLAN and VideoLabs
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+package org.videolan.libvlc.util;
+
+import android.util.Log;
+
+import java.io.BufferedInputStream;
+import java.io.BufferedOutputStream;
+import java.io.Closeable;
+import java.io.DataInputStream;
+import java.io.DataOutputStream;
+import java.io.File;
+import java.io.FileInputStream;
+import java.io.FileNotFoundException;
+import java.io.FileOutputStream;
+import java.io.IOException;
+import java.util.ArrayList;
+import java.util.List;
+
+/**
+ * Last known network items, saved between two discoveries so that they can be
+ * shown before the discoverers answer.
+ */
+class WarmStartCache {
+    private static final String TAG = "VLC/WarmStartCache";
+    private static final int MAGIC = 0x564c4357; /* "VLCW" */
+    private static final int VERSION = 1;
+    /* Protects against corrupted files */
+    private static final int MAX_ITEMS = 4096;
+    /* Longest string writeUTF() accepts, in modified UTF-8 bytes */
+    private static final int MAX_UTF_LENGTH = 65535;
+
+    static class Item {
+        final String mrl;
+        final String title;
+        /** see {@link org.videolan.libvlc.interfaces.IMedia.Type} */
+        final int type;
+        /** System.currentTimeMillis() of the last discovery */
+        final long lastSeen;
+
+        Item(String mrl, String title, int type, long lastSeen) {
+            this.mrl = mrl;
+            this.title = title;
+            this.type = type;
+            this.lastSeen = lastSeen;
+        }
+    }
+
+    /**
+     * Read the items seen less than maxAge milliseconds ago. Returns an empty
+     * list if the file is missing or invalid.
+     */
+    static List<Item> load(File file, long maxAge) {
+        final ArrayList<Item> items = new ArrayList<>();
+        final long now = System.currentTimeMillis();
+        DataInputStream in = null;
+        try {
+            in = new DataInputStream(new BufferedInputStream(new FileInputStream(file)));
+            if (in.readInt() != MAGIC || in.readInt() != VERSION)
+                return items;
+            final int count = in.readInt();
+            if (count < 0 || count > MAX_ITEMS)
+                return items;
+            for (int i = 0; i < count; ++i) {
+                final String mrl = in.readUTF();
+                final String title = in.readUTF();
+                final int type = in.readInt();
+                final long lastSeen = in.readLong();
+                if (now - lastSeen <= maxAge)
+                    items.add(new Item(mrl, title.isEmpty() ? null : title, type, lastSeen));
+            }
+        } catch (FileNotFoundException ignored) {
+        } catch (IOException e) {
+            Log.w(TAG, "invalid warm start file: " + e);
+            items.clear();
+        } finally {
+            close(in);
+        }
+        return items;
+    }
+
+    /**
+     * Write the items to a temporary file renamed over file, so that readers
+     * never see a partial file.
+     */
+    static void save(File file, List<Item> items) {
+        /* writeUTF() throws for longer strings, which would abort the whole file */
+        final List<Item> writable = new ArrayList<>(items.size());
+        for (Item item : items) {
+            if (utfLength(item.mrl) <= MAX_UTF_LENGTH
+                    && (item.title == null || utfLength(item.title) <= MAX_UTF_LENGTH))
+                writable.add(item);
+        }
+
+        final File tmp = new File(file.getPath() + ".tmp");
+        DataOutputStream out = null;
+        boolean written = false;
+        try {
+            out = new DataOutputStream(new BufferedOutputStream(new FileOutputStream(tmp)));
+            final int count = Math.min(writable.size(), MAX_ITEMS);
+            out.writeInt(MAGIC);
+            out.writeInt(VERSION);
+            out.writeInt(count);
+            for (int i = 0; i < count; ++i) {
+                final Item item = writable.get(i);
+                out.writeUTF(item.mrl);
+                out.writeUTF(item.title != null ? item.title : "");
+                out.writeInt(item.type);
+                out.writeLong(item.lastSeen);
+            }
+            out.flush();
+            written = true;
+        } catch (IOException e) {
+            Log.w(TAG, "can't write warm start file: " + e);
+        } finally {
+            close(out);
+        }
+        if (!written || !tmp.renameTo(file))
+            tmp.delete();
+    }
+
+    /* Length of the string once encoded by writeUTF() */
+    private static int utfLength(String str) {
+        int length = 0;
+        for (int i = 0; i < str.length(); ++i) {
+            final char c = str.charAt(i);
+            if (c >= 0x0001 && c <= 0x007F)
+                length += 1;
+            else if (c <= 0x07FF)
+                length += 2;
+            else
+                length += 3;
+            if (length > MAX_UTF_LENGTH)
+                break;
+        }
+        return length;
+    }
+
+    private static void close(Closeable closeable) {
+        if (closeable == null)
+            return;
+        try {
+            closeable.close();
+        } catch (IOException ignored) {
+        }
+    }
+}